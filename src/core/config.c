@@ -280,6 +280,21 @@ static directive_t parse_directive(int *token_idx) {
   return dir;
 }
 
+// 跳过出错的块（包括其中嵌套的块），后面的配置仍能继续解析
+static void skip_block(int *token_idx) {
+  int depth = 0;
+  while (*token_idx < token_count) {
+    const char *token = tokens[*token_idx];
+    if (strcmp(token, "}") == 0 && depth == 0) return;
+    *token_idx += 1;
+    if (strcmp(token, "{") == 0) {
+      depth++;
+    } else if (strcmp(token, "}") == 0 && --depth == 0) {
+      return;
+    }
+  }
+}
+
 static location_block_t *parse_location_block(int *token_idx) {
   if (strcmp(tokens[*token_idx], "location") != 0) {
     log_message(LOG_LEVEL_ERROR, "Expected 'location' block.");
@@ -288,10 +303,36 @@ static location_block_t *parse_location_block(int *token_idx) {
   *token_idx += 1; // Consume 'location'
 
   location_block_t *loc = calloc(1, sizeof(location_block_t));
+  loc->match = LOCATION_MATCH_PREFIX;
+  if (*token_idx + 1 < token_count && strcmp(tokens[*token_idx + 1], "{") != 0) {
+    const char *modifier = tokens[*token_idx];
+    if (strcmp(modifier, "=") == 0) {
+      loc->match = LOCATION_MATCH_EXACT;
+    } else if (strcmp(modifier, "^~") == 0) {
+      loc->match = LOCATION_MATCH_PREFIX_NOREGEX;
+    } else if (strcmp(modifier, "~") == 0) {
+      loc->match = LOCATION_MATCH_REGEX;
+    } else if (strcmp(modifier, "~*") == 0) {
+      loc->match = LOCATION_MATCH_REGEX_ICASE;
+    } else {
+      char msg[256];
+      snprintf(msg, sizeof(msg), "Invalid location modifier \"%s\".", modifier);
+      log_message(LOG_LEVEL_ERROR, msg);
+      free(loc);
+      skip_block(token_idx);
+      return NULL;
+    }
+    *token_idx += 1; // Consume modifier
+  }
+  if (*token_idx >= token_count) {
+    log_message(LOG_LEVEL_ERROR, "Expected location path.");
+    free(loc);
+    return NULL;
+  }
   loc->path = strdup(tokens[*token_idx]);
   *token_idx += 1; // Consume path
 
-  if (strcmp(tokens[*token_idx], "{") != 0) {
+  if (*token_idx >= token_count || strcmp(tokens[*token_idx], "{") != 0) {
     log_message(LOG_LEVEL_ERROR, "Expected '{' after location path.");
     free(loc->path);
     free(loc);
@@ -332,8 +373,11 @@ static server_block_t *parse_server_block(int *token_idx) {
   while (*token_idx < token_count && strcmp(tokens[*token_idx], "}") != 0) {
     if (strcmp(tokens[*token_idx], "location") == 0) {
       location_block_t* loc = parse_location_block(token_idx);
-      loc->next = srv->locations;
-      srv->locations = loc;
+      if (!loc) continue;
+      // 按配置顺序链接，正则location按此顺序匹配
+      location_block_t **tail = &srv->locations;
+      while (*tail) tail = &(*tail)->next;
+      *tail = loc;
     } else {
       // It's a directive
       srv->directive_count++;
@@ -479,7 +523,8 @@ config_t *parse_config(const char *filename) {
     if (new_config->http) {
         for (int i = 0; i < new_config->http->directive_count; i++) {
             const directive_t *dir = &new_config->http->directives[i];
-            if (strncmp(dir->key, "gzip", 4) == 0) {
+            if (strncmp(dir->key, "gzip", 4) == 0 || strncmp(dir->key, "brotli", 6) == 0 ||
+                strncmp(dir->key, "zstd", 4) == 0 || strncmp(dir->key, "compress_", 9) == 0) {
                 handle_compression_directive(new_config, dir->key, dir->value);
             } else if (strncmp(dir->key, "proxy_cache", 11) == 0) {
                 handle_cache_directive(new_config, dir->key, dir->value);
@@ -746,7 +791,50 @@ int handle_compression_directive(config_t *config, const char *directive, const
     else if (strcmp(directive, "gzip_comp_level") == 0) {
         int level = atoi(value);
         if (level >= 1 && level <= 9) {
-            config->compress->level = level;
+            config->compress->levels[COMPRESS_ENCODING_GZIP] = level;
+        }
+    }
+    else if (strcmp(directive, "gzip_offline_level") == 0) {
+        int level = atoi(value);
+        if (level >= 1 && level <= 9) {
+            config->compress->offline_levels[COMPRESS_ENCODING_GZIP] = level;
+        }
+    }
+    else if (strcmp(directive, "brotli") == 0 || strcmp(directive, "zstd") == 0) {
+        compress_encoding_t encoding = strcmp(directive, "brotli") == 0 ? COMPRESS_ENCODING_BR
+                                                                         : COMPRESS_ENCODING_ZSTD;
+        config->compress->encodings[encoding] = (strcmp(value, "on") == 0);
+        if (config->compress->encodings[encoding] && !compress_encoding_supported(encoding)) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "%s encoder not compiled in, directive '%s on' ignored",
+                     compress_encoding_name(encoding), directive);
+            log_message(LOG_LEVEL_WARNING, msg);
+        }
+    }
+    else if (strcmp(directive, "brotli_comp_level") == 0 ||
+             strcmp(directive, "brotli_offline_level") == 0) {
+        int level = atoi(value);
+        if (level >= 0 && level <= 11) {
+            int *levels = strcmp(directive, "brotli_comp_level") == 0
+                              ? config->compress->levels : config->compress->offline_levels;
+            levels[COMPRESS_ENCODING_BR] = level;
+        }
+    }
+    else if (strcmp(directive, "zstd_comp_level") == 0 ||
+             strcmp(directive, "zstd_offline_level") == 0) {
+        int level = atoi(value);
+        if (level >= 1 && level <= 22) {
+            int *levels = strcmp(directive, "zstd_comp_level") == 0
+                              ? config->compress->levels : config->compress->offline_levels;
+            levels[COMPRESS_ENCODING_ZSTD] = level;
+        }
+    }
+    else if (strcmp(directive, "compress_offline_levels") == 0) {
+        config->compress->use_offline_levels = (strcmp(value, "on") == 0);
+    }
+    else if (strcmp(directive, "compress_order") == 0) {
+        if (compress_config_add_order(config->compress, value) < 0) {
+            log_message(LOG_LEVEL_WARNING, "Invalid compress_order directive");
         }
     }
     else if (strcmp(directive, "gzip_min_length") == 0) {
@@ -774,6 +862,18 @@ int handle_compression_directive(config_t *config, const char *directive, const
     else if (strcmp(directive, "gzip_vary") == 0) {
         config->compress->enable_vary = (strcmp(value, "on") == 0);
     }
+    else if (strcmp(directive, "gzip_pool_size") == 0) {
+        char *endptr;
+        long size = strtol(value, &endptr, 10);
+        if (*endptr == 'm' || *endptr == 'M') {
+            size *= 1024 * 1024;
+        } else if (*endptr == 'k' || *endptr == 'K') {
+            size *= 1024;
+        }
+        if (size >= 0) {
+            config->compress->pool_size = size;
+        }
+    }
     else if (strcmp(directive, "gzip_buffers") == 0) {
         int size = atoi(value);
         if (size > 0) {
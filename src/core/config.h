@@ -17,9 +17,19 @@ typedef struct {
   char *value;
 } directive_t;
 
-// Represents a location /path { ... } block
+// location的匹配方式，对应nginx的修饰符
+typedef enum {
+  LOCATION_MATCH_PREFIX = 0,      // location /path
+  LOCATION_MATCH_EXACT,           // location = /path
+  LOCATION_MATCH_PREFIX_NOREGEX,  // location ^~ /path：最长前缀命中时不再检查正则
+  LOCATION_MATCH_REGEX,           // location ~ pattern
+  LOCATION_MATCH_REGEX_ICASE      // location ~* pattern
+} location_match_t;
+
+// Represents a location [modifier] /path { ... } block
 typedef struct location_block {
-  char *path;
+  char *path;                // 前缀、精确路径或正则表达式
+  location_match_t match;
   directive_t *directives;
   int directive_count;
   char *proxy_pass;  // 添加proxy_pass字段
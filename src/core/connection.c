@@ -0,0 +1,502 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "connection.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <openssl/err.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "log.h"
+#include "open_file_cache.h"
+
+#define SSL_RECORD_SIZE 16384  // TLS下按单条记录大小组装待发送数据
+#define CONN_POOL_CHUNK 256        // 连接池每次扩容的槽位数量
+
+// 连接池状态（每个worker进程一份）
+static connection_t **pool_chunks = NULL;     // 槽位块，第i块保存下标[i*CHUNK, (i+1)*CHUNK)
+static int pool_chunk_count = 0;
+static connection_t *pool_free_list = NULL;
+static int pool_capacity = 0;
+static int pool_limit = 0;
+static int pool_in_use = 0;
+
+// large buffer池：空闲缓冲区的开头存放下一个空闲缓冲区的指针
+static size_t large_buffer_size = 0;
+static int large_buffer_cached_max = 0;
+static int large_buffer_cached = 0;
+static void *large_buffer_free_list = NULL;
+
+// 分配一个新块并把其中的槽位压入空闲链表
+static int connection_pool_grow(void) {
+    int slots = pool_limit - pool_capacity;
+    if (slots <= 0) return -1;
+    if (slots > CONN_POOL_CHUNK) slots = CONN_POOL_CHUNK;
+
+    connection_t *chunk = calloc(slots, sizeof(connection_t));
+    if (!chunk) {
+        log_message(LOG_LEVEL_ERROR, "Failed to grow connection pool");
+        return -1;
+    }
+
+    // 逆序压栈，使低下标槽位先被使用
+    for (int i = slots - 1; i >= 0; i--) {
+        connection_t *conn = &chunk[i];
+        conn->fd = -1;
+        conn->index = pool_capacity + i;
+        conn->ssl = NULL;
+        conn->buffer = conn->header_buffer;
+        conn->buffer_cap = sizeof(conn->header_buffer);
+        timer_node_init(&conn->timer, NULL, conn);
+        http_response_init(&conn->response);
+        conn->next_free = pool_free_list;
+        pool_free_list = conn;
+    }
+
+    pool_chunks[pool_chunk_count++] = chunk;
+    pool_capacity += slots;
+    return 0;
+}
+
+int connection_pool_init(int limit) {
+    if (limit <= 0) return -1;
+
+    int max_chunks = (limit + CONN_POOL_CHUNK - 1) / CONN_POOL_CHUNK;
+    pool_chunks = calloc(max_chunks, sizeof(connection_t *));
+    if (!pool_chunks) {
+        log_message(LOG_LEVEL_ERROR, "Failed to allocate connection pool");
+        return -1;
+    }
+    pool_chunk_count = 0;
+    pool_free_list = NULL;
+    pool_capacity = 0;
+    pool_limit = limit;
+    pool_in_use = 0;
+
+    if (connection_pool_grow() < 0) {
+        free(pool_chunks);
+        pool_chunks = NULL;
+        return -1;
+    }
+
+    char log_msg[256];
+    snprintf(log_msg, sizeof(log_msg), "Connection pool initialized with %d slots (limit %d)",
+             pool_capacity, pool_limit);
+    log_message(LOG_LEVEL_INFO, log_msg);
+    return 0;
+}
+
+connection_t *connection_pool_alloc(void) {
+    if (!pool_free_list && connection_pool_grow() < 0) {
+        return NULL;
+    }
+    connection_t *conn = pool_free_list;
+    pool_free_list = conn->next_free;
+    conn->next_free = NULL;
+    pool_in_use++;
+    return conn;
+}
+
+void connection_pool_release(connection_t *conn) {
+    conn->next_free = pool_free_list;
+    pool_free_list = conn;
+    pool_in_use--;
+}
+
+connection_t *connection_pool_get(int index) {
+    if (index < 0 || index >= pool_capacity) return NULL;
+    return &pool_chunks[index / CONN_POOL_CHUNK][index % CONN_POOL_CHUNK];
+}
+
+int connection_pool_capacity(void) {
+    return pool_capacity;
+}
+
+int connection_pool_in_use(void) {
+    return pool_in_use;
+}
+
+void connection_pool_destroy(void) {
+    for (int i = 0; i < pool_chunk_count; i++) {
+        free(pool_chunks[i]);
+    }
+    free(pool_chunks);
+    pool_chunks = NULL;
+    pool_chunk_count = 0;
+    pool_free_list = NULL;
+    pool_capacity = 0;
+    pool_limit = 0;
+    pool_in_use = 0;
+
+    while (large_buffer_free_list) {
+        void *next = *(void **)large_buffer_free_list;
+        free(large_buffer_free_list);
+        large_buffer_free_list = next;
+    }
+    large_buffer_cached = 0;
+}
+
+void conn_large_buffers_init(size_t size, int cached) {
+    large_buffer_size = size > CONN_BUFFER_SIZE ? size : 0;
+    large_buffer_cached_max = cached;
+}
+
+static char *large_buffer_alloc(void) {
+    if (large_buffer_free_list) {
+        void *buf = large_buffer_free_list;
+        large_buffer_free_list = *(void **)buf;
+        large_buffer_cached--;
+        return buf;
+    }
+    return malloc(large_buffer_size);
+}
+
+static void large_buffer_free(char *buf) {
+    if (large_buffer_cached < large_buffer_cached_max) {
+        *(void **)buf = large_buffer_free_list;
+        large_buffer_free_list = buf;
+        large_buffer_cached++;
+        return;
+    }
+    free(buf);
+}
+
+void conn_buffer_reset(connection_t *conn) {
+    if (conn->buffer != conn->header_buffer) {
+        large_buffer_free(conn->buffer);
+        conn->buffer = conn->header_buffer;
+        conn->buffer_cap = sizeof(conn->header_buffer);
+    }
+    conn->buffer_size = 0;
+    conn->buffer[0] = '\0';
+}
+
+size_t conn_reserve_buffer(connection_t *conn) {
+    size_t space = conn->buffer_cap - conn->buffer_size - 1;
+    if (space > 0) return space;
+
+    space = conn_compact_buffer(conn);
+    if (space > 0 || conn->buffer != conn->header_buffer || large_buffer_size == 0) {
+        return space;
+    }
+
+    // 请求头超出连接自带的缓冲区，换用large buffer；解析结果是相对偏移，复制后仍然有效
+    char *large = large_buffer_alloc();
+    if (!large) {
+        log_message(LOG_LEVEL_ERROR, "Failed to allocate large client header buffer");
+        return 0;
+    }
+    memcpy(large, conn->buffer, conn->buffer_size + 1);
+    conn->buffer = large;
+    conn->buffer_cap = large_buffer_size;
+    return conn->buffer_cap - conn->buffer_size - 1;
+}
+
+int conn_parse_request_frame(connection_t *conn) {
+    if (conn->request_len > 0) return 1;
+
+    const char *req = conn_request(conn);
+    size_t available = conn->buffer_size - conn->request_start;
+
+    int rc = http_parse_request(&conn->request, req, available);
+    if (rc == ANX_AGAIN) return 0;
+    if (rc == ANX_ERROR) {
+        // 格式错误的请求无法定位下一个请求的起点
+        conn_reject_request(conn, 400);
+        return 1;
+    }
+
+    size_t header_len = conn->request.header_len;
+    size_t body_len = conn->request.content_length;
+    // 先比较剩余空间再相加，过大的Content-Length不会让和回绕
+    if (conn->request.chunked || header_len > conn->buffer_cap - 1 ||
+        body_len > conn->buffer_cap - 1 - header_len) {
+        // 不解析chunked请求体；请求体超出缓冲区时也无法与后续请求区分
+        conn->request_unframed = 1;
+        conn->request_len = available;
+        return 1;
+    }
+    if (available < header_len + body_len) return 0;  // 请求体尚未收全
+
+    conn->request_len = header_len + body_len;
+    return 1;
+}
+
+void conn_reject_request(connection_t *conn, int status) {
+    conn->request_error = status;
+    conn->request_unframed = 1;
+    conn->request_len = conn->buffer_size - conn->request_start;
+}
+
+void conn_advance_request(connection_t *conn) {
+    http_response_release(&conn->response);
+    conn->requests++;
+    conn->request_start += conn->request_len;
+    conn->request_len = 0;
+    conn->request_unframed = 0;
+    conn->request_error = 0;
+    http_request_reset(&conn->request);
+    if (conn->request_start >= conn->buffer_size) {
+        // 没有流水线请求，直接复位偏移，无需清空缓冲区；large buffer归还到池中
+        conn->request_start = 0;
+        conn_buffer_reset(conn);
+    }
+}
+
+size_t conn_compact_buffer(connection_t *conn) {
+    if (conn->request_start > 0) {
+        size_t pending = conn->buffer_size - conn->request_start;
+        memmove(conn->buffer, conn->buffer + conn->request_start, pending);
+        conn->request_start = 0;
+        conn->buffer_size = pending;
+        conn->buffer[pending] = '\0';
+    }
+    return conn->buffer_cap - conn->buffer_size - 1;
+}
+
+void http_response_init(http_response_t *resp) {
+    resp->header_len = 0;
+    resp->header_sent = 0;
+    resp->body = NULL;
+    resp->body_len = 0;
+    resp->body_sent = 0;
+    resp->file_fd = -1;
+    resp->file = NULL;
+    resp->parts = NULL;
+    resp->stream = NULL;
+    resp->file_offset = 0;
+    resp->file_remaining = 0;
+    resp->keep_alive = 0;
+}
+
+void http_response_release(http_response_t *resp) {
+    if (resp->file) {
+        open_file_cache_release(resp->file);
+    } else if (resp->file_fd >= 0) {
+        close(resp->file_fd);
+    }
+    if (resp->parts) {
+        free(resp->parts);
+    } else if (resp->stream) {
+        resp->stream->free(resp->stream);
+    } else {
+        free(resp->body);
+    }
+    http_response_init(resp);
+}
+
+int http_response_set_raw(http_response_t *resp, const char *data, size_t len) {
+    if (len > sizeof(resp->header)) {
+        return -1;
+    }
+    memcpy(resp->header, data, len);
+    resp->header_len = len;
+    resp->header_sent = 0;
+    return 0;
+}
+
+int http_response_set_error(http_response_t *resp, int status) {
+    const char *reason;
+    switch (status) {
+    case 400: reason = "Bad Request"; break;
+    case 414: reason = "URI Too Long"; break;
+    case 431: reason = "Request Header Fields Too Large"; break;
+    default: status = 500; reason = "Internal Server Error"; break;
+    }
+
+    int len = snprintf(resp->header, sizeof(resp->header),
+                       "HTTP/1.1 %d %s\r\n"
+                       "Content-Type: text/plain\r\n"
+                       "Content-Length: %zu\r\n"
+                       "Connection: close\r\n\r\n"
+                       "%s",
+                       status, reason, strlen(reason), reason);
+    resp->header_len = (size_t)len;
+    resp->header_sent = 0;
+    resp->keep_alive = 0;
+    return 0;
+}
+
+int conn_ssl_handshake(connection_t *conn) {
+    ERR_clear_error();
+    int rc = SSL_do_handshake(conn->ssl);
+    if (rc == 1) return ANX_OK;
+    int err = SSL_get_error(conn->ssl, rc);
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+        return ANX_AGAIN;
+    }
+    return ANX_ERROR;
+}
+
+int http_response_fill_iov(http_response_t *resp, struct iovec *iov) {
+    int iovcnt = 0;
+    if (resp->header_sent < resp->header_len) {
+        iov[iovcnt].iov_base = resp->header + resp->header_sent;
+        iov[iovcnt].iov_len = resp->header_len - resp->header_sent;
+        iovcnt++;
+    }
+    if (resp->body_sent < resp->body_len) {
+        iov[iovcnt].iov_base = resp->body + resp->body_sent;
+        iov[iovcnt].iov_len = resp->body_len - resp->body_sent;
+        iovcnt++;
+    }
+    return iovcnt;
+}
+
+void http_response_consume(http_response_t *resp, size_t n) {
+    size_t part = ANX_MIN(n, resp->header_len - resp->header_sent);
+    resp->header_sent += part;
+    n -= part;
+
+    part = ANX_MIN(n, resp->body_len - resp->body_sent);
+    resp->body_sent += part;
+    n -= part;
+
+    part = ANX_MIN(n, resp->file_remaining);
+    resp->file_offset += part;
+    resp->file_remaining -= part;
+}
+
+int http_response_next_part(http_response_t *resp) {
+    if (resp->stream) return resp->stream->next(resp->stream, resp);
+
+    http_response_parts_t *parts = resp->parts;
+    if (!parts || parts->next >= parts->count) return 0;
+
+    const http_response_part_t *part = &parts->parts[parts->next++];
+    resp->body = parts->text + part->prefix_off;
+    resp->body_len = part->prefix_len;
+    resp->body_sent = 0;
+    resp->file_offset = part->offset;
+    resp->file_remaining = part->len;
+    return 1;
+}
+
+ssize_t conn_recv(connection_t *conn, void *buf, size_t len) {
+    if (conn->ssl) {
+        ERR_clear_error();  // SSL_get_error依赖线程错误队列，先清除残留错误
+        int n = SSL_read(conn->ssl, buf, (int)len);
+        if (n > 0) return n;
+        int err = SSL_get_error(conn->ssl, n);
+        if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+            return ANX_AGAIN;
+        }
+        if (err == SSL_ERROR_ZERO_RETURN) {
+            return 0;
+        }
+        return ANX_ERROR;
+    }
+
+    ssize_t n = recv(conn->fd, buf, len, 0);
+    if (n >= 0) return n;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        return ANX_AGAIN;
+    }
+    return ANX_ERROR;
+}
+
+ssize_t conn_send(connection_t *conn, const void *buf, size_t len) {
+    if (conn->ssl) {
+        ERR_clear_error();
+        int n = SSL_write(conn->ssl, buf, (int)len);
+        if (n > 0) return n;
+        int err = SSL_get_error(conn->ssl, n);
+        if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+            return ANX_AGAIN;
+        }
+        return ANX_ERROR;
+    }
+
+    ssize_t n = send(conn->fd, buf, len, MSG_NOSIGNAL);
+    if (n >= 0) return n;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        return ANX_AGAIN;
+    }
+    return ANX_ERROR;
+}
+
+// 明文连接的聚集写；more表示后面还有文件数据，暂不推送不满的报文段
+static ssize_t conn_sendv(connection_t *conn, struct iovec *iov, int iovcnt, int more) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    ssize_t n = sendmsg(conn->fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+    if (n >= 0) return n;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        return ANX_AGAIN;
+    }
+    return ANX_ERROR;
+}
+
+// TLS连接：把响应链的前缀组装成一条记录，头部、小响应体和文件开头合并为一次SSL_write
+// 重试时从相同的偏移重新组装，数据一致，配合SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER
+static ssize_t conn_gather_record(http_response_t *resp, char *record, size_t cap) {
+    struct iovec iov[2];
+    int iovcnt = http_response_fill_iov(resp, iov);
+    size_t len = 0;
+
+    for (int i = 0; i < iovcnt && len < cap; i++) {
+        size_t n = ANX_MIN(iov[i].iov_len, cap - len);
+        memcpy(record + len, iov[i].iov_base, n);
+        len += n;
+    }
+    if (len < cap && resp->file_remaining > 0) {
+        size_t want = ANX_MIN(cap - len, resp->file_remaining);
+        ssize_t got = pread(resp->file_fd, record + len, want, resp->file_offset);
+        if (got <= 0) return ANX_ERROR;  // 读文件失败或文件被截断
+        len += (size_t)got;
+    }
+    return (ssize_t)len;
+}
+
+int conn_flush_response(connection_t *conn) {
+    http_response_t *resp = &conn->response;
+
+    for (;;) {
+        struct iovec iov[2];
+        int iovcnt = http_response_fill_iov(resp, iov);
+        if (iovcnt == 0 && resp->file_remaining == 0) {
+            int more = http_response_next_part(resp);
+            if (more < 0) return ANX_ERROR;
+            if (more) continue;
+            break;
+        }
+
+        ssize_t n;
+        if (conn->ssl) {
+            char record[SSL_RECORD_SIZE];
+            ssize_t len = conn_gather_record(resp, record, sizeof(record));
+            if (len < 0) return ANX_ERROR;
+            n = conn_send(conn, record, (size_t)len);
+        } else if (iovcnt > 0) {
+            n = conn_sendv(conn, iov, iovcnt, resp->file_remaining > 0);
+        } else {
+            // 文件区间走sendfile零拷贝，偏移统一由http_response_consume推进
+            off_t offset = resp->file_offset;
+            n = sendfile(conn->fd, resp->file_fd, &offset, resp->file_remaining);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return ANX_AGAIN;
+                return ANX_ERROR;
+            }
+            if (n == 0) return ANX_ERROR;  // 文件被截断
+        }
+        if (n < 0) return (int)n;
+
+        http_response_consume(resp, (size_t)n);
+        if (resp->header_sent == resp->header_len) {
+            conn->state = CONN_STATE_SENDING_BODY;
+        }
+    }
+
+    conn->state = resp->keep_alive ? CONN_STATE_KEEPALIVE : CONN_STATE_CLOSING;
+    return ANX_OK;
+}
@@ -0,0 +1,171 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <arpa/inet.h>
+#include <openssl/ssl.h>
+#include <sys/uio.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "timer.h"
+#include "http_parser.h"
+
+#define CONN_BUFFER_SIZE 8192          // 连接自带的请求缓冲区大小，请求头更大时换用large buffer
+#define RESPONSE_HEADER_SIZE 4096      // 响应头缓冲区大小
+
+// 连接状态机：完全由EPOLLIN/EPOLLOUT就绪事件驱动
+typedef enum {
+    CONN_STATE_READING_HEADERS = 0,  // 读取请求头，直到收到"\r\n\r\n"
+    CONN_STATE_ROUTING,              // 请求头完整，路由并生成响应
+    CONN_STATE_WRITING_HEADERS,      // 发送响应头（可能被EAGAIN打断）
+    CONN_STATE_SENDING_BODY,         // 发送响应体（内存或文件）
+    CONN_STATE_KEEPALIVE,            // 响应完成，准备接收下一个请求
+    CONN_STATE_CLOSING,              // 响应完成后关闭连接
+    CONN_STATE_LINGERING,            // 已发送FIN，排空对端数据后再关闭
+    CONN_STATE_SSL_HANDSHAKE         // TLS握手进行中，由读写就绪事件推进
+} conn_state_t;
+
+// multipart/byteranges响应的一个部分：分隔行和部分头（内存）后跟一个文件区间
+typedef struct {
+    size_t prefix_off;         // 在text中的偏移
+    size_t prefix_len;
+    off_t offset;
+    size_t len;                // 0表示只有前缀（结尾的分隔行）
+} http_response_part_t;
+
+// 当前链发送完毕后依次装入的后续部分，与text在同一次分配中
+typedef struct {
+    int count;
+    int next;                  // 下一个待装入的部分
+    char *text;
+    http_response_part_t parts[];
+} http_response_parts_t;
+
+typedef struct http_response http_response_t;
+
+// 流式生成的响应体（如实时压缩），当前链发送完毕时生成下一段
+typedef struct http_body_stream {
+    // 把下一段数据装入resp（内存响应体，由流持有）；返回1表示装入了数据，0表示结束，-1表示出错
+    int (*next)(struct http_body_stream *stream, http_response_t *resp);
+    void (*free)(struct http_body_stream *stream);
+} http_body_stream_t;
+
+// 待发送的响应链：头部缓冲区 -> 可选的内存响应体 -> 可选的文件区间，按顺序发送
+// 头部与内存响应体用一次writev/sendmsg发出，后面跟文件时带MSG_MORE，与sendfile的数据合并成段
+struct http_response {
+    char header[RESPONSE_HEADER_SIZE];
+    size_t header_len;
+    size_t header_sent;
+
+    char *body;                // 内存响应体（由响应持有，发送完毕后释放）
+    size_t body_len;
+    size_t body_sent;
+
+    int file_fd;               // 文件响应体，-1表示无
+    struct open_file *file;    // file_fd来自open_file_cache时持有的引用，释放时归还而不关闭fd
+    http_response_parts_t *parts;  // 多区间响应的后续部分，此时body指向parts->text内部
+    http_body_stream_t *stream;    // 流式响应体，此时body指向流的缓冲区
+    off_t file_offset;         // 下一次发送的文件偏移
+    size_t file_remaining;     // 剩余待发送的文件字节数
+
+    int keep_alive;            // 发送完成后是否保持连接
+};
+
+// Connection state structure
+typedef struct connection_t {
+    int fd;
+    int index;                        // 连接池中的槽位下标，分配后保持不变
+    struct connection_t *next_free;   // 空闲链表指针，仅在槽位空闲时有效
+    conn_state_t state;
+    char client_ip[INET_ADDRSTRLEN];
+    timer_node_t timer;               // 当前阶段的超时定时器（请求头/keepalive/发送/延迟关闭）
+    char *buffer;                     // 当前请求缓冲区：header_buffer或从池中取得的large buffer
+    size_t buffer_cap;                // buffer的容量（含结尾'\0'）
+    size_t buffer_size;
+    char header_buffer[CONN_BUFFER_SIZE];
+    size_t request_start;             // 当前请求在buffer中的偏移，流水线请求依次向后推进
+    size_t request_len;               // 当前请求的总长度（请求头+请求体），0表示尚未完整
+    int request_unframed;             // 请求体无法在buffer中定界（chunked或过大），响应后关闭
+    int request_error;                // 请求无法处理时的状态码（400格式错误/431请求头过大），回复后关闭
+    http_request_t request;           // 当前请求的解析结果，切片相对于request_start
+    int requests;                     // 本连接已完成的请求数（keepalive_requests）
+    int is_https;
+    int local_port;                   // 接受该连接的监听端口，用于选择server块
+    SSL* ssl;
+    http_response_t response;
+} connection_t;
+
+// 连接池：按块增长的slab + 空闲链表，分配与释放均为O(1)
+// 槽位一旦分配不会移动，可以安全地把指针交给epoll
+int connection_pool_init(int limit);         // limit即worker_connections
+connection_t *connection_pool_alloc(void);   // 池满时返回NULL
+void connection_pool_release(connection_t *conn);
+connection_t *connection_pool_get(int index);  // 按槽位下标查找，越界返回NULL
+int connection_pool_capacity(void);          // 已分配的槽位数量
+int connection_pool_in_use(void);            // 正在使用的槽位数量
+void connection_pool_destroy(void);
+
+// large_client_header_buffers：请求头超出CONN_BUFFER_SIZE时从池中换用size字节的缓冲区，
+// 池中最多缓存cached个空闲缓冲区，其余释放回系统；size为0表示不扩容
+void conn_large_buffers_init(size_t size, int cached);
+
+// 让连接使用自带的缓冲区并归还large buffer（新连接、关闭连接时调用）
+void conn_buffer_reset(connection_t *conn);
+
+// 为接收数据准备空间：先整理缓冲区，仍然没有空间时换用large buffer
+// 返回可用空间，0表示请求头已达到上限
+size_t conn_reserve_buffer(connection_t *conn);
+
+// 当前请求的起始地址
+static inline char *conn_request(connection_t *conn) {
+    return conn->buffer + conn->request_start;
+}
+
+// 检查buffer中从request_start开始是否已有一个完整请求（请求头+Content-Length请求体）
+// 解析在多次读取之间增量进行，每个字节只检查一次；请求头完整时解析结果写入conn->request
+// 返回1表示完整（设置request_len），0表示需要更多数据
+int conn_parse_request_frame(connection_t *conn);
+
+// 请求头超出上限：当前缓冲区内容作为一个请求，由route_request回复431
+void conn_reject_request(connection_t *conn, int status);
+
+// 当前请求处理完毕：释放响应并把request_start推进到下一个（流水线）请求
+void conn_advance_request(connection_t *conn);
+
+// 将未处理的数据移到buffer开头，返回可用空间（保留结尾的'\0'）
+size_t conn_compact_buffer(connection_t *conn);
+
+// 初始化/释放响应（关闭文件、释放内存响应体）
+void http_response_init(http_response_t *resp);
+void http_response_release(http_response_t *resp);
+
+// 用一段完整的原始响应（头部+正文）填充响应
+int http_response_set_raw(http_response_t *resp, const char *data, size_t len);
+
+// 无法处理的请求的简短错误响应（400/414/431等），总是关闭连接
+int http_response_set_error(http_response_t *resp, int status);
+
+// 填充响应链中尚未发送的内存部分（头部、内存响应体），返回使用的iovec数量（最多2个）
+int http_response_fill_iov(http_response_t *resp, struct iovec *iov);
+
+// 按链的顺序标记n字节已发送（头部 -> 内存响应体 -> 文件区间）
+void http_response_consume(http_response_t *resp, size_t n);
+
+// 当前链已发送完毕时装入下一段：multipart的下一个部分（内存响应体和文件区间）或流式响应体的下一块
+// 返回1表示装入了数据，0表示响应已结束，-1表示生成失败（应关闭连接）
+int http_response_next_part(http_response_t *resp);
+
+// 推进非阻塞TLS握手：ANX_OK表示完成，ANX_AGAIN表示等待就绪事件，ANX_ERROR表示失败
+int conn_ssl_handshake(connection_t *conn);
+
+// 非阻塞读取：返回读取字节数，0表示对端关闭，ANX_AGAIN表示需要等待，ANX_ERROR表示出错
+ssize_t conn_recv(connection_t *conn, void *buf, size_t len);
+
+// 非阻塞写入：返回写入字节数，ANX_AGAIN表示需要等待EPOLLOUT，ANX_ERROR表示出错
+ssize_t conn_send(connection_t *conn, const void *buf, size_t len);
+
+// 尽可能多地发送待发送响应
+// 返回ANX_OK表示发送完毕，ANX_AGAIN表示需要等待EPOLLOUT，ANX_ERROR表示出错
+int conn_flush_response(connection_t *conn);
+
+#endif  // CONNECTION_H
@@ -15,99 +15,70 @@
 
 route_t find_route(const core_config_t *core_conf, const char *host,
                    const char *uri, int port) {
-  route_t route = {NULL, NULL};
-  if (!core_conf || !core_conf->raw_config || !core_conf->raw_config->http || !core_conf->raw_config->http->servers) {
-    return route;
+  if (!core_conf || !core_conf->routes) {
+    route_t none = {NULL, NULL, NULL};
+    return none;
   }
+  return route_table_lookup(core_conf->routes, port, host, uri);
+}
 
-  // 1. Find the matching server block by host AND port
-  server_block_t *matched_server = NULL;
-  server_block_t *default_server = NULL;
-  
-  for (server_block_t *srv = core_conf->raw_config->http->servers; srv; srv = srv->next) {
-    // Check if this server listens on the requested port
-    bool listens_on_port = false;
-    for (int i = 0; i < srv->directive_count; i++) {
-      if (strcmp(srv->directives[i].key, "listen") == 0) {
-        char *value_copy = strdup(srv->directives[i].value);
-        if (value_copy) {
-          char *token = strtok(value_copy, " ");
-          int listen_port = token ? atoi(token) : 0;
-          
-          if (listen_port == port) {
-            listens_on_port = true;
-            if (!default_server) {
-              default_server = srv; // First server listening on this port is default
-            }
-          }
-          free(value_copy);
-        }
-      }
-    }
-    
-    if (listens_on_port) {
-      const char *server_name = get_directive_value("server_name", srv->directives, srv->directive_count);
-      if (host && server_name && strcmp(host, server_name) == 0) {
-        matched_server = srv;
-        break;
-      }
-    }
-  }
+// Parses a time value such as "60", "60s", "500ms" or "2m" into milliseconds.
+static int parse_timeout_ms(const char *value, int default_ms) {
+  if (!value) return default_ms;
 
-  if (!matched_server) {
-    matched_server = default_server;
-  }
-  
-  if (!matched_server) {
-    // Fallback to the very first server if no port matches
-    matched_server = core_conf->raw_config->http->servers;
-  }
-  
-  route.server = matched_server;
-
-  // 2. Find the best matching location block within that server
-  if (matched_server && uri) {
-    location_block_t *best_match = NULL;
-    size_t best_match_len = 0;
-
-    // Debug: log the available locations
-    char log_msg[256];
-    snprintf(log_msg, sizeof(log_msg), "DEBUG: Looking for location match for URI: %s on port %d", uri, port);
-    log_message(LOG_LEVEL_DEBUG, log_msg);
-
-    for (location_block_t *loc = matched_server->locations; loc; loc = loc->next) {
-      if (loc->path) {
-        size_t loc_path_len = strlen(loc->path);
-        snprintf(log_msg, sizeof(log_msg), "DEBUG: Checking location: %s (len=%zu)", loc->path, loc_path_len);
-        log_message(LOG_LEVEL_DEBUG, log_msg);
-        
-        if (strncmp(uri, loc->path, loc_path_len) == 0) {
-          // It's a prefix match. Is it the best one so far?
-          snprintf(log_msg, sizeof(log_msg), "DEBUG: Location %s matches URI %s", loc->path, uri);
-          log_message(LOG_LEVEL_DEBUG, log_msg);
-          
-          if (loc_path_len > best_match_len) {
-            best_match = loc;
-            best_match_len = loc_path_len;
-            snprintf(log_msg, sizeof(log_msg), "DEBUG: New best match: %s (len=%zu)", loc->path, loc_path_len);
-            log_message(LOG_LEVEL_DEBUG, log_msg);
-          }
-        }
-      }
-    }
-    
-    if (best_match) {
-      snprintf(log_msg, sizeof(log_msg), "DEBUG: Final location match: %s", best_match->path);
-      log_message(LOG_LEVEL_DEBUG, log_msg);
-    } else {
-      snprintf(log_msg, sizeof(log_msg), "DEBUG: No location matched for URI: %s", uri);
-      log_message(LOG_LEVEL_DEBUG, log_msg);
-    }
-    
-    route.location = best_match;
-  }
+  char *end = NULL;
+  long n = strtol(value, &end, 10);
+  if (end == value || n < 0) return default_ms;
+
+  if (strncmp(end, "ms", 2) == 0) return (int)n;
+  if (*end == 'm') return (int)(n * 60000);
+  return (int)(n * 1000);  // 默认单位为秒
+}
 
-  return route;
+// Parses a size such as "65536", "64k" or "1m" into bytes.
+static int parse_size(const char *value) {
+  char *end = NULL;
+  long n = strtol(value, &end, 10);
+  if (end == value || n < 0) return 0;
+
+  if (*end == 'k' || *end == 'K') return (int)(n * 1024);
+  if (*end == 'm' || *end == 'M') return (int)(n * 1024 * 1024);
+  return (int)n;
+}
+
+void listening_socket_init(listening_socket_t *sock, int port) {
+  memset(sock, 0, sizeof(*sock));
+  sock->fd = -1;
+  sock->port = port;
+  sock->backlog = LISTEN_DEFAULT_BACKLOG;
+}
+
+// Applies one "listen" parameter such as "ssl", "backlog=511" or "fastopen=256".
+static void parse_listen_param(listening_socket_t *sock, const char *token) {
+  if (strcmp(token, "ssl") == 0) {
+    sock->is_ssl = 1;
+  } else if (strcmp(token, "reuseport") == 0) {
+    sock->reuseport = 1;
+  } else if (strcmp(token, "deferred") == 0) {
+    sock->deferred = 1;
+  } else if (strncmp(token, "backlog=", 8) == 0) {
+    int backlog = atoi(token + 8);
+    if (backlog > 0) sock->backlog = backlog;
+  } else if (strncmp(token, "fastopen=", 9) == 0) {
+    sock->fastopen = atoi(token + 9);
+  } else if (strncmp(token, "rcvbuf=", 7) == 0) {
+    sock->rcvbuf = parse_size(token + 7);
+  } else if (strncmp(token, "sndbuf=", 7) == 0) {
+    sock->sndbuf = parse_size(token + 7);
+  } else if (strncmp(token, "so_busy_poll=", 13) == 0) {
+    sock->busy_poll = atoi(token + 13);
+  } else if (strcmp(token, "default_server") == 0) {
+    // 由路由表处理，与socket选项无关
+  } else {
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Unknown listen parameter: %s", token);
+    log_message(LOG_LEVEL_WARNING, msg);
+  }
 }
 
 core_config_t *create_core_config(config_t *parsed_config) {
@@ -221,11 +192,137 @@ core_config_t *create_core_config(config_t *parsed_config) {
       parsed_config->http->directive_count);
   core_conf->worker_processes = workers_val ? atoi(workers_val) : 2; // Default 2
 
+  const char *connections_val = get_directive_value(
+      "worker_connections", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  core_conf->worker_connections = connections_val ? atoi(connections_val) : 1024;
+  if (core_conf->worker_connections <= 0) core_conf->worker_connections = 1024;
+
+  core_conf->client_header_timeout = parse_timeout_ms(get_directive_value(
+      "client_header_timeout", parsed_config->http->directives,
+      parsed_config->http->directive_count), 60000);
+  core_conf->keepalive_timeout = parse_timeout_ms(get_directive_value(
+      "keepalive_timeout", parsed_config->http->directives,
+      parsed_config->http->directive_count), 75000);
+  const char *requests_val = get_directive_value(
+      "keepalive_requests", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  core_conf->keepalive_requests = requests_val ? atoi(requests_val) : 1000;
+  if (core_conf->keepalive_requests <= 0) core_conf->keepalive_requests = 1000;
+  core_conf->send_timeout = parse_timeout_ms(get_directive_value(
+      "send_timeout", parsed_config->http->directives,
+      parsed_config->http->directive_count), 60000);
+
+  // large_client_header_buffers <number> <size>，默认4 32k
+  core_conf->large_header_buffers = 4;
+  core_conf->large_header_buffer_size = 32 * 1024;
+  const char *large_val = get_directive_value(
+      "large_client_header_buffers", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  if (large_val) {
+    char number[32], size[32];
+    if (sscanf(large_val, "%31s %31s", number, size) == 2 && atoi(number) >= 0 &&
+        parse_size(size) > 0) {
+      core_conf->large_header_buffers = atoi(number);
+      core_conf->large_header_buffer_size = (size_t)parse_size(size);
+    } else {
+      log_message(LOG_LEVEL_WARNING, "Invalid large_client_header_buffers, using 4 32k");
+    }
+  }
+
+  // open_file_cache off | max=N [inactive=time]，默认关闭
+  core_conf->open_file_cache_max = 0;
+  core_conf->open_file_cache_inactive = 60000;
+  const char *ofc_val = get_directive_value(
+      "open_file_cache", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  if (ofc_val && strcmp(ofc_val, "off") != 0) {
+    char *value_copy = strdup(ofc_val);
+    char *save = NULL;
+    for (char *token = value_copy ? strtok_r(value_copy, " ", &save) : NULL; token;
+         token = strtok_r(NULL, " ", &save)) {
+      if (strncmp(token, "max=", 4) == 0) {
+        core_conf->open_file_cache_max = atoi(token + 4);
+      } else if (strncmp(token, "inactive=", 9) == 0) {
+        core_conf->open_file_cache_inactive = parse_timeout_ms(token + 9, 60000);
+      }
+    }
+    free(value_copy);
+    if (core_conf->open_file_cache_max <= 0) {
+      log_message(LOG_LEVEL_WARNING, "open_file_cache requires max=N, disabled");
+      core_conf->open_file_cache_max = 0;
+    }
+  }
+  core_conf->open_file_cache_valid = parse_timeout_ms(get_directive_value(
+      "open_file_cache_valid", parsed_config->http->directives,
+      parsed_config->http->directive_count), 60000);
+  const char *ofc_errors_val = get_directive_value(
+      "open_file_cache_errors", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  core_conf->open_file_cache_errors = ofc_errors_val && strcmp(ofc_errors_val, "on") == 0;
+
+  // precompress on|off、precompress_threads N、precompress_interval time、
+  // cache_warmup on|off、cache_warmup_timeout time
+  const char *precompress_val = get_directive_value(
+      "precompress", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  core_conf->precompress = precompress_val && strcmp(precompress_val, "on") == 0;
+  const char *precompress_threads_val = get_directive_value(
+      "precompress_threads", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  core_conf->precompress_threads = precompress_threads_val ? atoi(precompress_threads_val) : 1;
+  if (core_conf->precompress_threads < 1 || core_conf->precompress_threads > 64) {
+    log_message(LOG_LEVEL_WARNING, "Invalid precompress_threads, using 1");
+    core_conf->precompress_threads = 1;
+  }
+  core_conf->precompress_interval = parse_timeout_ms(get_directive_value(
+      "precompress_interval", parsed_config->http->directives,
+      parsed_config->http->directive_count), 60000);
+  const char *warmup_val = get_directive_value(
+      "cache_warmup", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  core_conf->cache_warmup = warmup_val && strcmp(warmup_val, "on") == 0;
+  core_conf->cache_warmup_timeout = parse_timeout_ms(get_directive_value(
+      "cache_warmup_timeout", parsed_config->http->directives,
+      parsed_config->http->directive_count), 30000);
+
+  const char *engine_val = get_directive_value(
+      "event_engine", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  core_conf->event_engine = engine_val && strcmp(engine_val, "io_uring") == 0
+                                ? EVENT_ENGINE_IO_URING : EVENT_ENGINE_EPOLL;
+
+  const char *affinity_val = get_directive_value(
+      "worker_cpu_affinity", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  core_conf->worker_cpu_affinity = affinity_val && strcmp(affinity_val, "auto") == 0;
+
+  const char *bpf_val = get_directive_value(
+      "reuseport_bpf", parsed_config->http->directives,
+      parsed_config->http->directive_count);
+  core_conf->reuseport_bpf = bpf_val && strcmp(bpf_val, "on") == 0;
+
   // 2. Iterate over server blocks to find all 'listen' directives
   server_block_t *srv = parsed_config->http->servers;
   while (srv) {
     for (int i = 0; i < srv->directive_count; i++) {
       if (strcmp(srv->directives[i].key, "listen") == 0) {
+        // Properly parse "listen" directive, e.g., "80", "443 ssl" or "80 reuseport deferred backlog=4096"
+        char *value_copy = strdup(srv->directives[i].value);
+        char *token = strtok(value_copy, " ");
+        int port = token ? atoi(token) : 0;
+
+        // 多个server监听同一端口时共用一个socket，按Host由路由表选择server；
+        // socket参数以该端口第一次出现的listen为准
+        bool seen = false;
+        for (int j = 0; j < core_conf->listening_socket_count; j++) {
+          if (core_conf->listening_sockets[j].port == port) seen = true;
+        }
+        if (seen) {
+          free(value_copy);
+          continue;
+        }
+
         core_conf->listening_socket_count++;
         core_conf->listening_sockets = realloc(
             core_conf->listening_sockets,
@@ -233,18 +330,12 @@ core_config_t *create_core_config(config_t *parsed_config) {
         
         listening_socket_t *sock = &core_conf->listening_sockets[core_conf->listening_socket_count - 1];
         
-        // Properly parse "listen" directive, e.g., "80" or "443 ssl"
-        char *value_copy = strdup(srv->directives[i].value);
-        char *token = strtok(value_copy, " ");
-        
-        sock->port = token ? atoi(token) : 0;
-        sock->is_ssl = 0;
-        sock->ssl_certificate = NULL;
-        sock->ssl_certificate_key = NULL;
-
-        token = strtok(NULL, " ");
-        if(token && strcmp(token, "ssl") == 0) {
-            sock->is_ssl = 1;
+        listening_socket_init(sock, port);
+
+        while ((token = strtok(NULL, " ")) != NULL) {
+            parse_listen_param(sock, token);
+        }
+        if(sock->is_ssl) {
             // If it's an SSL socket, find the certs in the same server block
             const char* cert_path = get_directive_value("ssl_certificate", srv->directives, srv->directive_count);
             const char* key_path = get_directive_value("ssl_certificate_key", srv->directives, srv->directive_count);
@@ -255,12 +346,20 @@ core_config_t *create_core_config(config_t *parsed_config) {
         free(value_copy);
         
         // We create the actual socket FD later
-        sock->fd = -1;
       }
     }
     srv = srv->next;
   }
 
+  // 3. Compile the server/location route table
+  core_conf->routes = route_table_create(parsed_config);
+  if (!core_conf->routes) {
+    log_message(LOG_LEVEL_ERROR, "Failed to compile route table");
+    core_conf->raw_config = NULL;  // 由调用者释放
+    free_core_config(core_conf);
+    return NULL;
+  }
+
   return core_conf;
 }
 
@@ -271,6 +370,10 @@ void free_core_config(core_config_t *core_config) {
         for (int i = 0; i < core_config->listening_socket_count; i++) {
             free(core_config->listening_sockets[i].ssl_certificate);
             free(core_config->listening_sockets[i].ssl_certificate_key);
+            free(core_config->listening_sockets[i].worker_fds);
+            if (core_config->listening_sockets[i].ssl_ctx) {
+                SSL_CTX_free(core_config->listening_sockets[i].ssl_ctx);
+            }
         }
         free(core_config->listening_sockets);
     }
@@ -293,6 +396,8 @@ void free_core_config(core_config_t *core_config) {
         lb_config_free(core_config->lb_config);
     }
     
+    route_table_free(core_config->routes);
+
     if (core_config->raw_config) {
         free_config(core_config->raw_config);
     }
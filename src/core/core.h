@@ -5,6 +5,7 @@
 #include "config.h"
 #include "cache.h"
 #include "load_balancer.h"
+#include "route.h"
 
 // 前向声明
 typedef struct lb_config lb_config_t;
@@ -16,16 +17,53 @@ typedef struct {
   int is_ssl;
   char *ssl_certificate;
   char *ssl_certificate_key;
+  int reuseport;    // "listen 80 reuseport": 每个worker一个独立的监听socket
+  int *worker_fds;  // reuseport模式下按worker序号保存的监听socket
+  int backlog;      // backlog=N: listen队列长度
+  int fastopen;     // fastopen=N: TCP_FASTOPEN队列长度，0表示关闭
+  int deferred;     // deferred: TCP_DEFER_ACCEPT，数据到达后才唤醒worker
+  int rcvbuf;       // rcvbuf=size: SO_RCVBUF，0表示系统默认
+  int sndbuf;       // sndbuf=size: SO_SNDBUF，0表示系统默认
+  int busy_poll;    // so_busy_poll=N: SO_BUSY_POLL忙轮询时间（微秒），0表示关闭
+  SSL_CTX *ssl_ctx; // ssl监听使用的证书上下文（持有一个引用）
 } listening_socket_t;
 
+#define LISTEN_DEFAULT_BACKLOG 1024
+
+// Event notification backend used by the worker loop ("event_engine")
+typedef enum {
+  EVENT_ENGINE_EPOLL = 0,
+  EVENT_ENGINE_IO_URING
+} event_engine_t;
+
 // Contains the core, processed configuration needed for the server to run.
 typedef struct {
   int worker_processes;
+  event_engine_t event_engine;  // event_engine io_uring|epoll，io_uring不可用时回退到epoll
+  int worker_connections;   // 每个worker的最大连接数，连接池按需增长到该上限
+  int client_header_timeout;  // 读取完整请求头的超时（毫秒）
+  int keepalive_timeout;      // keepalive连接等待下一个请求的超时（毫秒），0表示禁用keepalive
+  int keepalive_requests;     // 单个keepalive连接最多处理的请求数
+  int send_timeout;           // 两次成功写之间的最长间隔（毫秒）
+  int large_header_buffers;       // large_client_header_buffers的数量：每个worker缓存的空闲large buffer数
+  size_t large_header_buffer_size;  // large_client_header_buffers的大小：请求头的上限
+  int open_file_cache_max;       // open_file_cache max=N：每个worker缓存的打开文件数，0表示关闭
+  int open_file_cache_inactive;  // open_file_cache inactive=time：期间未被使用的条目被淘汰（毫秒）
+  int open_file_cache_valid;     // open_file_cache_valid：条目按路径重新校验的间隔（毫秒）
+  int open_file_cache_errors;    // open_file_cache_errors on：同时缓存文件不存在等查找失败
+  int precompress;            // precompress on：后台为开启*_static的location生成缺少或过期的预压缩文件
+  int precompress_threads;    // 预压缩和缓存预热使用的线程数
+  int precompress_interval;   // 重新扫描文档根目录的间隔（毫秒），0表示只在启动时扫描一次
+  int cache_warmup;           // cache_warmup on：fork worker之前把root下的小文件读入响应缓存
+  int cache_warmup_timeout;   // 缓存预热的最长时间（毫秒），超过后带着已装入的内容启动，0表示不限
+  int worker_cpu_affinity;  // worker_cpu_affinity auto: 按worker序号绑定CPU
+  int reuseport_bpf;        // reuseport_bpf on: 按CPU分发reuseport连接
   listening_socket_t *listening_sockets;
   int listening_socket_count;
   // A pointer back to the raw parsed config tree
   config_t *raw_config;
-  // We can add pointers to processed virtual host configs here later
+  // 加载时编译的server/location路由表，find_route只在这里查找
+  route_table_t *routes;
   
   // 缓存管理器
   cache_manager_t *cache_manager;
@@ -34,12 +72,6 @@ typedef struct {
   lb_config_t *lb_config;
 } core_config_t;
 
-// This struct holds the result of a routing decision.
-typedef struct {
-  server_block_t *server;
-  location_block_t *location; // NULL if no specific location matches
-} route_t;
-
 // Finds the best matching server and location block for a given request.
 route_t find_route(const core_config_t *core_conf, const char *host,
                    const char *uri, int port);
@@ -50,4 +82,7 @@ core_config_t *create_core_config(config_t *parsed_config);
 // Frees all resources associated with the core config
 void free_core_config(core_config_t *core_config);
 
+// Initializes a listener for the given port with default socket options.
+void listening_socket_init(listening_socket_t *sock, int port);
+
 #endif  // CORE_H 
\ No newline at end of file
@@ -0,0 +1,805 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "event_uring.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "connection.h"
+#include "log.h"
+#include "net.h"
+#include "timer.h"
+
+#define URING_ENTRIES 1024        // 提交队列深度
+#define URING_BUF_GROUP 0         // 接收缓冲区组ID
+#define URING_BUF_COUNT 512       // 接收缓冲区数量（必须是2的幂）
+#define URING_BUF_SIZE 4096       // 单个接收缓冲区大小
+#define URING_SPLICE_CHUNK 65536  // 单次splice的最大字节数（默认管道容量）
+#define URING_OVERFLOW_MAX 65536  // 发送响应期间暂存的流水线数据上限
+#define URING_IOWQ_MAX_UNBOUND 64 // 每个worker的io-wq中执行socket splice的内核线程上限
+
+// user_data编码：高8位为操作类型，低32位为连接槽位下标（accept为监听数组下标）
+enum {
+    URING_OP_ACCEPT = 1,
+    URING_OP_RECV,
+    URING_OP_POLL,
+    URING_OP_SEND,
+    URING_OP_SPLICE_IN,
+    URING_OP_SPLICE_OUT,
+    URING_OP_CANCEL
+};
+#define URING_UDATA(op, index) (((uint64_t)(op) << 56) | (uint32_t)(index))
+#define URING_UDATA_OP(data) ((int)((data) >> 56))
+#define URING_UDATA_INDEX(data) ((int)(uint32_t)(data))
+
+// 不依赖liburing的最小ring封装
+typedef struct {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    size_t sqes_size;
+    unsigned sq_entries;
+    unsigned sqe_tail;       // 已填充的SQE
+    unsigned sqe_submitted;  // 已提交给内核的SQE
+
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    unsigned short buf_tail;
+    char *bufs;
+} uring_t;
+
+// io_uring后端的每连接状态，按连接槽位下标索引
+typedef struct {
+    struct msghdr msg;     // sendmsg在完成前必须保持有效
+    struct iovec iov[2];
+    int pipe_fds[2];       // 文件发送使用的管道
+    size_t pipe_pending;   // 已进入管道、尚未写入socket的字节
+    size_t splice_len;     // 本轮从文件读入管道的请求长度
+    int inflight;          // 尚未完成的请求数（multishot请求在终止前算一个）
+    int closing;           // 已开始关闭，等待所有请求完成后释放
+    char *overflow;        // multishot recv在连接缓冲区满时收到的后续请求数据
+    size_t overflow_len;
+} uring_conn_t;
+
+static uring_t ring;
+static uring_conn_t *uring_conns = NULL;
+static core_config_t *uring_conf = NULL;
+static listening_socket_t *uring_listeners = NULL;
+
+static void uring_close_connection(connection_t *conn);
+static void uring_send_response(connection_t *conn);
+static void uring_process_request(connection_t *conn);
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                              unsigned flags, void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void uring_buf_recycle(unsigned short bid) {
+    struct io_uring_buf *buf = &ring.buf_ring->bufs[ring.buf_tail & (URING_BUF_COUNT - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(ring.bufs + (size_t)bid * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+    ring.buf_tail++;
+    __atomic_store_n(&ring.buf_ring->tail, ring.buf_tail, __ATOMIC_RELEASE);
+}
+
+static void uring_teardown(void) {
+    if (ring.buf_ring) munmap(ring.buf_ring, ring.buf_ring_size);
+    free(ring.bufs);
+    if (ring.sqes) munmap(ring.sqes, ring.sqes_size);
+    if (ring.cq_ptr && ring.cq_ptr != ring.sq_ptr) munmap(ring.cq_ptr, ring.cq_size);
+    if (ring.sq_ptr) munmap(ring.sq_ptr, ring.sq_size);
+    if (ring.fd >= 0) close(ring.fd);
+    memset(&ring, 0, sizeof(ring));
+    ring.fd = -1;
+}
+
+// 创建ring并注册接收缓冲区；要求Linux 6.0+（multishot recv）
+static int uring_setup(void) {
+    struct io_uring_params p;
+
+    memset(&ring, 0, sizeof(ring));
+    memset(&p, 0, sizeof(p));
+    // 只有本线程提交，且在io_uring_enter时统一处理完成任务
+    p.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
+    ring.fd = sys_io_uring_setup(URING_ENTRIES, &p);
+    if (ring.fd < 0 && errno == EINVAL) {
+        memset(&p, 0, sizeof(p));
+        ring.fd = sys_io_uring_setup(URING_ENTRIES, &p);
+    }
+    if (ring.fd < 0) {
+        ring.fd = -1;
+        return -1;
+    }
+
+    // IORING_FEAT_LINKED_FILE与multishot recv同在6.0引入，用作内核版本探测
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_EXT_ARG) ||
+        !(p.features & IORING_FEAT_LINKED_FILE)) {
+        uring_teardown();
+        return -1;
+    }
+
+    ring.sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring.cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring.cq_size > ring.sq_size) ring.sq_size = ring.cq_size;
+    ring.cq_size = ring.sq_size;
+
+    ring.sq_ptr = mmap(NULL, ring.sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring.fd, IORING_OFF_SQ_RING);
+    if (ring.sq_ptr == MAP_FAILED) {
+        ring.sq_ptr = NULL;
+        uring_teardown();
+        return -1;
+    }
+    ring.cq_ptr = ring.sq_ptr;
+
+    ring.sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring.fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED) {
+        ring.sqes = NULL;
+        uring_teardown();
+        return -1;
+    }
+
+    char *sq = ring.sq_ptr;
+    ring.sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring.sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring.sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring.cq_head = (unsigned *)(sq + p.cq_off.head);
+    ring.cq_tail = (unsigned *)(sq + p.cq_off.tail);
+    ring.cq_mask = (unsigned *)(sq + p.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(sq + p.cq_off.cqes);
+    ring.sq_entries = p.sq_entries;
+
+    // SQE按顺序填充，索引数组固定为恒等映射
+    unsigned *array = (unsigned *)(sq + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++) {
+        array[i] = i;
+    }
+
+    // 注册provided buffer ring：内核在数据到达时才占用缓冲区，空闲连接不占内存
+    ring.buf_ring_size = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    ring.buf_ring = mmap(NULL, ring.buf_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring.buf_ring == MAP_FAILED) {
+        ring.buf_ring = NULL;
+        uring_teardown();
+        return -1;
+    }
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring.buf_ring;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BUF_GROUP;
+    if (sys_io_uring_register(ring.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        uring_teardown();
+        return -1;
+    }
+
+    ring.bufs = malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+    if (!ring.bufs) {
+        uring_teardown();
+        return -1;
+    }
+    for (unsigned short bid = 0; bid < URING_BUF_COUNT; bid++) {
+        uring_buf_recycle(bid);
+    }
+
+    // 写入阻塞socket的splice在io-wq的unbound线程中执行，慢客户端会占住线程直到
+    // send_timeout；不加限制时线程数只受RLIMIT_NPROC约束。超过上限的请求在io-wq中排队。
+    // 数组依次为bounded（文件读入，保持内核默认）和unbound的上限，0表示不修改
+    unsigned iowq_max[2] = { 0, URING_IOWQ_MAX_UNBOUND };
+    if (sys_io_uring_register(ring.fd, IORING_REGISTER_IOWQ_MAX_WORKERS, iowq_max, 2) < 0) {
+        uring_teardown();
+        return -1;
+    }
+    return 0;
+}
+
+// 提交所有待提交的SQE，并等待至少一个完成事件或超时
+static void uring_submit_and_wait(int timeout_ms) {
+    unsigned to_submit = ring.sqe_tail - ring.sqe_submitted;
+    __atomic_store_n(ring.sq_tail, ring.sqe_tail, __ATOMIC_RELEASE);
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+    }
+
+    int ret = sys_io_uring_enter(ring.fd, to_submit, 1,
+                                 IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                 &arg, sizeof(arg));
+    if (ret >= 0) {
+        ring.sqe_submitted += (unsigned)ret;
+    } else if (errno != ETIME && errno != EINTR && errno != EBUSY) {
+        log_message(LOG_LEVEL_ERROR, "io_uring_enter failed");
+    }
+    // 出错时未被消费的SQE留在队列中，下次一并提交
+    if (ret < 0 || (unsigned)ret < to_submit) {
+        ring.sqe_submitted = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+    }
+}
+
+static struct io_uring_sqe *uring_get_sqe(void) {
+    unsigned head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+    if (ring.sqe_tail - head >= ring.sq_entries) {
+        // 提交队列已满，先把已有请求交给内核
+        unsigned to_submit = ring.sqe_tail - ring.sqe_submitted;
+        __atomic_store_n(ring.sq_tail, ring.sqe_tail, __ATOMIC_RELEASE);
+        int ret = sys_io_uring_enter(ring.fd, to_submit, 0, 0, NULL, 0);
+        if (ret > 0) ring.sqe_submitted += (unsigned)ret;
+        head = __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE);
+        if (ring.sqe_tail - head >= ring.sq_entries) {
+            return NULL;
+        }
+    }
+    struct io_uring_sqe *sqe = &ring.sqes[ring.sqe_tail & *ring.sq_mask];
+    ring.sqe_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static int uring_prep_accept(int listener_index) {
+    const listening_socket_t *listener = &uring_listeners[listener_index];
+    int is_https = listener->is_ssl && listener->ssl_ctx;
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listener->fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    // 明文连接的读写全部由io_uring完成，保持阻塞模式：非阻塞socket上的splice
+    // 会直接以-EAGAIN失败（io-wq线程数的限制见uring_setup）；TLS连接仍按就绪事件驱动，需要非阻塞
+    sqe->accept_flags = is_https ? SOCK_NONBLOCK | SOCK_CLOEXEC : SOCK_CLOEXEC;
+    sqe->user_data = URING_UDATA(URING_OP_ACCEPT, listener_index);
+    return 0;
+}
+
+static int uring_prep_recv(connection_t *conn) {
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->user_data = URING_UDATA(URING_OP_RECV, conn->index);
+    uring_conns[conn->index].inflight++;
+    return 0;
+}
+
+static int uring_prep_poll(connection_t *conn) {
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = conn->fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN | POLLOUT | POLLRDHUP;
+    sqe->user_data = URING_UDATA(URING_OP_POLL, conn->index);
+    uring_conns[conn->index].inflight++;
+    return 0;
+}
+
+static int uring_prep_splice(connection_t *conn, int op, int fd_in, uint64_t off_in,
+                             int fd_out, unsigned int len, unsigned char flags) {
+    struct io_uring_sqe *sqe = uring_get_sqe();
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_SPLICE;
+    sqe->fd = fd_out;
+    sqe->off = (uint64_t)-1;
+    sqe->splice_fd_in = fd_in;
+    sqe->splice_off_in = off_in;
+    sqe->len = len;
+    sqe->flags = flags;
+    sqe->user_data = URING_UDATA(op, conn->index);
+    uring_conns[conn->index].inflight++;
+    return 0;
+}
+
+static void uring_timeout_handler(timer_node_t *timer) {
+    connection_t *conn = (connection_t *)timer->data;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Connection from %s timed out in state %d, closing",
+             conn->client_ip, conn->state);
+    log_message(LOG_LEVEL_DEBUG, msg);
+    uring_close_connection(conn);
+}
+
+// 所有请求完成后才能归还连接槽，否则完成事件会指向被复用的槽位
+static void uring_release_if_idle(connection_t *conn) {
+    uring_conn_t *uc = &uring_conns[conn->index];
+    if (!uc->closing || uc->inflight > 0) return;
+
+    if (uc->pipe_fds[0] >= 0) close(uc->pipe_fds[0]);
+    if (uc->pipe_fds[1] >= 0) close(uc->pipe_fds[1]);
+    uc->pipe_fds[0] = uc->pipe_fds[1] = -1;
+    free(uc->overflow);
+    uc->overflow = NULL;
+    uc->overflow_len = 0;
+    // closing保持为1直到槽位被重新分配，调用者在关闭后不会再提交请求
+    free_connection(conn);
+}
+
+static void uring_close_connection(connection_t *conn) {
+    uring_conn_t *uc = &uring_conns[conn->index];
+    if (uc->closing) return;
+    uc->closing = 1;
+    timer_del(&conn_timers, &conn->timer);
+
+    if (uc->inflight > 0) {
+        // 关闭读写方向让挂起的recv/send/splice尽快完成，再取消该fd上剩余的请求
+        shutdown(conn->fd, SHUT_RDWR);
+        struct io_uring_sqe *sqe = uring_get_sqe();
+        if (sqe) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = conn->fd;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+            sqe->user_data = URING_UDATA(URING_OP_CANCEL, conn->index);
+            uc->inflight++;
+        }
+    }
+    uring_release_if_idle(conn);
+}
+
+// 将收到的数据追加到连接缓冲区，放不下的部分按顺序暂存到overflow
+// multishot recv不会因为正在发送响应而停止，流水线请求必须保留
+static int uring_buffer_append(connection_t *conn, const char *data, size_t len) {
+    uring_conn_t *uc = &uring_conns[conn->index];
+
+    if (uc->overflow_len == 0) {
+        size_t space = conn->buffer_cap - conn->buffer_size - 1;
+        if (space < len) space = conn_compact_buffer(conn);
+        size_t n = ANX_MIN(space, len);
+        memcpy(conn->buffer + conn->buffer_size, data, n);
+        conn->buffer_size += n;
+        conn->buffer[conn->buffer_size] = '\0';
+        data += n;
+        len -= n;
+    }
+    if (len == 0) return 0;
+
+    if (uc->overflow_len + len > URING_OVERFLOW_MAX) return -1;
+    char *overflow = realloc(uc->overflow, uc->overflow_len + len);
+    if (!overflow) return -1;
+    memcpy(overflow + uc->overflow_len, data, len);
+    uc->overflow = overflow;
+    uc->overflow_len += len;
+    return 0;
+}
+
+// 当前请求完成后把暂存的数据移回连接缓冲区
+static void uring_buffer_refill(connection_t *conn) {
+    uring_conn_t *uc = &uring_conns[conn->index];
+    if (uc->overflow_len == 0) return;
+
+    size_t n = ANX_MIN(conn_compact_buffer(conn), uc->overflow_len);
+    memcpy(conn->buffer + conn->buffer_size, uc->overflow, n);
+    conn->buffer_size += n;
+    conn->buffer[conn->buffer_size] = '\0';
+    uc->overflow_len -= n;
+    memmove(uc->overflow, uc->overflow + n, uc->overflow_len);
+}
+
+// 缓冲区中已有完整请求时立即处理；缓冲区已满却仍不完整时换用large buffer，
+// 达到large_client_header_buffers上限则回复431
+static void uring_try_request(connection_t *conn) {
+    while (conn->buffer_size > conn->request_start && !conn_parse_request_frame(conn)) {
+        if (conn->buffer_size < conn->buffer_cap - 1) return;
+        if (conn_reserve_buffer(conn) == 0) {
+            log_message(LOG_LEVEL_WARNING, "Request header too large");
+            conn_reject_request(conn, 431);
+            break;
+        }
+        uring_buffer_refill(conn);
+    }
+    if (conn->request_len > 0) {
+        uring_process_request(conn);
+    }
+}
+
+// 响应发送完毕：keepalive连接继续处理下一个请求（按到达顺序），
+// 否则半关闭写端，继续接收直到对端关闭（延迟关闭）
+static void uring_response_done(connection_t *conn) {
+    if (!conn->response.keep_alive) {
+        shutdown(conn->fd, SHUT_WR);
+        conn->state = CONN_STATE_LINGERING;
+        timer_add(&conn_timers, &conn->timer, LINGERING_TIMEOUT_MS);
+        return;
+    }
+
+    conn_advance_request(conn);
+    uring_buffer_refill(conn);
+    conn->state = CONN_STATE_READING_HEADERS;
+    timer_add(&conn_timers, &conn->timer,
+              conn->buffer_size > conn->request_start
+                  ? uring_conf->client_header_timeout
+                  : uring_conf->keepalive_timeout);
+    uring_try_request(conn);
+}
+
+// 从文件读入管道，再由管道写入socket；两个splice链接提交，一次系统调用完成
+static void uring_splice_file(connection_t *conn) {
+    uring_conn_t *uc = &uring_conns[conn->index];
+    http_response_t *resp = &conn->response;
+
+    if (uc->pipe_fds[0] < 0 && pipe2(uc->pipe_fds, O_CLOEXEC) < 0) {
+        log_message(LOG_LEVEL_ERROR, "Failed to create splice pipe");
+        uring_close_connection(conn);
+        return;
+    }
+
+    timer_add(&conn_timers, &conn->timer, uring_conf->send_timeout);
+
+    if (uc->pipe_pending > 0) {
+        // 上一轮socket只写入了部分数据，先把管道中的剩余部分发完
+        if (uring_prep_splice(conn, URING_OP_SPLICE_OUT, uc->pipe_fds[0], (uint64_t)-1,
+                              conn->fd, (unsigned int)uc->pipe_pending, 0) < 0) {
+            uring_close_connection(conn);
+        }
+        return;
+    }
+
+    size_t len = ANX_MIN(resp->file_remaining, (size_t)URING_SPLICE_CHUNK);
+    uc->splice_len = len;
+    // 文件读入不足时链接请求失败，后一个splice以-ECANCELED完成
+    if (uring_prep_splice(conn, URING_OP_SPLICE_IN, resp->file_fd, (uint64_t)resp->file_offset,
+                          uc->pipe_fds[1], (unsigned int)len, IOSQE_IO_LINK) < 0 ||
+        uring_prep_splice(conn, URING_OP_SPLICE_OUT, uc->pipe_fds[0], (uint64_t)-1,
+                          conn->fd, (unsigned int)len, 0) < 0) {
+        uring_close_connection(conn);
+    }
+}
+
+// 提交响应：头部与内存响应体合并为一次sendmsg，随后发送文件
+static void uring_send_response(connection_t *conn) {
+    uring_conn_t *uc = &uring_conns[conn->index];
+    http_response_t *resp = &conn->response;
+    int iovcnt = http_response_fill_iov(resp, uc->iov);
+
+    if (iovcnt > 0) {
+        memset(&uc->msg, 0, sizeof(uc->msg));
+        uc->msg.msg_iov = uc->iov;
+        uc->msg.msg_iovlen = iovcnt;
+
+        struct io_uring_sqe *sqe = uring_get_sqe();
+        if (!sqe) {
+            uring_close_connection(conn);
+            return;
+        }
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = conn->fd;
+        sqe->addr = (uint64_t)(uintptr_t)&uc->msg;
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL | (resp->file_remaining > 0 ? MSG_MORE : 0);
+        sqe->user_data = URING_UDATA(URING_OP_SEND, conn->index);
+        uc->inflight++;
+        timer_add(&conn_timers, &conn->timer, uring_conf->send_timeout);
+        return;
+    }
+
+    if (resp->file_fd >= 0 && (resp->file_remaining > 0 || uc->pipe_pending > 0)) {
+        conn->state = CONN_STATE_SENDING_BODY;
+        uring_splice_file(conn);
+        return;
+    }
+
+    // 多区间响应或流式响应体：装入下一段继续发送
+    int more = http_response_next_part(resp);
+    if (more < 0) {
+        uring_close_connection(conn);
+        return;
+    }
+    if (more) {
+        uring_send_response(conn);
+        return;
+    }
+    uring_response_done(conn);
+}
+
+// 请求完整：路由并生成响应，随后提交发送
+static void uring_process_request(connection_t *conn) {
+    conn->state = CONN_STATE_ROUTING;
+    if (route_request(conn, uring_conf) < 0) {
+        uring_close_connection(conn);
+        return;
+    }
+    conn->state = CONN_STATE_WRITING_HEADERS;
+    uring_send_response(conn);
+}
+
+static void uring_handle_accept(int listener_index, int res, unsigned flags) {
+    if (!(flags & IORING_CQE_F_MORE)) {
+        // multishot accept已终止（出错或被取消），重新提交
+        uring_prep_accept(listener_index);
+    }
+    if (res < 0) {
+        if (res != -EAGAIN && res != -ECANCELED) {
+            log_message(LOG_LEVEL_ERROR, "accept failed");
+        }
+        return;
+    }
+
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    memset(&client_addr, 0, sizeof(client_addr));
+    getpeername(res, (struct sockaddr *)&client_addr, &client_len);
+
+    connection_t *conn = open_connection(res, &client_addr, &uring_listeners[listener_index],
+                                         uring_conf);
+    if (!conn) return;
+    conn->timer.handler = uring_timeout_handler;
+
+    uring_conn_t *uc = &uring_conns[conn->index];
+    memset(uc, 0, sizeof(*uc));
+    uc->pipe_fds[0] = uc->pipe_fds[1] = -1;
+
+    int rc = conn->ssl ? uring_prep_poll(conn) : uring_prep_recv(conn);
+    if (rc < 0) {
+        uring_close_connection(conn);
+    }
+}
+
+static void uring_handle_recv(connection_t *conn, int res, unsigned flags) {
+    uring_conn_t *uc = &uring_conns[conn->index];
+    int more = flags & IORING_CQE_F_MORE;
+
+    if (!more) uc->inflight--;
+
+    if (res > 0) {
+        unsigned short bid = (unsigned short)(flags >> IORING_CQE_BUFFER_SHIFT);
+        const char *data = ring.bufs + (size_t)bid * URING_BUF_SIZE;
+
+        if (!uc->closing && conn->state != CONN_STATE_LINGERING) {
+            size_t received = conn->buffer_size - conn->request_start;
+            int rc = uring_buffer_append(conn, data, (size_t)res);
+            uring_buf_recycle(bid);
+            if (rc < 0) {
+                log_message(LOG_LEVEL_WARNING, "Too much pipelined data, closing connection");
+                uring_close_connection(conn);
+            } else if (conn->state == CONN_STATE_READING_HEADERS) {
+                // keepalive等待结束，下一个请求的首字节到达后改用请求头超时
+                if (received == 0) {
+                    timer_add(&conn_timers, &conn->timer, uring_conf->client_header_timeout);
+                }
+                uring_try_request(conn);
+            }
+        } else {
+            // 延迟关闭阶段收到的数据直接丢弃
+            uring_buf_recycle(bid);
+        }
+    } else if (res == 0 || (res < 0 && res != -ENOBUFS)) {
+        // 对端关闭或出错
+        uring_close_connection(conn);
+    }
+
+    if (uc->closing) {
+        uring_release_if_idle(conn);
+        return;
+    }
+    if (!more && uring_prep_recv(conn) < 0) {
+        // 缓冲区耗尽(-ENOBUFS)等原因导致multishot终止时重新提交
+        uring_close_connection(conn);
+    }
+}
+
+static void uring_handle_send(connection_t *conn, int res) {
+    uring_conn_t *uc = &uring_conns[conn->index];
+    http_response_t *resp = &conn->response;
+
+    uc->inflight--;
+    if (uc->closing) {
+        uring_release_if_idle(conn);
+        return;
+    }
+    if (res < 0) {
+        uring_close_connection(conn);
+        return;
+    }
+
+    http_response_consume(resp, (size_t)res);
+    if (resp->header_sent == resp->header_len) {
+        conn->state = CONN_STATE_SENDING_BODY;
+    }
+    uring_send_response(conn);
+}
+
+static void uring_handle_splice(connection_t *conn, int op, int res) {
+    uring_conn_t *uc = &uring_conns[conn->index];
+    http_response_t *resp = &conn->response;
+
+    uc->inflight--;
+    if (uc->closing) {
+        uring_release_if_idle(conn);
+        return;
+    }
+
+    if (op == URING_OP_SPLICE_IN) {
+        if (res <= 0) {
+            // 读文件失败或文件被截断
+            uring_close_connection(conn);
+            return;
+        }
+        resp->file_offset += res;
+        resp->file_remaining -= (size_t)res;
+        uc->pipe_pending += (size_t)res;
+        return;  // 等待链接的SPLICE_OUT完成
+    }
+
+    if (res == -ECANCELED) {
+        // 读入不足导致链接断开，管道中的数据在下一轮发送
+    } else if (res <= 0) {
+        uring_close_connection(conn);
+        return;
+    } else {
+        uc->pipe_pending -= (size_t)res;
+    }
+
+    if (uc->pipe_pending > 0 || resp->file_remaining > 0) {
+        uring_splice_file(conn);
+    } else {
+        uring_send_response(conn);
+    }
+}
+
+// TLS连接：用就绪事件驱动与epoll后端相同的状态机
+static void uring_handle_poll(connection_t *conn, int res, unsigned flags) {
+    uring_conn_t *uc = &uring_conns[conn->index];
+    int more = flags & IORING_CQE_F_MORE;
+
+    if (!more) uc->inflight--;
+    if (uc->closing) {
+        uring_release_if_idle(conn);
+        return;
+    }
+    if (res < 0 || (res & (POLLERR | POLLHUP))) {
+        uring_close_connection(conn);
+        return;
+    }
+
+    int wants_read = (conn->state == CONN_STATE_READING_HEADERS ||
+                      conn->state == CONN_STATE_LINGERING ||
+                      conn->state == CONN_STATE_SSL_HANDSHAKE) &&
+                     (res & (POLLIN | POLLRDHUP));
+    int wants_write = (conn->state == CONN_STATE_WRITING_HEADERS ||
+                       conn->state == CONN_STATE_SENDING_BODY ||
+                       conn->state == CONN_STATE_SSL_HANDSHAKE) &&
+                      (res & (POLLOUT | POLLIN));
+    if ((wants_read || wants_write) &&
+        handle_http_request_optimized(conn, uring_conf) == -1) {
+        uring_close_connection(conn);
+        return;
+    }
+
+    if (!more && uring_prep_poll(conn) < 0) {
+        uring_close_connection(conn);
+    }
+}
+
+static void uring_handle_cqe(uint64_t user_data, int res, unsigned flags) {
+    int op = URING_UDATA_OP(user_data);
+    int index = URING_UDATA_INDEX(user_data);
+
+    if (op == URING_OP_ACCEPT) {
+        uring_handle_accept(index, res, flags);
+        return;
+    }
+
+    connection_t *conn = connection_pool_get(index);
+    if (!conn || conn->fd == -1) return;
+
+    switch (op) {
+    case URING_OP_RECV:
+        uring_handle_recv(conn, res, flags);
+        break;
+    case URING_OP_POLL:
+        uring_handle_poll(conn, res, flags);
+        break;
+    case URING_OP_SEND:
+        uring_handle_send(conn, res);
+        break;
+    case URING_OP_SPLICE_IN:
+    case URING_OP_SPLICE_OUT:
+        uring_handle_splice(conn, op, res);
+        break;
+    case URING_OP_CANCEL:
+        uring_conns[index].inflight--;
+        uring_release_if_idle(conn);
+        break;
+    default:
+        break;
+    }
+}
+
+static void uring_reap_completions(void) {
+    unsigned head = *ring.cq_head;
+    unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+        uint64_t user_data = cqe->user_data;
+        int res = cqe->res;
+        unsigned flags = cqe->flags;
+
+        head++;
+        // 先归还CQ槽位，回调中提交的请求产生的完成事件不会被覆盖
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+        uring_handle_cqe(user_data, res, flags);
+
+        if (head == tail) {
+            tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+}
+
+int uring_worker_loop(listening_socket_t *listeners, int listener_count,
+                      core_config_t *core_config) {
+    if (uring_setup() < 0) {
+        return -1;
+    }
+
+    uring_conns = calloc(core_config->worker_connections, sizeof(uring_conn_t));
+    if (!uring_conns) {
+        uring_teardown();
+        return -1;
+    }
+    uring_conf = core_config;
+    uring_listeners = listeners;
+
+    for (int i = 0; i < listener_count; i++) {
+        if (listeners[i].fd != -1) uring_prep_accept(i);
+    }
+
+    log_message(LOG_LEVEL_INFO, "io_uring worker process started.");
+
+    while (1) {
+        // 一次io_uring_enter同时完成提交与等待，超时取自下一个定时器
+        int timeout = timer_wheel_next_timeout(&conn_timers, timer_now_ms());
+        uring_submit_and_wait(timeout);
+        timer_wheel_update_time(&conn_timers, timer_now_ms());
+        uring_reap_completions();
+        timer_wheel_expire(&conn_timers, conn_timers.now);
+    }
+
+    free(uring_conns);
+    uring_conns = NULL;
+    uring_teardown();
+    return 0;
+}
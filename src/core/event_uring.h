@@ -0,0 +1,19 @@
+#ifndef EVENT_URING_H
+#define EVENT_URING_H
+
+#include <openssl/ssl.h>
+#include "core.h"
+
+// 基于io_uring的worker事件循环（event_engine io_uring）
+// 明文连接：multishot accept + 使用provided buffer ring的multishot recv，
+//           响应头/内存响应体用sendmsg一次提交，文件经管道用链接的splice发送
+//           splice总是在io-wq内核线程中执行，socket保持阻塞，写入socket的splice会占住一个
+//           线程直到客户端收完或send_timeout；每个worker的这类线程限制为64个，
+//           超过时后面的文件发送排队等待，少数慢客户端不会让线程数无限增长，
+//           代价是64个以上的慢客户端同时下载时其他文件发送会被推迟
+// TLS连接：multishot poll提供就绪通知，复用epoll后端的状态机
+// 内核不支持所需特性时立即返回-1，由调用者回退到epoll；否则不返回
+int uring_worker_loop(listening_socket_t *listeners, int listener_count,
+                      core_config_t *core_config);
+
+#endif  // EVENT_URING_H
@@ -22,6 +22,7 @@
 #include "log.h"
 #include "net.h"
 #include "https.h"
+#include "warmup.h"
 
 #include <arpa/inet.h>
 #include <errno.h>
@@ -47,18 +48,71 @@ void signal_handler(int signum) {
     snprintf(msg, sizeof(msg), "Received signal %d. Shutting down workers.",
              signum);
     log_message(LOG_LEVEL_INFO, msg);
+    warmup_cancel();
     for (int i = 0; i < num_workers_spawned; i++) {
         kill(worker_pids[i], SIGKILL);
     }
     // Let the main loop's wait() handle reaping
 }
 
+// 为第index个监听socket创建SSL上下文；已有监听使用相同证书时共享其上下文
+static SSL_CTX *create_listener_ssl_ctx(core_config_t *core_conf, int index) {
+    listening_socket_t *ls = &core_conf->listening_sockets[index];
+
+    for (int i = 0; i < index; i++) {
+        listening_socket_t *prev = &core_conf->listening_sockets[i];
+        if (prev->ssl_ctx &&
+            strcmp(prev->ssl_certificate, ls->ssl_certificate) == 0 &&
+            strcmp(prev->ssl_certificate_key, ls->ssl_certificate_key) == 0) {
+            SSL_CTX_up_ref(prev->ssl_ctx);
+            return prev->ssl_ctx;
+        }
+    }
+
+    char log_buf[512];
+    snprintf(log_buf, sizeof(log_buf), "Attempting to load SSL cert from: %s", ls->ssl_certificate);
+    log_message(LOG_LEVEL_DEBUG, log_buf);
+    snprintf(log_buf, sizeof(log_buf), "Attempting to load SSL key from: %s", ls->ssl_certificate_key);
+    log_message(LOG_LEVEL_DEBUG, log_buf);
+
+    SSL_CTX *ssl_ctx = SSL_CTX_new(TLS_server_method());
+    if (!ssl_ctx) {
+        ERR_print_errors_fp(stderr);
+        log_message(LOG_LEVEL_ERROR, "Failed to create SSL context");
+        cleanup_logging();
+        exit(EXIT_FAILURE);
+    }
+
+    if (SSL_CTX_use_certificate_file(ssl_ctx, ls->ssl_certificate, SSL_FILETYPE_PEM) <= 0) {
+        ERR_print_errors_fp(stderr);
+        log_message(LOG_LEVEL_ERROR, "Failed to load certificate file.");
+        cleanup_logging();
+        exit(EXIT_FAILURE);
+    }
+    if (SSL_CTX_use_PrivateKey_file(ssl_ctx, ls->ssl_certificate_key, SSL_FILETYPE_PEM) <= 0) {
+        ERR_print_errors_fp(stderr);
+        log_message(LOG_LEVEL_ERROR, "Failed to load private key file.");
+        cleanup_logging();
+        exit(EXIT_FAILURE);
+    }
+
+    snprintf(log_buf, sizeof(log_buf), "SSL Context initialized for port %d.", ls->port);
+    log_message(LOG_LEVEL_INFO, log_buf);
+    return ssl_ctx;
+}
+
 void cleanup_resources(core_config_t *core_conf, SSL_CTX *ssl_ctx, pid_t *worker_pids, int num_workers) {
     // 关闭所有监听socket
     if (core_conf) {
         for(int i = 0; i < core_conf->listening_socket_count; i++) {
-            if(core_conf->listening_sockets[i].fd != -1) {
-                close(core_conf->listening_sockets[i].fd);
+            listening_socket_t *ls = &core_conf->listening_sockets[i];
+            if (ls->worker_fds) {
+                // reuseport监听socket：fd即worker_fds[0]，逐个关闭
+                for (int w = 0; w < core_conf->worker_processes; w++) {
+                    if (ls->worker_fds[w] != -1) close(ls->worker_fds[w]);
+                }
+            } else if(ls->fd != -1) {
+                close(ls->fd);
             }
         }
     }
@@ -369,7 +423,9 @@ int main(int argc, char *argv[]) {
         }
         
         // 创建监听socket
-        int server_fd = create_server_socket(port);
+        listening_socket_t listener;
+        listening_socket_init(&listener, port);
+        int server_fd = create_server_socket(&listener);
         if (server_fd < 0) {
             log_message(LOG_LEVEL_ERROR, "Failed to create server socket");
             if (ssl_ctx) SSL_CTX_free(ssl_ctx);
@@ -400,7 +456,9 @@ int main(int argc, char *argv[]) {
                 exit(EXIT_FAILURE);
             } else if (pid == 0) {
                 // Worker process
-                worker_loop(server_fd, -1, core_conf, ssl_ctx);
+                if (core_conf->worker_cpu_affinity) set_worker_cpu_affinity(i);
+                listener.fd = server_fd;
+                worker_loop(&listener, 1, core_conf);
                 exit(0);
             } else {
                 worker_pids[i] = pid;
@@ -490,63 +548,45 @@ int main(int argc, char *argv[]) {
     SSL_library_init();
     OpenSSL_add_all_algorithms();
     SSL_load_error_strings();
-    SSL_CTX *ssl_ctx = NULL;
-
-    // Find the first SSL socket to initialize a global SSL_CTX
-    // A better implementation would have per-server SSL_CTX.
+    // 为每个ssl监听socket加载所在server块的证书，相同证书的监听共享一个上下文
+    // 上下文归监听socket所有，由free_core_config释放
     for (int i = 0; i < core_conf->listening_socket_count; i++) {
-        if (core_conf->listening_sockets[i].is_ssl) {
-            const char *cert_file = core_conf->listening_sockets[i].ssl_certificate;
-            const char *key_file = core_conf->listening_sockets[i].ssl_certificate_key;
-
-            if (!cert_file || !key_file) {
-                log_message(LOG_LEVEL_WARNING,
-                            "SSL socket configured but ssl_certificate or "
-                            "ssl_certificate_key is missing.");
-                continue;
-            }
-            
-            char log_buf[512];
-            snprintf(log_buf, sizeof(log_buf), "Attempting to load SSL cert from: %s", cert_file);
-            log_message(LOG_LEVEL_DEBUG, log_buf);
-            snprintf(log_buf, sizeof(log_buf), "Attempting to load SSL key from: %s", key_file);
-            log_message(LOG_LEVEL_DEBUG, log_buf);
-
-            ssl_ctx = SSL_CTX_new(TLS_server_method());
-            if (!ssl_ctx) {
-                ERR_print_errors_fp(stderr);
-                log_message(LOG_LEVEL_ERROR, "Failed to create SSL context");
-                cleanup_logging();
-                exit(EXIT_FAILURE);
-            }
-
-            if (SSL_CTX_use_certificate_file(ssl_ctx, cert_file,
-                                             SSL_FILETYPE_PEM) <= 0) {
-                ERR_print_errors_fp(stderr);
-                log_message(LOG_LEVEL_ERROR, "Failed to load certificate file.");
-                cleanup_logging();
-                exit(EXIT_FAILURE);
-            }
-            if (SSL_CTX_use_PrivateKey_file(ssl_ctx, key_file,
-                                            SSL_FILETYPE_PEM) <= 0) {
-                ERR_print_errors_fp(stderr);
-                log_message(LOG_LEVEL_ERROR, "Failed to load private key file.");
-                cleanup_logging();
-                exit(EXIT_FAILURE);
-            }
-            log_message(LOG_LEVEL_INFO, "SSL Context initialized successfully.");
-            break; // Only init one global context for now
+        listening_socket_t *ls = &core_conf->listening_sockets[i];
+        if (!ls->is_ssl) continue;
+        if (!ls->ssl_certificate || !ls->ssl_certificate_key) {
+            log_message(LOG_LEVEL_WARNING,
+                        "SSL socket configured but ssl_certificate or "
+                        "ssl_certificate_key is missing.");
+            continue;
         }
+        ls->ssl_ctx = create_listener_ssl_ctx(core_conf, i);
     }
 
     // 3. Create listening sockets based on core config
-    int http_fd = -1;
-    int https_fd = -1;
     for(int i = 0; i < core_conf->listening_socket_count; i++) {
         int port = core_conf->listening_sockets[i].port;
         int is_ssl = core_conf->listening_sockets[i].is_ssl;
         
-        int fd = create_server_socket(port);
+        int fd;
+        if (core_conf->listening_sockets[i].reuseport) {
+            // 每个worker一个SO_REUSEPORT socket，按worker序号依次创建，
+            // 组内下标与worker序号一致，CBPF按CPU分发时才能落到绑定该CPU的worker
+            int *worker_fds = malloc(core_conf->worker_processes * sizeof(int));
+            if (!worker_fds) {
+                core_conf->listening_sockets[i].fd = -1;
+                continue;
+            }
+            for (int w = 0; w < core_conf->worker_processes; w++) {
+                worker_fds[w] = create_server_socket(&core_conf->listening_sockets[i]);
+            }
+            core_conf->listening_sockets[i].worker_fds = worker_fds;
+            fd = worker_fds[0];
+            if (core_conf->reuseport_bpf) {
+                attach_reuseport_cbpf(fd, core_conf->worker_processes);
+            }
+        } else {
+            fd = create_server_socket(&core_conf->listening_sockets[i]);
+        }
         if (fd < 0) {
             // Mark this socket as invalid, but don't exit
             core_conf->listening_sockets[i].fd = -1;
@@ -558,19 +598,22 @@ int main(int argc, char *argv[]) {
         snprintf(msg, sizeof(msg), "%s server listening on port %d", 
                 is_ssl ? "HTTPS" : "HTTP", port);
         log_message(LOG_LEVEL_INFO, msg);
-        
-        // This is a simplification. We should pass a list of FDs to the worker.
-        // For now, we just grab the first http and https fd we find.
-        if (is_ssl) {
-            if (https_fd == -1) https_fd = fd;
-            if (!ssl_ctx) log_message(LOG_LEVEL_WARNING, "HTTPS socket open but no SSL_CTX initialized. HTTPS will not work.");
+        if (is_ssl && !core_conf->listening_sockets[i].ssl_ctx) {
+            log_message(LOG_LEVEL_WARNING, "HTTPS socket open but no SSL_CTX initialized. HTTPS will not work.");
         }
-        if (!is_ssl && http_fd == -1) http_fd = fd;
     }
 
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
 
+    // 缓存在fork之前填好，worker继承同一份内容；预热期间收到SIGINT/SIGTERM时放弃启动
+    if (warmup_fill_cache(core_conf) < 0) {
+        log_message(LOG_LEVEL_INFO, "Shutdown requested during cache warm-up. Master process exiting.");
+        // 还没有fork任何worker
+        cleanup_resources(core_conf, NULL, NULL, 0);
+        return 0;
+    }
+
     char msg[128];
     snprintf(msg, sizeof(msg), "Master process starting %d workers...", core_conf->worker_processes);
     log_message(LOG_LEVEL_INFO, msg);
@@ -580,28 +623,35 @@ int main(int argc, char *argv[]) {
         pid_t pid = fork();
         if (pid == -1) {
             log_message(LOG_LEVEL_ERROR, "fork failed");
-            cleanup_resources(core_conf, ssl_ctx, worker_pids, num_workers_spawned);
+            cleanup_resources(core_conf, NULL, worker_pids, num_workers_spawned);
             exit(EXIT_FAILURE);
         } else if (pid == 0) {
             // 工作进程 - 不需要释放worker_pids，因为它是栈分配的
             
-            // 传递有效的文件描述符
-            int worker_http_fd = -1;
-            int worker_https_fd = -1;
+            // 每个worker服务全部监听socket，reuseport监听换成本worker自己的socket
             for (int j = 0; j < core_conf->listening_socket_count; j++) {
-                if(core_conf->listening_sockets[j].fd != -1) {
-                    if(core_conf->listening_sockets[j].is_ssl) {
-                        if (worker_https_fd == -1) worker_https_fd = core_conf->listening_sockets[j].fd;
-                    } else {
-                        if (worker_http_fd == -1) worker_http_fd = core_conf->listening_sockets[j].fd;
+                listening_socket_t *ls = &core_conf->listening_sockets[j];
+                if (ls->worker_fds) {
+                    // 只保留本worker的reuseport socket，关闭其他worker的，
+                    // 避免某个worker退出后其监听队列仍被保持而无人accept
+                    for (int w = 0; w < core_conf->worker_processes; w++) {
+                        if (w != i) {
+                            close(ls->worker_fds[w]);
+                            ls->worker_fds[w] = -1;
+                        }
                     }
+                    ls->fd = ls->worker_fds[i];
                 }
             }
+
+            if (core_conf->worker_cpu_affinity) {
+                set_worker_cpu_affinity(i);
+            }
             
-            worker_loop(worker_http_fd, worker_https_fd, core_conf, ssl_ctx);
+            worker_loop(core_conf->listening_sockets, core_conf->listening_socket_count, core_conf);
             
             // 工作进程清理
-            cleanup_resources(core_conf, ssl_ctx, NULL, 0);
+            cleanup_resources(core_conf, NULL, NULL, 0);
             exit(0);
         } else {
             worker_pids[i] = pid;
@@ -611,6 +661,20 @@ int main(int argc, char *argv[]) {
     
     log_message(LOG_LEVEL_DEBUG, "--> main: All workers forked");
 
+    // reuseport socket只由对应的worker持有，主进程关闭自己的副本
+    for (int j = 0; j < core_conf->listening_socket_count; j++) {
+        listening_socket_t *ls = &core_conf->listening_sockets[j];
+        if (!ls->worker_fds) continue;
+        for (int w = 0; w < core_conf->worker_processes; w++) {
+            if (ls->worker_fds[w] != -1) close(ls->worker_fds[w]);
+            ls->worker_fds[w] = -1;
+        }
+        ls->fd = -1;
+    }
+
+    // 后台预压缩在主进程中运行，不占用worker的事件循环
+    warmup_start(core_conf);
+
     // 等待所有工作进程退出
     for (int i = 0; i < core_conf->worker_processes; i++) {
         wait(NULL);
@@ -618,9 +682,10 @@ int main(int argc, char *argv[]) {
 
     log_message(LOG_LEVEL_INFO, "All workers have shut down. Master process exiting.");
     log_message(LOG_LEVEL_DEBUG, "--> main: Cleaning up...");
+    warmup_stop();
     
     // 主进程清理
-    cleanup_resources(core_conf, ssl_ctx, worker_pids, num_workers_spawned);
+    cleanup_resources(core_conf, NULL, worker_pids, num_workers_spawned);
     
     log_message(LOG_LEVEL_DEBUG, "--> main: END");
     return 0;
@@ -1,95 +1,79 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "net.h"
 
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/filter.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <sched.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <sys/sendfile.h>
 #include <sys/time.h>
 
+#include "common.h"
+#include "compress.h"
 #include "config.h"
 #include "core.h"
 #include "http.h"
 #include "https.h"
 #include "log.h"
+#include "open_file_cache.h"
+#include "timer.h"
+#include "event_uring.h"
 #include "../utils/asm/asm_opt.h"
 #include "../utils/asm/asm_mempool.h"
 
 #define MAX_EVENTS 256  // 增加事件处理数量
 #define MAX_ACCEPT_PER_ROUND 32  // 每轮最多接受的连接数
-#define EPOLL_TIMEOUT_MS 1  // 1ms超时，减少阻塞
-
-// Connection state structure
-typedef struct connection_t {
-    int fd;
-    char client_ip[INET_ADDRSTRLEN];
-    time_t last_activity;
-    size_t buffer_size;
-    char buffer[8192];
-    int is_https;
-    SSL* ssl;
-} connection_t;
-
-// 优化的连接池
-static connection_t* connection_pool = NULL;
-static int connection_pool_size = 0;
-static int connection_pool_capacity = 0;
+
+// 连接超时定时器（每个worker一个时间轮）
+timer_wheel_t conn_timers;
 
 // 前向声明
 static int make_socket_non_blocking(int fd);
 void error_and_exit(const char *msg);
 
-// 初始化连接池
-static int init_connection_pool(int capacity) {
-    connection_pool_capacity = capacity;
-    connection_pool = calloc(capacity, sizeof(connection_t));
-    if (!connection_pool) {
-        log_message(LOG_LEVEL_ERROR, "Failed to allocate connection pool");
-    return -1;
-  }
-
-    // 初始化连接池
-    for (int i = 0; i < capacity; i++) {
-        connection_pool[i].fd = -1;
-        connection_pool[i].ssl = NULL;
-    }
-    
-    char log_msg[256];
-    snprintf(log_msg, sizeof(log_msg), "Connection pool initialized with capacity %d", capacity);
-    log_message(LOG_LEVEL_INFO, log_msg);
-  return 0;
-}
-
-// 获取空闲连接槽
-static connection_t* get_free_connection(void) {
-    for (int i = 0; i < connection_pool_capacity; i++) {
-        if (connection_pool[i].fd == -1) {
-            return &connection_pool[i];
-        }
-    }
-    return NULL;
-}
-
-// 释放连接槽
-static void free_connection(connection_t* conn) {
-    if (conn) {
+// 释放连接槽：关闭socket并回收连接持有的全部资源
+void free_connection(connection_t* conn) {
+    if (conn && conn->fd != -1) {
+        timer_del(&conn_timers, &conn->timer);
         if (conn->ssl) {
             SSL_free(conn->ssl);
             conn->ssl = NULL;
         }
+        http_response_release(&conn->response);
+        close(conn->fd);  // 关闭fd会自动将其从epoll中移除
         conn->fd = -1;
         conn->is_https = 0;
-        connection_pool_size--;
+        conn_buffer_reset(conn);
+        conn->request_start = 0;
+        conn->request_len = 0;
+        conn->state = CONN_STATE_READING_HEADERS;
+        connection_pool_release(conn);
+    }
+}
+
+// 设置可选的监听socket参数，失败只记录警告（内核不支持或权限不足时仍可正常服务）
+static void set_listen_option(int fd, int level, int name, int value, const char *what) {
+    if (setsockopt(fd, level, name, &value, sizeof(value)) < 0) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Failed to set %s=%d: %s", what, value, strerror(errno));
+        log_message(LOG_LEVEL_WARNING, msg);
     }
 }
 
-// 优化的socket创建
-int create_server_socket(int port) {
+// 优化的socket创建：按listen指令的参数设置监听socket，accept得到的连接继承缓冲区和忙轮询设置
+int create_server_socket(const listening_socket_t *listener) {
+  int port = listener->port;
   int server_fd;
   struct sockaddr_in server_addr;
 
@@ -113,6 +97,31 @@ int create_server_socket(int port) {
         log_message(LOG_LEVEL_WARNING, "Failed to set SO_KEEPALIVE");
   }
 
+    // SO_REUSEPORT：每个worker持有独立的监听队列，由内核分发连接
+    if (listener->reuseport && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+        error_and_exit("setsockopt SO_REUSEPORT failed");
+    }
+
+    if (listener->rcvbuf > 0) {
+        set_listen_option(server_fd, SOL_SOCKET, SO_RCVBUF, listener->rcvbuf, "rcvbuf");
+    }
+    if (listener->sndbuf > 0) {
+        set_listen_option(server_fd, SOL_SOCKET, SO_SNDBUF, listener->sndbuf, "sndbuf");
+    }
+#ifdef SO_BUSY_POLL
+    if (listener->busy_poll > 0) {
+        set_listen_option(server_fd, SOL_SOCKET, SO_BUSY_POLL, listener->busy_poll, "so_busy_poll");
+    }
+#endif
+    // TCP_FASTOPEN：SYN中携带的请求数据在三次握手完成前即可交给应用，节省一个RTT
+    if (listener->fastopen > 0) {
+        set_listen_option(server_fd, IPPROTO_TCP, TCP_FASTOPEN, listener->fastopen, "fastopen");
+    }
+    // TCP_DEFER_ACCEPT：连接收到首个数据包后才进入accept队列，worker不会为空连接唤醒
+    if (listener->deferred) {
+        set_listen_option(server_fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, 1, "deferred");
+    }
+
   server_addr.sin_family = AF_INET;
   server_addr.sin_addr.s_addr = INADDR_ANY;
   server_addr.sin_port = htons(port);
@@ -123,7 +132,7 @@ int create_server_socket(int port) {
     error_and_exit(msg);
   }
 
-    if (listen(server_fd, 1024) < 0) {  // 增加backlog
+    if (listen(server_fd, listener->backlog > 0 ? listener->backlog : LISTEN_DEFAULT_BACKLOG) < 0) {
     error_and_exit("listen failed");
   }
 
@@ -134,18 +143,143 @@ int create_server_socket(int port) {
   return server_fd;
 }
 
+// 连接超时：任一阶段超时都直接关闭连接
+static void connection_timeout_handler(timer_node_t *timer) {
+    connection_t *conn = (connection_t *)timer->data;
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Connection from %s timed out in state %d, closing",
+             conn->client_ip, conn->state);
+    log_message(LOG_LEVEL_DEBUG, msg);
+    free_connection(conn);
+}
+
+// 为reuseport组挂载CBPF分发程序：按处理该数据包的CPU选择组内socket
+// 组内socket按创建顺序编号，worker i使用第i个socket并绑定在CPU i上，
+// 因此连接会落在与网卡软中断同核的worker上
+// 程序按"CPU % 组大小"选择socket，只有worker数等于在线CPU数时socket下标才与
+// worker绑定的CPU一致；数量不同时不挂载，保留内核默认的哈希分发
+int attach_reuseport_cbpf(int fd, int group_size) {
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu > 0 && group_size != ncpu) {
+        char msg[160];
+        snprintf(msg, sizeof(msg),
+                 "reuseport_bpf ignored: %d workers but %ld online CPUs, set workers to the CPU count",
+                 group_size, ncpu);
+        log_message(LOG_LEVEL_WARNING, msg);
+        return -1;
+    }
+
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU) },  // A = 当前CPU
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)group_size },               // A = A % 组大小
+        { BPF_RET | BPF_A, 0, 0, 0 },                                            // 返回socket下标
+    };
+    struct sock_fprog prog = { .len = sizeof(code) / sizeof(code[0]), .filter = code };
+
+    if (group_size <= 0) return -1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Failed to attach reuseport CBPF program: %s", strerror(errno));
+        log_message(LOG_LEVEL_WARNING, msg);
+        return -1;
+    }
+    return 0;
+#else
+    (void)fd;
+    (void)group_size;
+    log_message(LOG_LEVEL_WARNING, "SO_ATTACH_REUSEPORT_CBPF not supported on this platform");
+    return -1;
+#endif
+}
+
+// 将当前worker绑定到第(worker_index % 在线CPU数)个CPU
+int set_worker_cpu_affinity(int worker_index) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu <= 0) return -1;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(worker_index % ncpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Failed to bind worker %d to CPU %ld: %s",
+                 worker_index, worker_index % ncpu, strerror(errno));
+        log_message(LOG_LEVEL_WARNING, msg);
+        return -1;
+    }
+    return 0;
+}
+
+// 为新接受的客户端socket分配连接槽，初始化TLS并启动请求头超时
+// TLS连接的client_fd必须是非阻塞的；失败时关闭client_fd并返回NULL
+connection_t *open_connection(int client_fd, const struct sockaddr_in *client_addr,
+                              const listening_socket_t *listener, core_config_t *core_config) {
+    SSL_CTX *ssl_ctx = listener->is_ssl ? listener->ssl_ctx : NULL;
+
+    // 获取空闲连接槽
+    connection_t* conn = connection_pool_alloc();
+    if (!conn) {
+        log_message(LOG_LEVEL_WARNING, "Connection pool full, closing connection");
+        close(client_fd);
+        return NULL;
+    }
+    
+    // 设置连接信息
+    conn->fd = client_fd;
+    conn->state = CONN_STATE_READING_HEADERS;
+    conn->is_https = ssl_ctx != NULL;
+    conn->local_port = listener->port;
+    conn_buffer_reset(conn);  // 槽位复用时不能残留上一个连接的请求
+    conn->request_start = 0;
+    conn->request_len = 0;
+    conn->request_unframed = 0;
+    conn->request_error = 0;
+    http_request_reset(&conn->request);
+    conn->requests = 0;
+    http_response_init(&conn->response);
+    timer_node_init(&conn->timer, connection_timeout_handler, conn);
+    timer_add(&conn_timers, &conn->timer, core_config->client_header_timeout);
+    
+    inet_ntop(AF_INET, &client_addr->sin_addr, conn->client_ip, INET_ADDRSTRLEN);
+    
+    // 处理HTTPS连接
+    if (ssl_ctx) {
+        conn->ssl = SSL_new(ssl_ctx);
+        if (!conn->ssl) {
+            log_message(LOG_LEVEL_ERROR, "Failed to create SSL context");
+            free_connection(conn);
+            return NULL;
+        }
+        
+        SSL_set_fd(conn->ssl, client_fd);
+        // 非阻塞写：允许部分写入，并允许EAGAIN后用不同地址的缓冲区重试
+        SSL_set_mode(conn->ssl, SSL_MODE_ENABLE_PARTIAL_WRITE |
+                                SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+        
+        // 握手不在accept路径上执行，由后续的读写就绪事件推进
+        SSL_set_accept_state(conn->ssl);
+        conn->state = CONN_STATE_SSL_HANDSHAKE;
+    }
+    
+    return conn;
+}
+
 // 优化的批量连接接受
-int accept_connections_batch(int epoll_fd, int server_fd, int is_https, 
+int accept_connections_batch(int epoll_fd, const listening_socket_t *listener,
                            struct epoll_event* events, int* event_count,
-                           SSL_CTX* ssl_ctx, core_config_t* core_config) {
-    (void)core_config; // 未使用的参数
+                           core_config_t* core_config) {
+    (void)events;
     int accepted = 0;
     struct sockaddr_in client_addr;
     socklen_t client_len = sizeof(client_addr);
     
     // 批量接受连接
     for (int i = 0; i < MAX_ACCEPT_PER_ROUND && accepted < MAX_EVENTS - *event_count; i++) {
-        int client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &client_len);
+        client_len = sizeof(client_addr);
+        // accept4直接返回非阻塞socket，省去两次fcntl
+        int client_fd = accept4(listener->fd, (struct sockaddr *)&client_addr, &client_len,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC);
         if (client_fd == -1) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 break;  // 没有更多连接
@@ -154,143 +288,179 @@ int accept_connections_batch(int epoll_fd, int server_fd, int is_https,
             continue;
         }
         
-        // 获取空闲连接槽
-        connection_t* conn = get_free_connection();
-        if (!conn) {
-            log_message(LOG_LEVEL_WARNING, "Connection pool full, closing connection");
-            close(client_fd);
-            continue;
-        }
-        
-        // 设置连接信息
-        conn->fd = client_fd;
-        conn->is_https = is_https;
-        conn->last_activity = time(NULL);
-        conn->buffer_size = 0;
-        
-        inet_ntop(AF_INET, &client_addr.sin_addr, conn->client_ip, INET_ADDRSTRLEN);
-        
-        // 设置客户端socket为非阻塞
-        if (make_socket_non_blocking(client_fd) == -1) {
-            log_message(LOG_LEVEL_ERROR, "Failed to set client socket non-blocking");
-            free_connection(conn);
-            close(client_fd);
-            continue;
-        }
-        
-        // 处理HTTPS连接
-        if (is_https && ssl_ctx) {
-            conn->ssl = SSL_new(ssl_ctx);
-            if (!conn->ssl) {
-                log_message(LOG_LEVEL_ERROR, "Failed to create SSL context");
-                free_connection(conn);
-                close(client_fd);
-                continue;
-            }
-            
-            SSL_set_fd(conn->ssl, client_fd);
-            
-            // 执行SSL握手
-            int ssl_result = SSL_accept(conn->ssl);
-            if (ssl_result <= 0) {
-                int ssl_error = SSL_get_error(conn->ssl, ssl_result);
-                if (ssl_error == SSL_ERROR_WANT_READ || ssl_error == SSL_ERROR_WANT_WRITE) {
-                    // 需要更多数据，继续等待
-                    log_message(LOG_LEVEL_DEBUG, "SSL handshake in progress");
-                } else {
-                    log_message(LOG_LEVEL_ERROR, "SSL handshake failed");
-                    free_connection(conn);
-                    close(client_fd);
-                    continue;
-                }
-            }
-        }
+        connection_t* conn = open_connection(client_fd, &client_addr, listener, core_config);
+        if (!conn) continue;
         
-        // 添加到epoll事件
+        // 添加到epoll事件：同时关注读写就绪，边缘触发下写就绪只在缓冲区由满变空时通知
         struct epoll_event event;
         event.data.ptr = conn;
-        event.events = EPOLLIN | EPOLLET;  // 使用边缘触发
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
         
         if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &event) == -1) {
             log_message(LOG_LEVEL_ERROR, "Failed to add client fd to epoll");
             free_connection(conn);
-            close(client_fd);
             continue;
         }
         
-        connection_pool_size++;
         accepted++;
     }
     
     return accepted;
 }
 
-// 优化的HTTP请求处理
-static int handle_http_request_optimized(connection_t* conn, core_config_t* core_config) {
-    if (!conn || conn->fd == -1) return -1;
-    
-    // 读取请求数据
-    ssize_t bytes_read = 0;
-    if (conn->is_https && conn->ssl) {
-        bytes_read = SSL_read(conn->ssl, conn->buffer + conn->buffer_size, 
-                             sizeof(conn->buffer) - conn->buffer_size - 1);
-    } else {
-        bytes_read = recv(conn->fd, conn->buffer + conn->buffer_size, 
-                         sizeof(conn->buffer) - conn->buffer_size - 1, 0);
+// 读取请求：边缘触发下必须读到EAGAIN为止
+// 缓冲区中已有完整的流水线请求时不再读取，剩余数据留在内核中等待下一轮
+// 返回1表示请求完整，0表示需要等待更多数据，-1表示需要关闭连接
+static int read_request_headers(connection_t* conn) {
+    if (conn->buffer_size > conn->request_start && conn_parse_request_frame(conn)) {
+        return 1;
     }
-    
-    if (bytes_read <= 0) {
-        // 连接关闭或错误
-        free_connection(conn);
-        return -1;
+
+    for (;;) {
+        size_t space = conn_reserve_buffer(conn);
+        if (space == 0) {
+            // 请求头超出large_client_header_buffers，回复431
+            log_message(LOG_LEVEL_WARNING, "Request header too large");
+            conn_reject_request(conn, 431);
+            return 1;
+        }
+
+        ssize_t bytes_read = conn_recv(conn, conn->buffer + conn->buffer_size, space);
+        if (bytes_read == ANX_AGAIN) {
+            return 0;
+        }
+        if (bytes_read <= 0) {
+            // 连接关闭或错误
+            return -1;
+        }
+
+        conn->buffer_size += bytes_read;
+        conn->buffer[conn->buffer_size] = '\0';
+
+        if (conn_parse_request_frame(conn)) {
+            return 1;
+        }
     }
-    
-    conn->buffer_size += bytes_read;
-    conn->buffer[conn->buffer_size] = '\0';
-    conn->last_activity = time(NULL);
-    
-    // 检查是否收到完整的HTTP请求
-    char* header_end = asm_opt_strstr(conn->buffer, "\r\n\r\n");
-    if (!header_end) {
-        // 请求不完整，继续等待
-        return 0;
+}
+
+// 为当前请求生成响应：处理函数只看到[request_start, request_start+request_len)，
+// 临时在请求末尾写入'\0'，使流水线中的下一个请求对字符串解析不可见
+int route_request(connection_t* conn, core_config_t* core_config) {
+    char *end = conn_request(conn) + conn->request_len;
+    char saved = *end;
+
+    http_response_init(&conn->response);
+    if (conn->request_error) {
+        return http_response_set_error(&conn->response, conn->request_error);
     }
-    
-    // 处理HTTP请求
-    if (conn->is_https && conn->ssl) {
-        handle_https_request(conn->ssl, conn->client_ip, core_config);
-    } else {
-        handle_http_request(conn->fd, conn->client_ip, core_config);
+    *end = '\0';
+    int rc = conn->is_https && conn->ssl
+                 ? handle_https_request(conn, core_config)
+                 : handle_http_request(conn, core_config);
+    *end = saved;
+    return rc;
+}
+
+// 延迟关闭：先半关闭写端，再排空对端仍在发送的数据
+// 直接close()一个接收缓冲区非空的socket会触发RST，导致客户端丢弃尚未读取的响应
+// 返回0表示继续等待对端关闭，-1表示可以释放连接
+static int lingering_close(connection_t* conn) {
+    if (conn->state != CONN_STATE_LINGERING) {
+        if (conn->ssl) {
+            SSL_shutdown(conn->ssl);  // 非阻塞发送close_notify，不等待对端回应
+        }
+        shutdown(conn->fd, SHUT_WR);
+        conn->state = CONN_STATE_LINGERING;
+        timer_add(&conn_timers, &conn->timer, LINGERING_TIMEOUT_MS);
     }
-    
-    // 检查是否应该保持连接 (HTTP/1.1 默认保持连接，除非指定 Connection: close)
-    int keep_alive = 1;  // 默认保持连接
-    char* connection_hdr = strcasestr(conn->buffer, "Connection:");
-    if (connection_hdr) {
-        char* end = asm_opt_strstr(connection_hdr, "\r\n");
-        if (end) {
-            *end = '\0';
-            if (strcasestr(connection_hdr, "close")) {
-                keep_alive = 0;
-            }
-            *end = '\r';
+
+    char drain[512];
+    for (;;) {
+        ssize_t n = recv(conn->fd, drain, sizeof(drain), 0);
+        if (n > 0) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return 0;
         }
+        return -1;  // 对端已关闭或出错
     }
-    
-    if (keep_alive) {
-        // 重置连接状态以处理下一个请求
-        conn->buffer_size = 0;
-        memset(conn->buffer, 0, sizeof(conn->buffer));
-        return 0;
-    } else {
-        // 关闭连接
-        free_connection(conn);
-        return -1;
+}
+
+// 驱动连接状态机，直到需要等待新的就绪事件
+// 返回0表示连接继续存活，-1表示连接应被关闭
+int handle_http_request_optimized(connection_t* conn, core_config_t* core_config) {
+    if (!conn || conn->fd == -1) return -1;
+
+    for (;;) {
+        switch (conn->state) {
+        case CONN_STATE_SSL_HANDSHAKE: {
+            int rc = conn_ssl_handshake(conn);
+            if (rc == ANX_AGAIN) return 0;  // 握手超时沿用client_header_timeout
+            if (rc != ANX_OK) {
+                log_message(LOG_LEVEL_DEBUG, "SSL handshake failed");
+                return -1;
+            }
+            conn->state = CONN_STATE_READING_HEADERS;
+            break;
+        }
+
+        case CONN_STATE_READING_HEADERS: {
+            size_t received = conn->buffer_size - conn->request_start;
+            int rc = read_request_headers(conn);
+            if (rc < 0) return rc;
+            // keepalive等待结束，下一个请求的首字节到达后改用请求头超时
+            if (received == 0 && conn->buffer_size > conn->request_start) {
+                timer_add(&conn_timers, &conn->timer, core_config->client_header_timeout);
+            }
+            if (rc == 0) return 0;
+            conn->state = CONN_STATE_ROUTING;
+            break;
+        }
+
+        case CONN_STATE_ROUTING: {
+            // 由处理函数根据请求生成响应，不直接读写socket
+            if (route_request(conn, core_config) < 0) return -1;
+            conn->state = CONN_STATE_WRITING_HEADERS;
+            break;
+        }
+
+        case CONN_STATE_WRITING_HEADERS:
+        case CONN_STATE_SENDING_BODY: {
+            int rc = conn_flush_response(conn);
+            if (rc == ANX_AGAIN) {
+                // send_timeout：两次成功写之间的最长间隔
+                timer_add(&conn_timers, &conn->timer, core_config->send_timeout);
+                return 0;  // 等待EPOLLOUT后继续发送
+            }
+            if (rc != ANX_OK) return -1;
+            break;
+        }
+
+        case CONN_STATE_KEEPALIVE:
+            // 推进到下一个请求：流水线请求已在缓冲区中时立即处理，按顺序发送响应
+            conn_advance_request(conn);
+            conn->state = CONN_STATE_READING_HEADERS;
+            timer_add(&conn_timers, &conn->timer,
+                      conn->buffer_size > conn->request_start
+                          ? core_config->client_header_timeout
+                          : core_config->keepalive_timeout);
+            break;
+
+        case CONN_STATE_CLOSING:
+        case CONN_STATE_LINGERING:
+            return lingering_close(conn);
+
+        default:
+            return -1;
+        }
     }
 }
 
+// 监听socket的epoll数据：数组下标左移一位并置最低位；连接指针按8字节对齐，最低位为0
+#define LISTENER_EVENT_TAG 1ULL
+#define LISTENER_EVENT_DATA(index) (((uint64_t)(index) << 1) | LISTENER_EVENT_TAG)
+
 // 优化的worker循环
-void worker_loop(int server_fd, int https_server_fd, core_config_t *core_config, SSL_CTX *ssl_ctx) {
+void worker_loop(listening_socket_t *listeners, int listener_count, core_config_t *core_config) {
   int epoll_fd;
   struct epoll_event event;
 
@@ -298,97 +468,100 @@ void worker_loop(int server_fd, int https_server_fd, core_config_t *core_config,
   if (epoll_fd == -1) error_and_exit("epoll_create1 (worker)");
 
     // 初始化连接池
-    if (init_connection_pool(1000) < 0) {
+    if (connection_pool_init(core_config->worker_connections) < 0) {
         close(epoll_fd);
         return;
     }
+    conn_large_buffers_init(core_config->large_header_buffer_size,
+                            core_config->large_header_buffers);
+    open_file_cache_init(core_config->open_file_cache_max, core_config->open_file_cache_inactive,
+                         core_config->open_file_cache_valid, core_config->open_file_cache_errors);
+    compress_pool_init(core_config->raw_config && core_config->raw_config->compress
+                           ? core_config->raw_config->compress->pool_size : 0);
+    timer_wheel_init(&conn_timers, timer_now_ms());
 
-    // 添加服务器socket到epoll
-  if (server_fd != -1) {
-    event.data.fd = server_fd;
-        event.events = EPOLLIN | EPOLLET;
-    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &event) == -1) {
-        log_message(LOG_LEVEL_ERROR, "Failed to add http_fd to epoll");
-        close(epoll_fd);
-        return;
+    // io_uring后端：内核不支持时返回-1，继续使用epoll
+    if (core_config->event_engine == EVENT_ENGINE_IO_URING) {
+        if (uring_worker_loop(listeners, listener_count, core_config) == 0) {
+            connection_pool_destroy();
+            open_file_cache_destroy();
+            compress_pool_destroy();
+            close(epoll_fd);
+            return;
+        }
+        log_message(LOG_LEVEL_WARNING, "io_uring not supported by the kernel, falling back to epoll");
     }
-  }
-    
-  if (https_server_fd != -1) {
-    event.data.fd = https_server_fd;
+
+    // 添加全部监听socket到epoll
+    for (int j = 0; j < listener_count; j++) {
+        if (listeners[j].fd == -1) continue;
+        event.data.u64 = LISTENER_EVENT_DATA(j);
         event.events = EPOLLIN | EPOLLET;
-    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, https_server_fd, &event) == -1) {
-        log_message(LOG_LEVEL_ERROR, "Failed to add https_fd to epoll");
-        close(epoll_fd);
-        return;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listeners[j].fd, &event) == -1) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Failed to add listener on port %d to epoll", listeners[j].port);
+            log_message(LOG_LEVEL_ERROR, msg);
+            close(epoll_fd);
+            return;
+        }
     }
-  }
 
   struct epoll_event events[MAX_EVENTS];
 
     log_message(LOG_LEVEL_INFO, "Optimized worker process started.");
 
   while (1) {
-        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, EPOLL_TIMEOUT_MS);
+        // 没有待处理事件时一直睡眠到下一个定时器到期
+        int timeout = timer_wheel_next_timeout(&conn_timers, timer_now_ms());
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+        timer_wheel_update_time(&conn_timers, timer_now_ms());
         
     for (int i = 0; i < n; i++) {
-      if ((events[i].events & EPOLLERR) || (events[i].events & EPOLLHUP)) {
-                // 处理错误连接
-                if (events[i].data.ptr) {
-                    connection_t* conn = (connection_t*)events[i].data.ptr;
-                    free_connection(conn);
-                } else {
-        close(events[i].data.fd);
-                }
-        continue;
-      }
-
-            // 检查是否是服务器socket（新连接）
-            if (events[i].data.fd == server_fd || events[i].data.fd == https_server_fd) {
-                int is_https = (events[i].data.fd == https_server_fd);
-                accept_connections_batch(epoll_fd, events[i].data.fd, is_https, events, &i, ssl_ctx, core_config);
-            } else {
-                // 处理客户端连接
-                connection_t* conn = (connection_t*)events[i].data.ptr;
-                if (conn) {
-                    int result = handle_http_request_optimized(conn, core_config);
-                    if (result == -1) {
-                        // 如果处理失败，从epoll中移除并关闭连接
-                        if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL) == -1) {
-                            log_message(LOG_LEVEL_ERROR, "Failed to remove client fd from epoll");
-                        }
-                        free_connection(conn);
-                    }
-                }
+            // 检查是否是监听socket（新连接）
+            if (events[i].data.u64 & LISTENER_EVENT_TAG) {
+                listening_socket_t *listener = &listeners[events[i].data.u64 >> 1];
+                accept_connections_batch(epoll_fd, listener, events, &i, core_config);
+                continue;
             }
-        }
-        
-        // 定期清理超时连接
-        static time_t last_cleanup = 0;
-        time_t current_time = time(NULL);
-        if (current_time - last_cleanup > 30) {  // 每30秒清理一次
-            for (int i = 0; i < connection_pool_capacity; i++) {
-                if (connection_pool[i].fd != -1 && 
-                    current_time - connection_pool[i].last_activity > 300) {  // 5分钟超时
-                    free_connection(&connection_pool[i]);
-                }
+
+            // 处理客户端连接
+            connection_t* conn = (connection_t*)events[i].data.ptr;
+            if (!conn || conn->fd == -1) continue;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                free_connection(conn);
+                continue;
+            }
+
+            // 仅在连接等待对应事件时推进状态机，避免多余的系统调用
+            // TLS握手可能等待任一方向（WANT_READ/WANT_WRITE），两种事件都推进
+            int wants_read = (conn->state == CONN_STATE_READING_HEADERS ||
+                              conn->state == CONN_STATE_LINGERING ||
+                              conn->state == CONN_STATE_SSL_HANDSHAKE) &&
+                             (events[i].events & (EPOLLIN | EPOLLRDHUP));
+            int wants_write = (conn->state == CONN_STATE_WRITING_HEADERS ||
+                               conn->state == CONN_STATE_SENDING_BODY ||
+                               conn->state == CONN_STATE_SSL_HANDSHAKE) &&
+                              (events[i].events & (EPOLLOUT | EPOLLIN));
+            if (!wants_read && !wants_write) continue;
+
+            if (handle_http_request_optimized(conn, core_config) == -1) {
+                free_connection(conn);
             }
-            last_cleanup = current_time;
         }
+        
+        // 处理到期的连接定时器，代价只与到期数量相关
+        timer_wheel_expire(&conn_timers, conn_timers.now);
     }
     
     // 清理资源
-    if (connection_pool) {
-        for (int i = 0; i < connection_pool_capacity; i++) {
-            if (connection_pool[i].fd != -1) {
-                close(connection_pool[i].fd);
-                if (connection_pool[i].ssl) {
-                    SSL_free(connection_pool[i].ssl);
-                }
-            }
-        }
-        free(connection_pool);
+    int capacity = connection_pool_capacity();
+    for (int i = 0; i < capacity; i++) {
+        free_connection(connection_pool_get(i));
     }
+    connection_pool_destroy();
+    open_file_cache_destroy();
+    compress_pool_destroy();
     
     close(epoll_fd);
 }
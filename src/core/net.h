@@ -4,19 +4,48 @@
 #include <sys/epoll.h>
 #include <openssl/ssl.h>
 #include "core.h"
+#include "connection.h"
+#include "timer.h"
 
-// Creates a server socket, binds it to a port, and puts it in listen mode.
-int create_server_socket(int port);
+#define LINGERING_TIMEOUT_MS 5000  // 延迟关闭的最长等待时间
 
-// Starts the main event loop for a worker process.
-void worker_loop(int server_fd, int https_server_fd, core_config_t *core_config, SSL_CTX *ssl_ctx);
+// Creates a server socket for the listener, binds it to its port and puts it in listen mode.
+// Applies the listen parameters (reuseport, backlog, fastopen, deferred, buffers, busy poll).
+int create_server_socket(const listening_socket_t *listener);
 
-// Forward declaration of the connection structure
-typedef struct connection_t connection_t;
+// Attaches a CBPF program steering connections of a reuseport group by CPU.
+// Only attached when group_size equals the number of online CPUs (socket i
+// belongs to the worker pinned to CPU i); otherwise logs a warning and returns -1.
+int attach_reuseport_cbpf(int fd, int group_size);
+
+// Pins the calling worker process to a CPU (worker_cpu_affinity auto).
+int set_worker_cpu_affinity(int worker_index);
+
+// Starts the main event loop for a worker process, serving every listener
+// whose fd is valid. Each listener brings its own port and SSL context.
+void worker_loop(listening_socket_t *listeners, int listener_count, core_config_t *core_config);
 
 // Accept multiple connections in a batch
-int accept_connections_batch(int epoll_fd, int server_fd, int is_https, 
+int accept_connections_batch(int epoll_fd, const listening_socket_t *listener,
                            struct epoll_event* events, int* event_count,
-                           SSL_CTX* ssl_ctx, core_config_t* core_config);
+                           core_config_t* core_config);
+
+// 以下接口由epoll与io_uring两种事件后端共用
+
+// 当前worker的连接超时时间轮
+extern timer_wheel_t conn_timers;
+
+// 为从listener接受的客户端socket分配连接（TLS连接的socket须为非阻塞）；失败时关闭client_fd并返回NULL
+connection_t *open_connection(int client_fd, const struct sockaddr_in *client_addr,
+                              const listening_socket_t *listener, core_config_t *core_config);
+
+// 关闭socket并归还连接槽
+void free_connection(connection_t *conn);
+
+// 调用HTTP/HTTPS处理函数为conn当前（已定界的）请求生成响应
+int route_request(connection_t *conn, core_config_t *core_config);
+
+// 在就绪事件上推进连接状态机；返回-1表示连接应被关闭
+int handle_http_request_optimized(connection_t *conn, core_config_t *core_config);
 
 #endif  // NET_H 
\ No newline at end of file
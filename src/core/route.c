@@ -0,0 +1,647 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "route.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "../include/anx_rust.h"
+
+// location前缀基数树的节点，前缀location和"="精确location共用一棵树
+// 边标签直接指向location路径字符串内部，配置存活期间一直有效，拆分节点时只调整指针和长度
+typedef struct loc_node {
+    const char *label;
+    size_t label_len;
+    location_block_t *location;   // 路径恰好在此结束的前缀location（含"^~"），没有时为NULL
+    location_conf_t *conf;        // location的运行时配置，随节点释放
+    location_block_t *exact;      // 路径恰好在此结束的"="location
+    location_conf_t *exact_conf;
+    struct loc_node **children;   // 按标签首字节升序排列，首字节互不相同
+    int child_count;
+} loc_node_t;
+
+typedef struct {
+    server_block_t *block;
+    location_conf_t *conf;   // server本身的运行时配置
+    loc_node_t *locations;   // 根节点，标签为空
+    LocationRegexHandle *regex;          // "~"/"~*"location合并编译的匹配器，没有时为NULL
+    location_block_t **regex_locations;  // 按配置顺序，下标即匹配器返回的模式序号
+    location_conf_t **regex_confs;
+    int regex_count;
+} route_server_t;
+
+// 开放寻址（线性探测）哈希表，键为小写的主机名
+typedef struct {
+    char *name;
+    size_t len;
+    route_server_t *server;
+} name_slot_t;
+
+typedef struct {
+    name_slot_t *slots;
+    size_t mask;     // 容量-1，容量为2的幂
+    size_t count;
+} name_hash_t;
+
+typedef struct {
+    int port;
+    name_hash_t exact;
+    name_hash_t wildcard_head;   // "*.example.com"和".example.com"，键为"example.com"
+    name_hash_t wildcard_tail;   // "www.example.*"，键为"www.example"
+    route_server_t *default_server;
+    int explicit_default;        // default_server来自listen的default_server参数
+} route_port_t;
+
+struct route_table {
+    unsigned long generation;    // 区分先后创建的路由表，使旧表的正则缓存项失效
+    location_conf_t *http_conf;  // http级配置，server的继承来源
+    route_server_t *servers;     // 与http块中的server一一对应，顺序相同
+    int server_count;
+    route_port_t *ports;
+    int port_count;
+};
+
+static inline unsigned char ascii_lower(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
+}
+
+// FNV-1a，查找时直接对原始Host按小写计算，无需先复制转换
+static uint64_t name_hash(const char *s, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= ascii_lower((unsigned char)s[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static int name_equals(const name_slot_t *slot, const char *s, size_t len) {
+    if (slot->len != len) return 0;
+    for (size_t i = 0; i < len; i++) {
+        if ((unsigned char)slot->name[i] != ascii_lower((unsigned char)s[i])) return 0;
+    }
+    return 1;
+}
+
+static route_server_t *name_hash_find(const name_hash_t *h, const char *s, size_t len) {
+    if (h->count == 0) return NULL;
+    for (size_t i = name_hash(s, len) & h->mask;; i = (i + 1) & h->mask) {
+        const name_slot_t *slot = &h->slots[i];
+        if (!slot->name) return NULL;
+        if (name_equals(slot, s, len)) return slot->server;
+    }
+}
+
+static void name_hash_place(name_hash_t *h, name_slot_t entry) {
+    size_t i = name_hash(entry.name, entry.len) & h->mask;
+    while (h->slots[i].name) i = (i + 1) & h->mask;
+    h->slots[i] = entry;
+}
+
+// 装载因子保持在1/2以下
+static int name_hash_grow(name_hash_t *h) {
+    size_t cap = h->slots ? (h->mask + 1) * 2 : 8;
+    name_slot_t *old = h->slots;
+    size_t old_cap = old ? h->mask + 1 : 0;
+
+    h->slots = calloc(cap, sizeof(name_slot_t));
+    if (!h->slots) {
+        h->slots = old;
+        return -1;
+    }
+    h->mask = cap - 1;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old[i].name) name_hash_place(h, old[i]);
+    }
+    free(old);
+    return 0;
+}
+
+// 同一端口上名称重复时保留先出现的server（与nginx相同），返回-1表示内存不足
+static int name_hash_insert(name_hash_t *h, const char *name, size_t len,
+                            route_server_t *server, int port) {
+    route_server_t *existing = name_hash_find(h, name, len);
+    if (existing) {
+        if (existing != server) {
+            char msg[320];
+            snprintf(msg, sizeof(msg), "Conflicting server name \"%.*s\" on port %d, ignored",
+                     (int)len, name, port);
+            log_message(LOG_LEVEL_WARNING, msg);
+        }
+        return 0;
+    }
+
+    if ((h->count + 1) * 2 > (h->slots ? h->mask + 1 : 0) && name_hash_grow(h) < 0) return -1;
+
+    name_slot_t entry = { malloc(len + 1), len, server };
+    if (!entry.name) return -1;
+    for (size_t i = 0; i < len; i++) entry.name[i] = (char)ascii_lower((unsigned char)name[i]);
+    entry.name[len] = '\0';
+    name_hash_place(h, entry);
+    h->count++;
+    return 0;
+}
+
+static void name_hash_free(name_hash_t *h) {
+    if (!h->slots) return;
+    for (size_t i = 0; i <= h->mask; i++) free(h->slots[i].name);
+    free(h->slots);
+}
+
+static loc_node_t *loc_node_new(const char *label, size_t len) {
+    loc_node_t *node = calloc(1, sizeof(loc_node_t));
+    if (node) {
+        node->label = label;
+        node->label_len = len;
+    }
+    return node;
+}
+
+// 按首字节二分查找子节点；未找到时返回-1，*pos为插入位置
+static int loc_child_index(const loc_node_t *node, unsigned char c, int *pos) {
+    int lo = 0, hi = node->child_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        unsigned char first = (unsigned char)node->children[mid]->label[0];
+        if (first == c) return mid;
+        if (first < c) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *pos = lo;
+    return -1;
+}
+
+static int loc_node_add_child(loc_node_t *node, loc_node_t *child, int pos) {
+    loc_node_t **children = realloc(node->children, (node->child_count + 1) * sizeof(loc_node_t *));
+    if (!children) return -1;
+    memmove(children + pos + 1, children + pos, (node->child_count - pos) * sizeof(loc_node_t *));
+    children[pos] = child;
+    node->children = children;
+    node->child_count++;
+    return 0;
+}
+
+// 返回1表示同一路径已存在（conf未被接管），-1表示内存不足
+// "="location放在节点的exact上，与同一路径的前缀location互不影响
+static int loc_trie_insert(loc_node_t *root, location_block_t *loc, location_conf_t *conf) {
+    const char *p = loc->path;
+    size_t rem = strlen(p);
+    loc_node_t *node = root;
+
+    while (rem > 0) {
+        int pos = 0;
+        int i = loc_child_index(node, (unsigned char)*p, &pos);
+        if (i < 0) {
+            loc_node_t *leaf = loc_node_new(p, rem);
+            if (!leaf || loc_node_add_child(node, leaf, pos) < 0) {
+                free(leaf);
+                return -1;
+            }
+            node = leaf;
+            break;
+        }
+
+        loc_node_t *child = node->children[i];
+        size_t k = 0;
+        while (k < child->label_len && k < rem && child->label[k] == p[k]) k++;
+
+        if (k < child->label_len) {
+            // 只共享前k个字节：插入一个中间节点，原节点保留剩余的标签
+            loc_node_t *mid = loc_node_new(child->label, k);
+            if (!mid) return -1;
+            mid->children = malloc(sizeof(loc_node_t *));
+            if (!mid->children) {
+                free(mid);
+                return -1;
+            }
+            mid->children[0] = child;
+            mid->child_count = 1;
+            child->label += k;
+            child->label_len -= k;
+            node->children[i] = mid;
+            child = mid;
+        }
+        node = child;
+        p += k;
+        rem -= k;
+    }
+
+    // 同一路径重复出现时保留第一个，与原先的线性查找一致
+    if (loc->match == LOCATION_MATCH_EXACT) {
+        if (node->exact) return 1;
+        node->exact = loc;
+        node->exact_conf = conf;
+        return 0;
+    }
+    if (node->location) return 1;
+    node->location = loc;
+    node->conf = conf;
+    return 0;
+}
+
+// 返回最长前缀location所在的节点；path恰好在某个节点结束且有"="location时由*exact返回该节点
+static const loc_node_t *loc_trie_match(const loc_node_t *root, const char *path, size_t len,
+                                        const loc_node_t **exact) {
+    const loc_node_t *node = root;
+    const loc_node_t *best = root->location ? root : NULL;
+
+    while (len > 0) {
+        int pos;
+        int i = loc_child_index(node, (unsigned char)*path, &pos);
+        if (i < 0) break;
+        node = node->children[i];
+        if (node->label_len > len || memcmp(path, node->label, node->label_len) != 0) break;
+        path += node->label_len;
+        len -= node->label_len;
+        if (node->location) best = node;
+    }
+    *exact = len == 0 && node->exact ? node : NULL;
+    return best;
+}
+
+static void loc_trie_free(loc_node_t *node) {
+    if (!node) return;
+    for (int i = 0; i < node->child_count; i++) loc_trie_free(node->children[i]);
+    location_conf_free(node->conf);
+    location_conf_free(node->exact_conf);
+    free(node->children);
+    free(node);
+}
+
+static int route_server_add_regex(route_server_t *rs, location_block_t *loc, location_conf_t *conf) {
+    location_block_t **locations = realloc(rs->regex_locations,
+                                           (rs->regex_count + 1) * sizeof(location_block_t *));
+    if (!locations) return -1;
+    rs->regex_locations = locations;
+    location_conf_t **confs = realloc(rs->regex_confs, (rs->regex_count + 1) * sizeof(location_conf_t *));
+    if (!confs) return -1;
+    rs->regex_confs = confs;
+    locations[rs->regex_count] = loc;
+    confs[rs->regex_count] = conf;
+    rs->regex_count++;
+    return 0;
+}
+
+// 把server的所有正则location编译成一个匹配器，有无效的正则时返回-1
+static int route_server_compile_regex(route_server_t *rs) {
+    if (rs->regex_count == 0) return 0;
+
+    const char **patterns = malloc(rs->regex_count * sizeof(char *));
+    int *icase = malloc(rs->regex_count * sizeof(int));
+    if (!patterns || !icase) {
+        free(patterns);
+        free(icase);
+        return -1;
+    }
+    for (int i = 0; i < rs->regex_count; i++) {
+        patterns[i] = rs->regex_locations[i]->path;
+        icase[i] = rs->regex_locations[i]->match == LOCATION_MATCH_REGEX_ICASE;
+    }
+
+    int err_index = -1;
+    char err[256] = "";
+    rs->regex = anx_location_regex_new(patterns, icase, rs->regex_count, &err_index, err, sizeof(err));
+    free(patterns);
+    free(icase);
+    if (rs->regex) return 0;
+
+    const location_block_t *bad = err_index >= 0 && err_index < rs->regex_count
+                                      ? rs->regex_locations[err_index] : NULL;
+    char msg[640];
+    snprintf(msg, sizeof(msg), "Invalid regex in location %s \"%s\": %s",
+             bad && bad->match == LOCATION_MATCH_REGEX_ICASE ? "~*" : "~",
+             bad ? bad->path : "", err);
+    log_message(LOG_LEVEL_ERROR, msg);
+    return -1;
+}
+
+static route_port_t *route_port_get(route_table_t *rt, int port) {
+    for (int i = 0; i < rt->port_count; i++) {
+        if (rt->ports[i].port == port) return &rt->ports[i];
+    }
+    route_port_t *ports = realloc(rt->ports, (rt->port_count + 1) * sizeof(route_port_t));
+    if (!ports) return NULL;
+    rt->ports = ports;
+    route_port_t *rp = &ports[rt->port_count++];
+    memset(rp, 0, sizeof(*rp));
+    rp->port = port;
+    return rp;
+}
+
+// 把server的所有server_name加入端口的名称表
+static int route_port_add_names(route_port_t *rp, route_server_t *rs) {
+    server_block_t *srv = rs->block;
+
+    for (int i = 0; i < srv->directive_count; i++) {
+        if (strcmp(srv->directives[i].key, "server_name") != 0 || !srv->directives[i].value) continue;
+
+        char *names = strdup(srv->directives[i].value);
+        if (!names) return -1;
+
+        char *save = NULL;
+        int rc = 0;
+        for (char *name = strtok_r(names, " \t", &save); name && rc == 0;
+             name = strtok_r(NULL, " \t", &save)) {
+            size_t len = strlen(name);
+            if (name[0] == '~') {
+                char msg[320];
+                snprintf(msg, sizeof(msg), "Regex server_name \"%s\" is not supported, ignored", name);
+                log_message(LOG_LEVEL_WARNING, msg);
+            } else if (len > 2 && name[0] == '*' && name[1] == '.') {
+                rc = name_hash_insert(&rp->wildcard_head, name + 2, len - 2, rs, rp->port);
+            } else if (len > 1 && name[0] == '.') {
+                // ".example.com"同时匹配example.com本身和它的所有子域名
+                rc = name_hash_insert(&rp->exact, name + 1, len - 1, rs, rp->port);
+                if (rc == 0) rc = name_hash_insert(&rp->wildcard_head, name + 1, len - 1, rs, rp->port);
+            } else if (len > 2 && name[len - 1] == '*' && name[len - 2] == '.') {
+                rc = name_hash_insert(&rp->wildcard_tail, name, len - 2, rs, rp->port);
+            } else {
+                rc = name_hash_insert(&rp->exact, name, len, rs, rp->port);
+            }
+        }
+        free(names);
+        if (rc < 0) return -1;
+    }
+    return 0;
+}
+
+// 按server的listen指令把它登记到对应端口
+static int route_add_listens(route_table_t *rt, route_server_t *rs) {
+    server_block_t *srv = rs->block;
+
+    for (int i = 0; i < srv->directive_count; i++) {
+        if (strcmp(srv->directives[i].key, "listen") != 0 || !srv->directives[i].value) continue;
+
+        char *value = strdup(srv->directives[i].value);
+        if (!value) return -1;
+
+        char *save = NULL;
+        char *token = strtok_r(value, " ", &save);
+        int port = token ? atoi(token) : 0;
+        int is_default = 0;
+        while ((token = strtok_r(NULL, " ", &save)) != NULL) {
+            if (strcmp(token, "default_server") == 0) is_default = 1;
+        }
+        free(value);
+
+        route_port_t *rp = route_port_get(rt, port);
+        if (!rp) return -1;
+
+        if (is_default && !rp->explicit_default) {
+            rp->default_server = rs;
+            rp->explicit_default = 1;
+        } else if (is_default && rp->default_server != rs) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Duplicate default_server for port %d, ignored", port);
+            log_message(LOG_LEVEL_WARNING, msg);
+        } else if (!rp->default_server) {
+            rp->default_server = rs;
+        }
+
+        if (route_port_add_names(rp, rs) < 0) return -1;
+    }
+    return 0;
+}
+
+route_table_t *route_table_create(const config_t *config) {
+    static unsigned long generation;
+
+    route_table_t *rt = calloc(1, sizeof(route_table_t));
+    if (!rt) return NULL;
+    rt->generation = ++generation;
+    if (!config || !config->http) return rt;
+    const http_block_t *http = config->http;
+
+    rt->http_conf = location_conf_create(config, NULL, NULL, NULL);
+    if (!rt->http_conf) goto fail;
+
+    int count = 0;
+    for (server_block_t *srv = http->servers; srv; srv = srv->next) count++;
+    if (count == 0) return rt;
+
+    rt->servers = calloc(count, sizeof(route_server_t));
+    if (!rt->servers) goto fail;
+
+    int locations = 0;
+    for (server_block_t *srv = http->servers; srv; srv = srv->next) {
+        route_server_t *rs = &rt->servers[rt->server_count];
+        rs->block = srv;
+        rs->locations = loc_node_new("", 0);
+        rs->conf = location_conf_create(config, srv, NULL, rt->http_conf);
+        rt->server_count++;
+        if (!rs->locations || !rs->conf) goto fail;
+
+        for (location_block_t *loc = srv->locations; loc; loc = loc->next) {
+            if (!loc->path) continue;
+            location_conf_t *conf = location_conf_create(config, srv, loc, rs->conf);
+            if (!conf) goto fail;
+            int rc;
+            if (loc->match == LOCATION_MATCH_REGEX || loc->match == LOCATION_MATCH_REGEX_ICASE) {
+                rc = route_server_add_regex(rs, loc, conf);
+            } else {
+                rc = loc_trie_insert(rs->locations, loc, conf);
+            }
+            if (rc != 0) location_conf_free(conf);
+            if (rc < 0) goto fail;
+            locations++;
+        }
+        if (route_server_compile_regex(rs) < 0) goto fail;
+        if (route_add_listens(rt, rs) < 0) goto fail;
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Route table compiled: %d servers, %d ports, %d locations",
+             rt->server_count, rt->port_count, locations);
+    log_message(LOG_LEVEL_INFO, msg);
+    return rt;
+
+fail:
+    route_table_free(rt);
+    return NULL;
+}
+
+void route_table_free(route_table_t *rt) {
+    if (!rt) return;
+    // location共用server的root fd，先释放location再释放server
+    for (int i = 0; i < rt->server_count; i++) {
+        route_server_t *rs = &rt->servers[i];
+        loc_trie_free(rs->locations);
+        for (int j = 0; j < rs->regex_count; j++) location_conf_free(rs->regex_confs[j]);
+        anx_location_regex_free(rs->regex);
+        free(rs->regex_locations);
+        free(rs->regex_confs);
+        location_conf_free(rs->conf);
+    }
+    location_conf_free(rt->http_conf);
+    for (int i = 0; i < rt->port_count; i++) {
+        name_hash_free(&rt->ports[i].exact);
+        name_hash_free(&rt->ports[i].wildcard_head);
+        name_hash_free(&rt->ports[i].wildcard_tail);
+    }
+    free(rt->servers);
+    free(rt->ports);
+    free(rt);
+}
+
+// Host头的名称部分：去掉":port"和结尾的'.'，IPv6字面量保留方括号
+static size_t host_name_len(const char *host) {
+    size_t len;
+    if (host[0] == '[') {
+        const char *end = strchr(host, ']');
+        len = end ? (size_t)(end - host) + 1 : strlen(host);
+    } else {
+        len = strcspn(host, ":");
+    }
+    while (len > 0 && host[len - 1] == '.') len--;
+    return len;
+}
+
+static route_server_t *match_server_name(const route_port_t *rp, const char *host, size_t len) {
+    route_server_t *rs = name_hash_find(&rp->exact, host, len);
+    if (rs) return rs;
+
+    // "*.example.com"：从左往右每次去掉一个标签，先命中的后缀最长
+    if (rp->wildcard_head.count) {
+        for (size_t i = 0; i < len; i++) {
+            if (host[i] == '.' && (rs = name_hash_find(&rp->wildcard_head, host + i + 1, len - i - 1))) {
+                return rs;
+            }
+        }
+    }
+    // "www.example.*"：从右往左每次去掉一个标签，先命中的前缀最长
+    if (rp->wildcard_tail.count) {
+        for (size_t i = len; i > 0; i--) {
+            if (host[i - 1] == '.' && (rs = name_hash_find(&rp->wildcard_tail, host, i - 1))) {
+                return rs;
+            }
+        }
+    }
+    return NULL;
+}
+
+// 正则location匹配结果的缓存，直接映射，冲突时覆盖旧项
+// worker是fork出来的进程，各自持有一份，热点路径命中后不再执行正则；只在worker自己的线程中使用
+#define REGEX_CACHE_SIZE 256        // 2的幂
+#define REGEX_CACHE_MAX_PATH 128    // 更长的路径不缓存
+
+typedef struct {
+    const route_server_t *server;   // 为NULL表示空项
+    unsigned long generation;
+    uint64_t hash;
+    int result;                     // 匹配的正则序号，-1表示都不匹配
+    size_t len;
+    char path[REGEX_CACHE_MAX_PATH];
+} regex_cache_entry_t;
+
+static regex_cache_entry_t regex_cache[REGEX_CACHE_SIZE];
+
+static uint64_t path_hash(const char *s, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// 按配置顺序第一个匹配的正则location的序号，没有时返回-1
+static int regex_match(const route_table_t *rt, const route_server_t *rs, const char *path, size_t len) {
+    if (len >= REGEX_CACHE_MAX_PATH) {
+        return anx_location_regex_match(rs->regex, (const uint8_t *)path, len);
+    }
+
+    uint64_t hash = path_hash(path, len);
+    regex_cache_entry_t *e = &regex_cache[(hash ^ ((uintptr_t)rs >> 4)) & (REGEX_CACHE_SIZE - 1)];
+    if (e->server == rs && e->generation == rt->generation && e->hash == hash &&
+        e->len == len && memcmp(e->path, path, len) == 0) {
+        return e->result;
+    }
+
+    int result = anx_location_regex_match(rs->regex, (const uint8_t *)path, len);
+    e->server = rs;
+    e->generation = rt->generation;
+    e->hash = hash;
+    e->result = result;
+    e->len = len;
+    memcpy(e->path, path, len);
+    return result;
+}
+
+// 在server内按nginx的优先级查找location
+static route_t route_server_lookup(const route_table_t *rt, const route_server_t *rs,
+                                   const char *path) {
+    route_t route = {rs->block, NULL, rs->conf};
+    if (!path) return route;
+
+    // 与nginx相同的优先级："="精确匹配；最长前缀是"^~"时直接使用；
+    // 否则按配置顺序第一个匹配的正则；都不满足时使用最长前缀
+    size_t len = strcspn(path, "?");
+    const loc_node_t *exact;
+    const loc_node_t *node = loc_trie_match(rs->locations, path, len, &exact);
+    if (exact) {
+        route.location = exact->exact;
+        route.conf = exact->exact_conf;
+        return route;
+    }
+    if (rs->regex && !(node && node->location->match == LOCATION_MATCH_PREFIX_NOREGEX)) {
+        int i = regex_match(rt, rs, path, len);
+        if (i >= 0 && i < rs->regex_count) {
+            route.location = rs->regex_locations[i];
+            route.conf = rs->regex_confs[i];
+            return route;
+        }
+    }
+    if (node) {
+        route.location = node->location;
+        route.conf = node->conf;
+    }
+    return route;
+}
+
+route_t route_table_lookup(const route_table_t *rt, int port, const char *host, const char *path) {
+    route_t route = {NULL, NULL, NULL};
+    if (!rt || rt->server_count == 0) return route;
+
+    route_server_t *rs = NULL;
+    for (int i = 0; i < rt->port_count; i++) {
+        const route_port_t *rp = &rt->ports[i];
+        if (rp->port != port) continue;
+        if (host) rs = match_server_name(rp, host, host_name_len(host));
+        if (!rs) rs = rp->default_server;
+        break;
+    }
+    if (!rs) rs = &rt->servers[0];
+    return route_server_lookup(rt, rs, path);
+}
+
+int route_table_server_count(const route_table_t *rt) {
+    return rt ? rt->server_count : 0;
+}
+
+static void loc_trie_foreach(const loc_node_t *node, route_conf_fn fn, void *arg) {
+    if (node->conf) fn(node->conf, arg);
+    if (node->exact_conf) fn(node->exact_conf, arg);
+    for (int i = 0; i < node->child_count; i++) loc_trie_foreach(node->children[i], fn, arg);
+}
+
+void route_table_foreach_conf(const route_table_t *rt, int index, route_conf_fn fn, void *arg) {
+    if (!rt || index < 0 || index >= rt->server_count) return;
+    const route_server_t *rs = &rt->servers[index];
+    fn(rs->conf, arg);
+    loc_trie_foreach(rs->locations, fn, arg);
+    for (int i = 0; i < rs->regex_count; i++) fn(rs->regex_confs[i], arg);
+}
+
+route_t route_table_lookup_server(const route_table_t *rt, int index, const char *path) {
+    route_t route = {NULL, NULL, NULL};
+    if (!rt || index < 0 || index >= rt->server_count) return route;
+    return route_server_lookup(rt, &rt->servers[index], path);
+}
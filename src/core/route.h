@@ -0,0 +1,50 @@
+#ifndef ROUTE_H
+#define ROUTE_H
+
+#include <stddef.h>
+
+#include "config.h"
+#include "location_conf.h"
+
+// 编译后的路由表：加载配置时由server/location块构建一次，请求路径上的查找不分配内存
+// - 每个监听端口一张虚拟主机表：精确的server_name走哈希；"*.example.com"（及".example.com"）
+//   前缀通配和"www.example.*"后缀通配各一张哈希，按最长匹配查找
+// - 每个server的前缀和"="location组成一棵基数树，查找只与路径长度相关
+// - "~"/"~*"location合并编译成一个多模式匹配器（Rust regex::RegexSet），一次扫描得到
+//   按配置顺序第一个匹配的正则；worker内缓存最近的匹配结果
+// server的匹配顺序与nginx一致：精确名称、最长前缀通配、最长后缀通配、端口的default_server
+// （带default_server参数的listen，否则为该端口上的第一个server）
+// 每个server和location同时编译出location_conf_t，请求处理直接使用
+
+typedef struct route_table route_table_t;
+
+// This struct holds the result of a routing decision.
+typedef struct {
+    server_block_t *server;
+    location_block_t *location;   // NULL if no specific location matches
+    const location_conf_t *conf;  // location（没有匹配时为server）的运行时配置
+} route_t;
+
+route_table_t *route_table_create(const config_t *config);
+
+void route_table_free(route_table_t *rt);
+
+// 查找端口port上与host（可带":port"）匹配的server；端口上没有server时使用第一个server
+// path不为NULL时同时按nginx的优先级查找location（"?"之后的部分不参与匹配）；
+// 没有任何server时返回全NULL
+route_t route_table_lookup(const route_table_t *rt, int port, const char *host, const char *path);
+
+// 以下供启动时和后台线程遍历各server的文档根目录（见warmup.c）
+// 正则location的匹配缓存不是线程安全的：进程内只能有一个线程查找路由
+
+int route_table_server_count(const route_table_t *rt);
+
+typedef void (*route_conf_fn)(const location_conf_t *conf, void *arg);
+
+// 依次对第index个server本身和它的每个location的运行时配置调用fn
+void route_table_foreach_conf(const route_table_t *rt, int index, route_conf_fn fn, void *arg);
+
+// 在第index个server内查找path的location，规则与route_table_lookup相同
+route_t route_table_lookup_server(const route_table_t *rt, int index, const char *path);
+
+#endif // ROUTE_H
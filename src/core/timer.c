@@ -0,0 +1,190 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "timer.h"
+
+#include <limits.h>
+#include <stddef.h>
+#include <time.h>
+
+// 时间轮可表示的最大跨度（毫秒），更远的定时器被截断到该跨度
+#define TIMER_MAX_SPAN ((1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+// 已到期、等待执行回调的定时器所在的伪层级
+#define TIMER_LEVEL_EXPIRED TIMER_WHEEL_LEVELS
+
+uint64_t timer_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static inline uint64_t rotate_right(uint64_t x, unsigned int r) {
+    r &= 63;
+    return r ? (x >> r) | (x << (64 - r)) : x;
+}
+
+void timer_wheel_init(timer_wheel_t *tw, uint64_t now_ms) {
+    for (int l = 0; l < TIMER_WHEEL_LEVELS; l++) {
+        for (int s = 0; s < TIMER_WHEEL_SIZE; s++) {
+            tw->slots[l][s] = NULL;
+        }
+        tw->bitmap[l] = 0;
+    }
+    tw->expired = NULL;
+    // current表示下一个待处理的时刻
+    tw->current = now_ms + 1;
+    tw->now = now_ms;
+    tw->count = 0;
+}
+
+void timer_node_init(timer_node_t *timer, timer_handler_t handler, void *data) {
+    timer->prev = NULL;
+    timer->next = NULL;
+    timer->expires = 0;
+    timer->handler = handler;
+    timer->data = data;
+    timer->level = -1;
+    timer->slot = -1;
+}
+
+// 按距离current的远近选择层级：第L层容纳距离小于64^(L+1)毫秒的定时器
+static void timer_insert(timer_wheel_t *tw, timer_node_t *timer) {
+    uint64_t delta = timer->expires - tw->current;
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= (1ULL << ((level + 1) * TIMER_WHEEL_BITS))) {
+        level++;
+    }
+    int slot = (int)((timer->expires >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK);
+
+    timer->level = level;
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = tw->slots[level][slot];
+    if (timer->next) timer->next->prev = timer;
+    tw->slots[level][slot] = timer;
+    tw->bitmap[level] |= 1ULL << slot;
+}
+
+void timer_add(timer_wheel_t *tw, timer_node_t *timer, uint64_t timeout_ms) {
+    if (timer_is_active(timer)) {
+        timer_del(tw, timer);
+    }
+    if (timeout_ms > TIMER_MAX_SPAN) {
+        timeout_ms = TIMER_MAX_SPAN;
+    }
+    timer->expires = tw->now + timeout_ms;
+    if (timer->expires < tw->current) {
+        timer->expires = tw->current;
+    }
+    timer_insert(tw, timer);
+    tw->count++;
+}
+
+void timer_del(timer_wheel_t *tw, timer_node_t *timer) {
+    if (!timer_is_active(timer)) return;
+
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else if (timer->level == TIMER_LEVEL_EXPIRED) {
+        tw->expired = timer->next;
+    } else {
+        tw->slots[timer->level][timer->slot] = timer->next;
+        if (!timer->next) {
+            tw->bitmap[timer->level] &= ~(1ULL << timer->slot);
+        }
+    }
+    if (timer->next) timer->next->prev = timer->prev;
+
+    timer->prev = NULL;
+    timer->next = NULL;
+    timer->level = -1;
+    timer->slot = -1;
+    tw->count--;
+}
+
+// 将高层的一个槽整体下沉到低层，返回该槽下标
+static int timer_cascade(timer_wheel_t *tw, int level) {
+    int slot = (int)((tw->current >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK);
+    timer_node_t *timer = tw->slots[level][slot];
+
+    tw->slots[level][slot] = NULL;
+    tw->bitmap[level] &= ~(1ULL << slot);
+
+    while (timer) {
+        timer_node_t *next = timer->next;
+        timer_insert(tw, timer);
+        timer = next;
+    }
+    return slot;
+}
+
+int timer_wheel_next_timeout(const timer_wheel_t *tw, uint64_t now_ms) {
+    if (tw->count == 0) return -1;
+
+    uint64_t next = UINT64_MAX;
+
+    // 第0层：槽位与到期时刻一一对应
+    uint64_t bits = rotate_right(tw->bitmap[0], (unsigned int)(tw->current & TIMER_WHEEL_MASK));
+    if (bits) {
+        next = tw->current + (uint64_t)__builtin_ctzll(bits);
+    }
+
+    // 更高层：返回最近一次下沉的时刻，下沉后再精确计算
+    for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        if (!tw->bitmap[level]) continue;
+        unsigned int shift = level * TIMER_WHEEL_BITS;
+        uint64_t block = (tw->current + (1ULL << shift) - 1) >> shift;
+        bits = rotate_right(tw->bitmap[level], (unsigned int)(block & TIMER_WHEEL_MASK));
+        uint64_t at = (block + (uint64_t)__builtin_ctzll(bits)) << shift;
+        if (at < next) next = at;
+    }
+
+    if (next <= now_ms) return 0;
+    uint64_t wait = next - now_ms;
+    return wait > INT_MAX ? INT_MAX : (int)wait;
+}
+
+void timer_wheel_expire(timer_wheel_t *tw, uint64_t now_ms) {
+    timer_wheel_update_time(tw, now_ms);
+    while (tw->current <= now_ms) {
+        if (tw->count == 0) {
+            tw->current = now_ms + 1;
+            return;
+        }
+
+        int index = (int)(tw->current & TIMER_WHEEL_MASK);
+
+        // 本轮第0层剩余槽位全空时直接跳到下一个64ms边界
+        if (index != 0 && (tw->bitmap[0] >> index) == 0) {
+            uint64_t boundary = (tw->current | TIMER_WHEEL_MASK) + 1;
+            tw->current = boundary <= now_ms ? boundary : now_ms + 1;
+            continue;
+        }
+
+        if (index == 0) {
+            for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                if (timer_cascade(tw, level) != 0) break;
+            }
+        }
+
+        tw->current++;
+
+        // 先把整个槽移到到期链表再逐个执行：回调中新加入的定时器可能落回同一个槽，
+        // 而回调删除到期链表中的其他定时器也是安全的
+        tw->expired = tw->slots[0][index];
+        tw->slots[0][index] = NULL;
+        tw->bitmap[0] &= ~(1ULL << index);
+        for (timer_node_t *t = tw->expired; t; t = t->next) {
+            t->level = TIMER_LEVEL_EXPIRED;
+        }
+
+        timer_node_t *timer;
+        while ((timer = tw->expired) != NULL) {
+            timer_del(tw, timer);
+            if (timer->handler) timer->handler(timer);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+// 分层时间轮：5层，每层64个槽，精度1ms，最大跨度约12天
+// 添加/删除O(1)，到期处理只与到期（及需要下沉）的定时器数量相关
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SIZE (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SIZE - 1)
+#define TIMER_WHEEL_LEVELS 5
+
+typedef struct timer_node_s timer_node_t;
+typedef void (*timer_handler_t)(timer_node_t *timer);
+
+// 侵入式定时器节点，嵌入到需要超时的对象中
+struct timer_node_s {
+    timer_node_t *prev;
+    timer_node_t *next;
+    uint64_t expires;          // 到期时间（单调时钟，毫秒）
+    timer_handler_t handler;   // 到期回调，调用前定时器已从时间轮移除
+    void *data;                // 回调使用的上下文
+    int level;                 // 所在层级，-1表示未加入时间轮
+    int slot;
+};
+
+typedef struct {
+    timer_node_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+    uint64_t bitmap[TIMER_WHEEL_LEVELS];  // 非空槽位图，用于快速查找下一个到期时间
+    timer_node_t *expired;                // 正在执行回调的到期链表
+    uint64_t current;                     // 下一个待处理的时刻（毫秒）
+    uint64_t now;                         // 缓存的当前时间，timer_add以此为基准
+    int count;                            // 时间轮中的定时器数量
+} timer_wheel_t;
+
+// 当前单调时钟（毫秒）
+uint64_t timer_now_ms(void);
+
+void timer_wheel_init(timer_wheel_t *tw, uint64_t now_ms);
+
+// 初始化定时器节点（不加入时间轮）
+void timer_node_init(timer_node_t *timer, timer_handler_t handler, void *data);
+
+// 更新缓存的当前时间（每次epoll_wait返回后调用一次，避免频繁读取时钟）
+static inline void timer_wheel_update_time(timer_wheel_t *tw, uint64_t now_ms) {
+    if (now_ms > tw->now) tw->now = now_ms;
+}
+
+// 设置定时器在timeout_ms毫秒后到期，已在时间轮中的定时器会被重新调度
+void timer_add(timer_wheel_t *tw, timer_node_t *timer, uint64_t timeout_ms);
+
+// 从时间轮中移除定时器，未加入时为空操作
+void timer_del(timer_wheel_t *tw, timer_node_t *timer);
+
+static inline int timer_is_active(const timer_node_t *timer) {
+    return timer->level >= 0;
+}
+
+// 距离下一个定时器到期（或需要下沉）还有多少毫秒，-1表示没有定时器
+// 返回值可直接作为epoll_wait的超时参数
+int timer_wheel_next_timeout(const timer_wheel_t *tw, uint64_t now_ms);
+
+// 推进时间轮到now_ms并执行所有到期定时器的回调（同时更新缓存时间）
+void timer_wheel_expire(timer_wheel_t *tw, uint64_t now_ms);
+
+#endif  // TIMER_H
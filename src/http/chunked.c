@@ -128,6 +128,27 @@ int chunked_send_chunk(chunked_context_t *ctx, const char *data, size_t size) {
     return 0;
 }
 
+// 原地包装一个分块
+char *chunked_wrap(char *data, size_t size, bool last, size_t *len) {
+    char *start = data;
+    char *end = data;
+    if (size > 0) {
+        char chunk_header[CHUNKED_HEADER_MAX + 1];
+        int header_len = snprintf(chunk_header, sizeof(chunk_header), "%zx\r\n", size);
+        start = data - header_len;
+        memcpy(start, chunk_header, header_len);
+        end = data + size;
+        memcpy(end, "\r\n", 2);
+        end += 2;
+    }
+    if (last) {
+        memcpy(end, "0\r\n\r\n", 5);
+        end += 5;
+    }
+    *len = (size_t)(end - start);
+    return start;
+}
+
 // 发送最后的空块，结束分块传输
 int chunked_send_final_chunk(chunked_context_t *ctx, const char *trailer_headers) {
     if (!ctx || ctx->finished) {
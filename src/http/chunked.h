@@ -36,6 +36,15 @@ int chunked_send_headers(chunked_context_t *ctx, int status_code,
 // 发送一个数据块
 int chunked_send_chunk(chunked_context_t *ctx, const char *data, size_t size);
 
+// 非阻塞连接的分块编码：不直接发送，由调用者把结果放入响应链
+#define CHUNKED_HEADER_MAX 18   // 分块头"大小\r\n"的最大长度
+#define CHUNKED_TRAILER_MAX 7   // 数据后的"\r\n"加上结束块"0\r\n\r\n"
+
+// 把data处的size字节原地包装成一个分块：分块头写在data之前（调用者预留CHUNKED_HEADER_MAX字节），
+// "\r\n"写在数据之后；last为true时再追加结束块（size为0时只有结束块）
+// 返回分块的起始位置，*len为包装后的总长度
+char *chunked_wrap(char *data, size_t size, bool last, size_t *len);
+
 // 发送最后的空块，结束分块传输
 int chunked_send_final_chunk(chunked_context_t *ctx, const char *trailer_headers);
 
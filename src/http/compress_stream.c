@@ -0,0 +1,168 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "compress_stream.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "chunked.h"
+#include "log.h"
+
+typedef struct {
+    http_body_stream_t base;    // 必须是第一个成员
+    compress_context_t *ctx;    // 文件数据读入ctx->in_buffer
+    open_file_t *file;
+    off_t offset;               // 下一次读取的文件偏移
+    size_t in_pos;              // in_buffer中尚未压缩的数据
+    size_t in_len;
+    bool chunked;
+    bool eof;                   // 文件已全部读入
+    bool done;                  // 压缩结束，最后一段已装入
+    bool sent;                  // 最后一段也已发送完（压缩结束后再次调用next）
+    char *out;                  // 压缩输出，前后为分块头和分块尾预留空间
+    cache_manager_t *cache;     // 非NULL时收集压缩结果，完成后写入缓存
+    char *cache_key;
+    char *cache_type;
+    char *cache_etag;
+    cache_variant_t cache_variant;
+    time_t cache_mtime;
+    char *collected;
+    size_t collected_len;
+    size_t collected_cap;
+    size_t collect_limit;
+} compress_stream_t;
+
+static void stop_collecting(compress_stream_t *s) {
+    s->cache = NULL;
+    free(s->collected);
+    s->collected = NULL;
+}
+
+// 追加一段压缩结果；超过上限或内存不足时放弃缓存
+static void collect(compress_stream_t *s, const char *data, size_t len) {
+    if (s->collected_len + len > s->collect_limit) {
+        stop_collecting(s);
+        return;
+    }
+    if (s->collected_len + len > s->collected_cap) {
+        size_t cap = s->collected_cap ? s->collected_cap * 2 : len;
+        while (cap < s->collected_len + len) cap *= 2;
+        if (cap > s->collect_limit) cap = s->collect_limit;
+        char *p = realloc(s->collected, cap);
+        if (!p) {
+            stop_collecting(s);
+            return;
+        }
+        s->collected = p;
+        s->collected_cap = cap;
+    }
+    memcpy(s->collected + s->collected_len, data, len);
+    s->collected_len += len;
+}
+
+static void compress_stream_free(http_body_stream_t *base) {
+    compress_stream_t *s = (compress_stream_t *)base;
+    // 连接中途关闭时客户端没有收到完整响应，不写入缓存
+    if (s->cache && s->sent) {
+        cache_put(s->cache, s->cache_key, s->cache_variant, s->collected, s->collected_len,
+                  s->cache_type, s->cache_etag, s->cache_mtime, 0);
+    }
+    compress_context_release(s->ctx);
+    open_file_cache_release(s->file);
+    free(s->out);
+    free(s->collected);
+    free(s->cache_key);
+    free(s->cache_type);
+    free(s->cache_etag);
+    free(s);
+}
+
+static int compress_stream_next(http_body_stream_t *base, http_response_t *resp) {
+    compress_stream_t *s = (compress_stream_t *)base;
+    compress_context_t *ctx = s->ctx;
+    char *data = s->out + CHUNKED_HEADER_MAX;
+
+    while (!s->done) {
+        if (s->in_pos == s->in_len && !s->eof) {
+            size_t want = ctx->buffer_size;
+            if ((off_t)want > s->file->size - s->offset) want = (size_t)(s->file->size - s->offset);
+            ssize_t n = pread(s->file->fd, ctx->in_buffer, want, s->offset);
+            if (n <= 0) {
+                log_message(LOG_LEVEL_ERROR, "Failed to read file for streaming compression");
+                return -1;
+            }
+            s->offset += n;
+            s->in_pos = 0;
+            s->in_len = (size_t)n;
+            s->eof = s->offset >= s->file->size;
+        }
+
+        size_t avail = s->in_len - s->in_pos;
+        size_t out_len = ctx->buffer_size;
+        int ret = compress_data(ctx, ctx->in_buffer + s->in_pos, avail, data, &out_len,
+                                s->eof ? Z_FINISH : Z_NO_FLUSH);
+        if (ret < 0) return -1;
+        s->in_pos += avail - ctx->avail_in;
+        s->done = ret == Z_STREAM_END;
+
+        if (s->cache) collect(s, data, out_len);
+
+        // 编码器积累到足够的数据才输出，没有输出时继续读入
+        if (out_len == 0 && !(s->done && s->chunked)) continue;
+
+        if (s->chunked) {
+            resp->body = chunked_wrap(data, out_len, s->done, &resp->body_len);
+        } else {
+            resp->body = data;
+            resp->body_len = out_len;
+        }
+        resp->body_sent = 0;
+        return 1;
+    }
+    // 连接只在上一段发送完后才取下一段
+    s->sent = true;
+    return 0;
+}
+
+http_body_stream_t *compress_stream_create(compress_config_t *config, compress_encoding_t encoding,
+                                           open_file_t *of, bool chunked) {
+    compress_stream_t *s = calloc(1, sizeof(compress_stream_t));
+    if (!s) return NULL;
+    s->ctx = compress_context_acquire(config, encoding, COMPRESS_PROFILE_DYNAMIC, 0);
+    if (s->ctx) {
+        s->out = malloc(CHUNKED_HEADER_MAX + s->ctx->buffer_size + CHUNKED_TRAILER_MAX);
+    }
+    if (!s->ctx || !s->out) {
+        compress_context_release(s->ctx);
+        free(s);
+        return NULL;
+    }
+
+    s->base.next = compress_stream_next;
+    s->base.free = compress_stream_free;
+    s->file = of;
+    s->chunked = chunked;
+    return &s->base;
+}
+
+int compress_stream_cache(http_body_stream_t *stream, cache_manager_t *manager, const char *key,
+                          cache_variant_t variant, const char *content_type, const char *etag,
+                          time_t last_modified, size_t limit) {
+    compress_stream_t *s = (compress_stream_t *)stream;
+    if (!manager || !key) return -1;
+
+    s->cache_key = strdup(key);
+    s->cache_type = content_type ? strdup(content_type) : NULL;
+    s->cache_etag = etag ? strdup(etag) : NULL;
+    if (!s->cache_key || (content_type && !s->cache_type) || (etag && !s->cache_etag)) {
+        return -1;
+    }
+    s->cache = manager;
+    s->cache_variant = variant;
+    s->cache_mtime = last_modified;
+    s->collect_limit = limit;
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef COMPRESS_STREAM_H
+#define COMPRESS_STREAM_H
+
+#include <stdbool.h>
+
+#include "cache.h"
+#include "compress.h"
+#include "connection.h"
+#include "open_file_cache.h"
+
+// 流式压缩响应体（gzip、br或zstd，使用实时压缩的级别）：每次从文件读取一块（compression_buffer_size）压缩，
+// 有输出时交给连接状态机发送，发送完再压缩下一块；内存占用与文件大小无关，首字节不必等整个文件压缩完
+// 压缩后的长度事先未知：chunked为true时按分块传输编码输出，否则以关闭连接结束响应体
+
+// 创建流式压缩响应体，成功时接管of的引用（流释放时归还）；失败返回NULL，of仍由调用者持有
+http_body_stream_t *compress_stream_create(compress_config_t *config, compress_encoding_t encoding,
+                                           open_file_t *of, bool chunked);
+
+// 最后一段发送完、流释放时把完整的压缩结果作为key的variant写入响应缓存，之后的请求不必重新压缩；
+// 压缩结果超过limit或响应没有发送完（连接中途关闭）时不写入
+int compress_stream_cache(http_body_stream_t *stream, cache_manager_t *manager, const char *key,
+                          cache_variant_t variant, const char *content_type, const char *etag,
+                          time_t last_modified, size_t limit);
+
+#endif // COMPRESS_STREAM_H
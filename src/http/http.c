@@ -3,6 +3,7 @@
 #endif
 
 #include "http.h"
+#include "common.h"
 #include "config.h"
 #include "core.h"
 #include "log.h"
@@ -10,6 +11,11 @@
 #include "proxy.h"
 #include "compress.h"
 #include "health_check.h"
+#include "http_module.h"
+#include "location_conf.h"
+#include "open_file_cache.h"
+#include "range.h"
+#include "precompressed.h"
 #include "../utils/asm/asm_opt.h"
 #include "../utils/asm/asm_mempool.h"
 #include "../utils/asm/asm_integration.h"
@@ -26,9 +32,8 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 
-#define BUFFER_SIZE 8192
-#define TEMP_DEFAULT_PAGE "/test.html"
-#define TEMP_NOT_FOUND_PAGE "/404.html"
+#define TEMP_DEFAULT_PAGE "test.html"
+#define TEMP_NOT_FOUND_PAGE "404.html"
 
 // 全局内存池管理器
 static mempool_manager_t* global_mempool = NULL;
@@ -58,236 +63,190 @@ void http_module_cleanup(void) {
     log_message(LOG_LEVEL_INFO, "HTTP module cleaned up");
 }
 
-// 优化的HTTP请求解析
-static int parse_http_request_optimized(const char* buffer, size_t len, 
-                                      char** method, char** path, char** version) {
-    if (!buffer || len == 0) return -1;
-    
-    // 使用汇编优化的字符串搜索
-    const char* method_end = asm_opt_strchr(buffer, ' ');
-    if (!method_end || method_end >= buffer + len) return -1;
-    
-    const char* path_start = method_end + 1;
-    const char* path_end = asm_opt_strchr(path_start, ' ');
-    if (!path_end || path_end >= buffer + len) return -1;
-    
-    const char* version_start = path_end + 1;
-    const char* version_end = asm_opt_strstr(version_start, "\r\n");
-    if (!version_end || version_end >= buffer + len) return -1;
-    
-    // 计算长度
-    size_t method_len = method_end - buffer;
-    size_t path_len = path_end - path_start;
-    size_t version_len = version_end - version_start;
-    
-    // 使用内存池分配
-    if (global_mempool) {
-        *method = mempool_manager_alloc(global_mempool, method_len + 1);
-        *path = mempool_manager_alloc(global_mempool, path_len + 1);
-        *version = mempool_manager_alloc(global_mempool, version_len + 1);
-    } else {
-        *method = malloc(method_len + 1);
-        *path = malloc(path_len + 1);
-        *version = malloc(version_len + 1);
+// 判断响应后是否保持连接
+// HTTP/1.1默认保持，"Connection: close"关闭；HTTP/1.0需要显式"Connection: keep-alive"
+static int should_keep_alive(connection_t *conn, const core_config_t *core_conf) {
+    if (conn->request_unframed) return 0;  // 请求体未定界，无法找到下一个请求
+    if (core_conf->keepalive_timeout <= 0) return 0;
+    if (core_conf->keepalive_requests > 0 &&
+        conn->requests + 1 >= core_conf->keepalive_requests) {
+        return 0;  // 本次为该连接允许的最后一个请求
     }
-    
-    if (!*method || !*path || !*version) {
-        // 清理已分配的内存
-        if (*method) mempool_manager_free(global_mempool, *method);
-        if (*path) mempool_manager_free(global_mempool, *path);
-        if (*version) mempool_manager_free(global_mempool, *version);
+    size_t len;
+    const char *value = http_request_known(&conn->request, conn_request(conn),
+                                           HTTP_HEADER_CONNECTION, &len);
+    if (value) {
+        if (http_value_has_token(value, len, "close")) return 0;
+        if (http_value_has_token(value, len, "keep-alive")) return 1;
+    }
+    return conn->request.version_minor >= 1;
+}
+
+// 请求的字节区间：只处理GET的Range，If-Range与当前文件不一致时发送完整文件
+// 返回区间数，0表示都不可满足，-1表示发送完整文件
+static int request_ranges(connection_t *conn, const open_file_t *of, http_range_t *ranges) {
+    const char *buffer = conn_request(conn);
+    const http_request_t *req = &conn->request;
+    size_t len;
+    const char *range = http_request_known(req, buffer, HTTP_HEADER_RANGE, &len);
+    if (!range) return -1;
+    if (req->method.len != 3 || memcmp(http_slice_ptr(buffer, req->method), "GET", 3) != 0) {
         return -1;
     }
-    
-    // 使用汇编优化的内存拷贝
-    asm_opt_memcpy(*method, buffer, method_len);
-    (*method)[method_len] = '\0';
-    
-    asm_opt_memcpy(*path, path_start, path_len);
-    (*path)[path_len] = '\0';
-    
-    asm_opt_memcpy(*version, version_start, version_len);
-    (*version)[version_len] = '\0';
-    
-    return 0;
+
+    size_t if_range_len;
+    const char *if_range = http_request_known(req, buffer, HTTP_HEADER_IF_RANGE, &if_range_len);
+    if (if_range && !http_range_if_range(if_range, if_range_len, of->etag, of->last_modified)) {
+        return -1;
+    }
+    return http_range_parse(range, len, of->size, ranges, HTTP_RANGE_MAX);
 }
 
-// 优化的HTTP头部提取
-static char* extract_header_value_optimized(const char* buffer, const char* header_name) {
-    if (!buffer || !header_name) return NULL;
+// 准备零拷贝文件响应：头部写入响应缓冲区，文件由连接状态机通过sendfile发送
+// 200响应按Range改为206（单区间只发送对应的文件区间，多区间为multipart/byteranges）或416，
+// *status_code更新为实际状态码；of的引用转移给响应，失败时归还
+// 发送预压缩文件时of为预压缩文件，mime为原文件的类型，encoding为其Content-Encoding
+static int send_file_optimized(connection_t *conn, const location_conf_t *lc, open_file_t *of,
+                              const char *mime, const char *encoding,
+                              int *status_code, int keep_alive) {
+    if (!of) return -1;
     
-    size_t header_len = asm_opt_strlen(header_name);
-    const char* ptr = buffer;
+    http_response_t *resp = &conn->response;
+    http_range_t ranges[HTTP_RANGE_MAX];
+    int range_count = *status_code == 200 ? request_ranges(conn, of, ranges) : -1;
     
-    while (*ptr) {
-        // 使用汇编优化的字符串比较
-        if (asm_opt_strncmp(ptr, header_name, header_len) == 0 && ptr[header_len] == ':') {
-            ptr += header_len + 1;
-            
-            // 跳过空格
-            while (*ptr == ' ' || *ptr == '\t') ptr++;
-            
-            const char* value_start = ptr;
-            while (*ptr && *ptr != '\r' && *ptr != '\n') ptr++;
-            
-            size_t value_len = ptr - value_start;
-            if (value_len > 0) {
-                char* value = global_mempool ? 
-                    mempool_manager_alloc(global_mempool, value_len + 1) : 
-                    malloc(value_len + 1);
-                
-                if (value) {
-                    asm_opt_memcpy(value, value_start, value_len);
-                    value[value_len] = '\0';
-                    return value;
-                }
-            }
+    const char *content_type = mime;
+    char multipart_type[64];
+    long long content_length = (long long)of->size;
+    char content_range[96] = "";
+    http_response_parts_t *parts = NULL;
+    if (range_count == 0) {
+        *status_code = 416;
+        content_length = 0;
+        snprintf(content_range, sizeof(content_range), "Content-Range: bytes */%lld\r\n",
+                 (long long)of->size);
+    } else if (range_count == 1) {
+        *status_code = 206;
+        content_length = (long long)(ranges[0].end - ranges[0].start + 1);
+        snprintf(content_range, sizeof(content_range), "Content-Range: bytes %lld-%lld/%lld\r\n",
+                 (long long)ranges[0].start, (long long)ranges[0].end, (long long)of->size);
+    } else if (range_count > 1) {
+        char boundary[HTTP_RANGE_BOUNDARY_SIZE];
+        http_range_boundary(boundary, sizeof(boundary));
+        off_t body_len;
+        parts = http_range_file_parts(ranges, range_count, of->size, mime, boundary, &body_len);
+        if (!parts) {
+            open_file_cache_release(of);
+            return -1;
         }
-        
-        // 查找下一行
-        ptr = asm_opt_strstr(ptr, "\r\n");
-        if (!ptr) break;
-        ptr += 2;
+        *status_code = 206;
+        content_length = (long long)body_len;
+        snprintf(multipart_type, sizeof(multipart_type), "multipart/byteranges; boundary=%s", boundary);
+        content_type = multipart_type;
     }
     
-    return NULL;
-}
-
-// 优化的MIME类型检测
-static const char* get_mime_type_optimized(const char* path) {
-    if (!path) return "application/octet-stream";
-    
-    // 使用汇编优化的字符串搜索
-    const char* ext = asm_opt_strrchr(path, '.');
-    if (!ext) return "application/octet-stream";
+    size_t extra_len;
+    const char *extra = location_conf_headers(lc, *status_code, &extra_len);
     
-    ext++; // 跳过点号
-    
-    // 使用汇编优化的字符串比较
-    if (asm_opt_strcmp(ext, "html") == 0 || asm_opt_strcmp(ext, "htm") == 0)
-        return "text/html";
-    if (asm_opt_strcmp(ext, "css") == 0)
-        return "text/css";
-    if (asm_opt_strcmp(ext, "js") == 0)
-        return "application/javascript";
-    if (asm_opt_strcmp(ext, "json") == 0)
-        return "application/json";
-    if (asm_opt_strcmp(ext, "png") == 0)
-        return "image/png";
-    if (asm_opt_strcmp(ext, "jpg") == 0 || asm_opt_strcmp(ext, "jpeg") == 0)
-        return "image/jpeg";
-    if (asm_opt_strcmp(ext, "gif") == 0)
-        return "image/gif";
-    if (asm_opt_strcmp(ext, "ico") == 0)
-        return "image/x-icon";
-    if (asm_opt_strcmp(ext, "svg") == 0)
-        return "image/svg+xml";
-    if (asm_opt_strcmp(ext, "woff") == 0)
-        return "font/woff";
-    if (asm_opt_strcmp(ext, "woff2") == 0)
-        return "font/woff2";
-    if (asm_opt_strcmp(ext, "ttf") == 0)
-        return "font/ttf";
-    if (asm_opt_strcmp(ext, "eot") == 0)
-        return "application/vnd.ms-fontobject";
-    if (asm_opt_strcmp(ext, "otf") == 0)
-        return "font/otf";
-    if (asm_opt_strcmp(ext, "pdf") == 0)
-        return "application/pdf";
-    if (asm_opt_strcmp(ext, "zip") == 0)
-        return "application/zip";
-    if (asm_opt_strcmp(ext, "gz") == 0)
-        return "application/gzip";
-    if (asm_opt_strcmp(ext, "tar") == 0)
-        return "application/x-tar";
-    if (asm_opt_strcmp(ext, "xml") == 0)
-        return "application/xml";
-    if (asm_opt_strcmp(ext, "txt") == 0)
-        return "text/plain";
-    if (asm_opt_strcmp(ext, "md") == 0)
-        return "text/markdown";
-    if (asm_opt_strcmp(ext, "mp4") == 0)
-        return "video/mp4";
-    if (asm_opt_strcmp(ext, "webm") == 0)
-        return "video/webm";
-    if (asm_opt_strcmp(ext, "mp3") == 0)
-        return "audio/mpeg";
-    if (asm_opt_strcmp(ext, "wav") == 0)
-        return "audio/wav";
-    if (asm_opt_strcmp(ext, "ogg") == 0)
-        return "audio/ogg";
+    // 校验头在打开文件时已生成，只用于200/206响应
+    char validators[OPEN_FILE_HTTP_DATE_SIZE + OPEN_FILE_ETAG_SIZE + 32] = "";
+    if (*status_code == 200 || *status_code == 206) {
+        snprintf(validators, sizeof(validators), "Last-Modified: %s\r\nETag: %s\r\n",
+                 of->last_modified, of->etag);
+    }
     
-    return "application/octet-stream";
-}
-
-// 优化的零拷贝文件发送
-static int send_file_optimized(int client_socket, const char* file_path, 
-                              const char* mime_type, size_t file_size) {
-    int file_fd = open(file_path, O_RDONLY);
-    if (file_fd < 0) return -1;
+    // 开启预压缩文件时同一URI的响应随Accept-Encoding变化
+    char encoding_lines[64] = "";
+    if (*status_code == 200 || *status_code == 206) {
+        snprintf(encoding_lines, sizeof(encoding_lines), "%s%s%s%s",
+                 encoding ? "Content-Encoding: " : "", encoding ? encoding : "",
+                 encoding ? "\r\n" : "",
+                 precompressed_enabled(lc) ? "Vary: Accept-Encoding\r\n" : "");
+    }
     
-    // 构建HTTP响应头
-    char header[BUFFER_SIZE];
-    int header_len = snprintf(header, sizeof(header),
-        "HTTP/1.1 200 OK\r\n"
+    // 构建HTTP响应头，location的add_header已预先渲染
+    int header_len = snprintf(resp->header, sizeof(resp->header),
+        "HTTP/1.1 %d %s\r\n"
         "Content-Type: %s\r\n"
-        "Content-Length: %zu\r\n"
+        "Content-Length: %lld\r\n"
+        "%s"
         "Server: ANX HTTP Server/1.1.0+\r\n"
+        "%s"
+        "%s"
         "Accept-Ranges: bytes\r\n"
-        "Connection: close\r\n\r\n",
-        mime_type, file_size);
-    
-    // 发送头部
-    if (write(client_socket, header, header_len) < 0) {
-        close(file_fd);
+        "%.*s"
+        "Connection: %s\r\n\r\n",
+        *status_code, status_reason(*status_code),
+        content_type, content_length, content_range, validators, encoding_lines,
+        (int)extra_len, extra, keep_alive ? "keep-alive" : "close");
+    if (header_len < 0 || (size_t)header_len >= sizeof(resp->header)) {
+        free(parts);
+        open_file_cache_release(of);
         return -1;
     }
     
-    // 使用sendfile进行零拷贝传输
-    off_t offset = 0;
-    ssize_t sent = sendfile(client_socket, file_fd, &offset, file_size);
+    resp->header_len = header_len;
+    resp->keep_alive = keep_alive;
+    if (*status_code == 416) {
+        open_file_cache_release(of);
+        return 0;
+    }
     
-    close(file_fd);
-    return (sent == (ssize_t)file_size) ? 0 : -1;
+    resp->file_fd = of->fd;
+    resp->file = of;
+    if (parts) {
+        // 各部分的分隔行作为内存响应体，区间数据仍按文件偏移发送
+        resp->parts = parts;
+        http_response_next_part(resp);
+    } else if (range_count == 1) {
+        resp->file_offset = ranges[0].start;
+        resp->file_remaining = (size_t)content_length;
+    } else {
+        resp->file_offset = 0;
+        resp->file_remaining = (size_t)of->size;
+    }
+    return 0;
 }
 
 // 优化的HTTP请求处理主函数
-void handle_http_request(int client_socket, const char* client_ip, core_config_t *core_conf) {
+int handle_http_request(connection_t *conn, core_config_t *core_conf) {
     struct timeval start_time;
     gettimeofday(&start_time, NULL);
 
-    // 使用汇编优化的缓冲区
-    char buffer[BUFFER_SIZE];
-    ssize_t bytes_read = asm_opt_socket_recv(client_socket, buffer, sizeof(buffer) - 1, 0);
+    // 当前请求已由连接状态机定界并解析，字段均为指向缓冲区的切片
+    const char *buffer = conn_request(conn);
+    const http_request_t *req = &conn->request;
+    const char *client_ip = conn->client_ip;
+    int result = 0;
 
-    if (bytes_read <= 0) {
-        close(client_socket);
-        return;
+    // 路由和文件查找需要以'\0'结尾的路径和Host，复制到栈上
+    char req_path[ANX_MAX_URI_LENGTH];
+    char host_buf[ANX_MAX_HOST_LENGTH];
+    if (req->path.len >= sizeof(req_path)) {
+        return http_response_set_error(&conn->response, 414);
     }
-    buffer[bytes_read] = '\0';
+    http_slice_copy(req_path, sizeof(req_path), buffer, req->path);
 
-    // 使用优化的HTTP请求解析
-    char *method = NULL, *req_path = NULL, *http_version = NULL;
-    if (parse_http_request_optimized(buffer, bytes_read, &method, &req_path, &http_version) < 0) {
-        close(client_socket);
-        return;
+    const char *host = NULL;
+    if (req->known[HTTP_HEADER_HOST] >= 0) {
+        http_slice_copy(host_buf, sizeof(host_buf), buffer,
+                        req->headers[req->known[HTTP_HEADER_HOST]].value);
+        host = host_buf;
     }
+    int keep_alive = should_keep_alive(conn, core_conf);
 
-    // 使用优化的头部提取
-    char *host = extract_header_value_optimized(buffer, "Host");
-    char *user_agent = extract_header_value_optimized(buffer, "User-Agent");
-    char *referer = extract_header_value_optimized(buffer, "Referer");
-    char *if_none_match = extract_header_value_optimized(buffer, "If-None-Match");
-    char *if_modified_since_str = extract_header_value_optimized(buffer, "If-Modified-Since");
-
-    // 创建访问日志条目
+    // 创建访问日志条目，只有记录日志时才复制字段
     access_log_entry_t *access_entry = create_access_log_entry();
     if (access_entry) {
+        size_t len;
+        const char *value;
         access_entry->client_ip = strdup(client_ip);
-        access_entry->method = strdup(method);
+        access_entry->method = strndup(http_slice_ptr(buffer, req->method), req->method.len);
         access_entry->request_uri = strdup(req_path);
-        access_entry->user_agent = user_agent ? strdup(user_agent) : NULL;
-        access_entry->referer = referer ? strdup(referer) : NULL;
+        value = http_request_known(req, buffer, HTTP_HEADER_USER_AGENT, &len);
+        access_entry->user_agent = value ? strndup(value, len) : NULL;
+        value = http_request_known(req, buffer, HTTP_HEADER_REFERER, &len);
+        access_entry->referer = value ? strndup(value, len) : NULL;
         access_entry->timestamp = time(NULL);
     }
 
@@ -300,7 +259,7 @@ void handle_http_request(int client_socket, const char* client_ip, core_config_t
                               "Content-Length: 13\r\n"
                               "Connection: close\r\n\r\n"
                               "Access Denied";
-        write(client_socket, response, strlen(response));
+        http_response_set_raw(&conn->response, response, strlen(response));
         
         if (access_entry) {
             access_entry->status_code = 403;
@@ -314,24 +273,39 @@ void handle_http_request(int client_socket, const char* client_ip, core_config_t
             free_access_log_entry(access_entry);
         }
         
-        close(client_socket);
         goto cleanup;
     }
 
     // 路由查找
-    route_t route = find_route(core_conf, host, req_path, 80);
+    route_t route = find_route(core_conf, host, req_path, conn->local_port);
     
+    const location_conf_t *lc = route.conf;
+    if (!lc) {
+        http_response_set_error(&conn->response, 500);
+        if (access_entry) {
+            access_entry->status_code = 500;
+            access_entry->response_size = conn->response.header_len;
+            struct timeval end_time;
+            gettimeofday(&end_time, NULL);
+            access_entry->request_duration_ms = 
+                (end_time.tv_sec - start_time.tv_sec) * 1000.0 +
+                (end_time.tv_usec - start_time.tv_usec) / 1000.0;
+            log_access_entry(access_entry);
+            free_access_log_entry(access_entry);
+        }
+        goto cleanup;
+    }
+
     // 检查是否是代理请求
-    if (route.location && route.location->proxy_pass) {
-        // 处理代理请求（保持原有逻辑）
-        char *headers = NULL;
-        int result = proxy_request(client_socket, req_path, route.location->proxy_pass, 
-                                 buffer, bytes_read, &headers);
+    if (lc->proxy_pass) {
+        // 代理请求仍同步转发，响应由代理模块直接写回客户端，完成后关闭连接
+        int proxied = proxy_request(conn->fd, req_path, lc->proxy_pass,
+                                    client_ip, core_conf);
         
-        if (result >= 0) {
+        if (proxied >= 0) {
             if (access_entry) {
                 access_entry->status_code = 200;
-                access_entry->response_size = result;
+                access_entry->response_size = proxied;
                 struct timeval end_time;
                 gettimeofday(&end_time, NULL);
                 access_entry->request_duration_ms = 
@@ -342,74 +316,53 @@ void handle_http_request(int client_socket, const char* client_ip, core_config_t
             }
         }
         
-        if (headers) free(headers);
-        close(client_socket);
         goto cleanup;
     }
 
-    // 静态文件服务优化
-    const char *root = get_directive_value("root", route.server->directives, route.server->directive_count);
-    if (route.location) {
-        const char* loc_root = get_directive_value("root", route.location->directives, route.location->directive_count);
-        if (loc_root) root = loc_root;
-    }
-    if (!root) root = "./www";
-
-    char file_path[BUFFER_SIZE];
+    // 静态文件：相对于location的root打开，root和index在加载配置时已解析
+    // 经过打开文件缓存，命中时不访问文件系统
+    int status_code = 200;
+    open_file_t *of = NULL;
+    const char *rel = req_path;
     if (strcmp(req_path, "/") == 0) {
-        // 处理根目录请求
-        const char *index_directive = NULL;
-        if (route.location) {
-            index_directive = get_directive_value("index", route.location->directives, route.location->directive_count);
+        for (int i = 0; i < lc->index_count && !of; i++) {
+            rel = lc->index[i];
+            of = open_file_cache_open(lc, rel);
         }
-        if (!index_directive && route.server) {
-            index_directive = get_directive_value("index", route.server->directives, route.server->directive_count);
-        }
-        
-        bool index_found = false;
-        if (index_directive) {
-            char *index_copy = strdup(index_directive);
-            char *index_file = strtok(index_copy, " \t");
-            
-            while (index_file && !index_found) {
-                snprintf(file_path, sizeof(file_path), "%s/%s", root, index_file);
-                struct stat temp_stat;
-                if (stat(file_path, &temp_stat) == 0 && S_ISREG(temp_stat.st_mode)) {
-                    index_found = true;
-                }
-                if (!index_found) {
-                    index_file = strtok(NULL, " \t");
-                }
-            }
-            free(index_copy);
-        }
-        
-        if (!index_found) {
-            snprintf(file_path, sizeof(file_path), "%s%s", root, TEMP_DEFAULT_PAGE);
+        if (!of) {
+            rel = TEMP_DEFAULT_PAGE;
+            of = open_file_cache_open(lc, rel);
         }
     } else {
-        snprintf(file_path, sizeof(file_path), "%s%s", root, req_path);
+        of = open_file_cache_open(lc, req_path);
     }
 
-    struct stat file_stat;
-    if (stat(file_path, &file_stat) < 0 || !S_ISREG(file_stat.st_mode)) {
+    if (!of) {
         // 文件不存在，返回404
-        snprintf(file_path, sizeof(file_path), "%s%s", root, TEMP_NOT_FOUND_PAGE);
-        stat(file_path, &file_stat);
-        
-        if (access_entry) {
-            access_entry->status_code = 404;
+        status_code = 404;
+        of = open_file_cache_open(lc, TEMP_NOT_FOUND_PAGE);
+    }
+
+    // 原文件存在时优先发送客户端接受的预压缩文件，Content-Type仍取原文件的
+    const char *mime = of ? of->mime : NULL;
+    const char *encoding = NULL;
+    if (of && status_code == 200 && precompressed_enabled(lc)) {
+        size_t len;
+        const char *accept = http_request_known(req, buffer, HTTP_HEADER_ACCEPT_ENCODING, &len);
+        open_file_t *sidecar = precompressed_open(lc, rel, mime, accept, accept ? len : 0,
+                                                  &encoding);
+        if (sidecar) {
+            open_file_cache_release(of);
+            of = sidecar;
         }
     }
 
-    // 使用优化的MIME类型检测
-    const char *mime_type = get_mime_type_optimized(file_path);
-    
     // 使用零拷贝文件发送
-    if (send_file_optimized(client_socket, file_path, mime_type, file_stat.st_size) == 0) {
+    if (send_file_optimized(conn, lc, of, mime, encoding, &status_code, keep_alive) == 0) {
         if (access_entry) {
-            access_entry->status_code = 200;
-            access_entry->response_size = file_stat.st_size;
+            const http_response_t *resp = &conn->response;
+            access_entry->status_code = status_code;
+            access_entry->response_size = resp->body_len + resp->file_remaining;
             struct timeval end_time;
             gettimeofday(&end_time, NULL);
             access_entry->request_duration_ms = 
@@ -425,7 +378,7 @@ void handle_http_request(int client_socket, const char* client_ip, core_config_t
                               "Content-Length: 21\r\n"
                               "Connection: close\r\n\r\n"
                               "Internal Server Error";
-        write(client_socket, response, strlen(response));
+        http_response_set_raw(&conn->response, response, strlen(response));
         
         if (access_entry) {
             access_entry->status_code = 500;
@@ -441,15 +394,5 @@ void handle_http_request(int client_socket, const char* client_ip, core_config_t
     }
 
 cleanup:
-    // 使用内存池释放内存
-    if (method) mempool_manager_free(global_mempool, method);
-    if (req_path) mempool_manager_free(global_mempool, req_path);
-    if (http_version) mempool_manager_free(global_mempool, http_version);
-    if (host) mempool_manager_free(global_mempool, host);
-    if (user_agent) mempool_manager_free(global_mempool, user_agent);
-    if (referer) mempool_manager_free(global_mempool, referer);
-    if (if_none_match) mempool_manager_free(global_mempool, if_none_match);
-    if (if_modified_since_str) mempool_manager_free(global_mempool, if_modified_since_str);
-    
-    close(client_socket);
+    return result;
 } 
\ No newline at end of file
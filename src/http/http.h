@@ -2,7 +2,10 @@
 #define HTTP_H
 
 #include "core.h"
+#include "connection.h"
 
-void handle_http_request(int client_socket, const char *client_ip, core_config_t *core_conf);
+// 解析conn->buffer中的请求并在conn->response中准备响应，不直接读写socket
+// 返回0表示响应已就绪，-1表示应关闭连接
+int handle_http_request(connection_t *conn, core_config_t *core_conf);
 
-#endif  // HTTP_H 
\ No newline at end of file
+#endif  // HTTP_H
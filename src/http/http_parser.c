@@ -0,0 +1,242 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "http_parser.h"
+
+#include <string.h>
+#include <strings.h>
+
+#include "common.h"
+
+// RFC 7230 token字符表：头部名称和方法只能由这些字符组成
+static const uint8_t token_chars[256] = {
+    ['!'] = 1, ['#'] = 1, ['$'] = 1, ['%'] = 1, ['&'] = 1, ['\''] = 1, ['*'] = 1,
+    ['+'] = 1, ['-'] = 1, ['.'] = 1, ['^'] = 1, ['_'] = 1, ['`'] = 1, ['|'] = 1, ['~'] = 1,
+    ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1, ['5'] = 1, ['6'] = 1, ['7'] = 1,
+    ['8'] = 1, ['9'] = 1,
+    ['A'] = 1, ['B'] = 1, ['C'] = 1, ['D'] = 1, ['E'] = 1, ['F'] = 1, ['G'] = 1, ['H'] = 1,
+    ['I'] = 1, ['J'] = 1, ['K'] = 1, ['L'] = 1, ['M'] = 1, ['N'] = 1, ['O'] = 1, ['P'] = 1,
+    ['Q'] = 1, ['R'] = 1, ['S'] = 1, ['T'] = 1, ['U'] = 1, ['V'] = 1, ['W'] = 1, ['X'] = 1,
+    ['Y'] = 1, ['Z'] = 1,
+    ['a'] = 1, ['b'] = 1, ['c'] = 1, ['d'] = 1, ['e'] = 1, ['f'] = 1, ['g'] = 1, ['h'] = 1,
+    ['i'] = 1, ['j'] = 1, ['k'] = 1, ['l'] = 1, ['m'] = 1, ['n'] = 1, ['o'] = 1, ['p'] = 1,
+    ['q'] = 1, ['r'] = 1, ['s'] = 1, ['t'] = 1, ['u'] = 1, ['v'] = 1, ['w'] = 1, ['x'] = 1,
+    ['y'] = 1, ['z'] = 1,
+};
+
+typedef struct {
+    const char *name;
+    size_t len;
+    http_header_id_t id;
+} known_header_t;
+
+#define KNOWN(name, id) { name, sizeof(name) - 1, id }
+
+static const known_header_t known_headers[] = {
+    KNOWN("host", HTTP_HEADER_HOST),
+    KNOWN("user-agent", HTTP_HEADER_USER_AGENT),
+    KNOWN("referer", HTTP_HEADER_REFERER),
+    KNOWN("connection", HTTP_HEADER_CONNECTION),
+    KNOWN("content-length", HTTP_HEADER_CONTENT_LENGTH),
+    KNOWN("transfer-encoding", HTTP_HEADER_TRANSFER_ENCODING),
+    KNOWN("accept-encoding", HTTP_HEADER_ACCEPT_ENCODING),
+    KNOWN("if-none-match", HTTP_HEADER_IF_NONE_MATCH),
+    KNOWN("if-modified-since", HTTP_HEADER_IF_MODIFIED_SINCE),
+    KNOWN("range", HTTP_HEADER_RANGE),
+    KNOWN("if-range", HTTP_HEADER_IF_RANGE),
+};
+
+// 名称已通过token校验，字母和'-'与0x20按位或即可忽略大小写
+static inline int name_equals_lower(const char *name, const char *lower, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if ((name[i] | 0x20) != lower[i]) return 0;
+    }
+    return 1;
+}
+
+// 名称长度不同的头部无需比较，先按长度过滤
+static int classify_header(const char *name, size_t len) {
+    for (size_t i = 0; i < ANX_ARRAY_SIZE(known_headers); i++) {
+        if (known_headers[i].len == len && name_equals_lower(name, known_headers[i].name, len)) {
+            return known_headers[i].id;
+        }
+    }
+    return -1;
+}
+
+static inline http_slice_t make_slice(const char *base, const char *start, const char *end) {
+    http_slice_t s = { (uint32_t)(start - base), (uint32_t)(end - start) };
+    return s;
+}
+
+static int parse_request_line(http_request_t *req, const char *base,
+                              const char *p, const char *eol) {
+    const char *start = p;
+    while (p < eol && token_chars[(uint8_t)*p]) p++;
+    if (p == start || p >= eol || *p != ' ') return ANX_ERROR;
+    req->method = make_slice(base, start, p);
+
+    start = ++p;
+    const char *query = NULL;
+    while (p < eol && *p != ' ') {
+        if ((uint8_t)*p < 0x21 || *p == 0x7f) return ANX_ERROR;
+        if (*p == '?' && !query) query = p;
+        p++;
+    }
+    if (p == start || p >= eol) return ANX_ERROR;
+    req->uri = make_slice(base, start, p);
+    req->path = make_slice(base, start, query ? query : p);
+    req->query = query ? make_slice(base, query + 1, p) : make_slice(base, p, p);
+
+    start = ++p;
+    if (eol - start != 8 || memcmp(start, "HTTP/1.", 7) != 0 ||
+        start[7] < '0' || start[7] > '9') {
+        return ANX_ERROR;
+    }
+    req->version = make_slice(base, start, eol);
+    req->version_minor = start[7] - '0';
+    return ANX_OK;
+}
+
+// 分词器已给出行边界和第一个':'的位置，这里只校验名称并去掉值两端的空白
+static int parse_header_line(http_request_t *req, const char *base, const asm_http_line_t *line) {
+    if (line->colon == ASM_HTTP_NO_COLON || line->colon == line->start) return ANX_ERROR;
+
+    const char *name = base + line->start;
+    const char *name_end = base + line->colon;
+    for (const char *p = name; p < name_end; p++) {
+        if (!token_chars[(uint8_t)*p]) return ANX_ERROR;
+    }
+
+    const char *value = name_end + 1;
+    const char *value_end = base + line->end;
+    while (value < value_end && (*value == ' ' || *value == '\t')) value++;
+    while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) value_end--;
+
+    if (req->header_count == HTTP_MAX_HEADERS) return ANX_ERROR;
+    http_header_t *h = &req->headers[req->header_count];
+    h->name = make_slice(base, name, name_end);
+    h->value = make_slice(base, value, value_end);
+
+    int id = classify_header(name, (size_t)(name_end - name));
+    if (id >= 0) {
+        int seen = req->known[id] >= 0;
+        req->known[id] = (int8_t)req->header_count;
+        if (id == HTTP_HEADER_CONTENT_LENGTH) {
+            // 空值、溢出和前后不一致的Content-Length都会让请求边界有歧义（请求走私），一律拒绝
+            if (value == value_end) return ANX_ERROR;
+            size_t n = 0;
+            for (const char *d = value; d < value_end; d++) {
+                if (*d < '0' || *d > '9') return ANX_ERROR;
+                size_t digit = (size_t)(*d - '0');
+                if (n > (SIZE_MAX - digit) / 10) return ANX_ERROR;
+                n = n * 10 + digit;
+            }
+            if (seen && n != req->content_length) return ANX_ERROR;
+            req->content_length = n;
+        } else if (id == HTTP_HEADER_TRANSFER_ENCODING) {
+            req->chunked = value_end > value;
+        }
+    }
+    req->header_count++;
+    return ANX_OK;
+}
+
+void http_request_reset(http_request_t *req) {
+    req->header_count = 0;
+    req->header_len = 0;
+    req->content_length = 0;
+    req->chunked = 0;
+    req->stage = 0;
+    asm_http_scan_reset(&req->scan);
+    memset(req->known, -1, sizeof(req->known));
+}
+
+#define PARSE_LINE_BATCH 16
+
+int http_parse_request(http_request_t *req, const char *buf, size_t len) {
+    asm_http_line_t lines[PARSE_LINE_BATCH];
+
+    while (req->stage != 2) {
+        int n = asm_http_scan_lines(&req->scan, buf, len, lines, PARSE_LINE_BATCH);
+        if (n < 0) return ANX_ERROR;
+        if (n == 0) return ANX_AGAIN;
+
+        for (int i = 0; i < n; i++) {
+            const asm_http_line_t *line = &lines[i];
+            if (req->stage == 0) {
+                // 容忍请求之前多余的空行（RFC 7230 3.5）
+                if (line->end == line->start) continue;
+                if (parse_request_line(req, buf, buf + line->start, buf + line->end) != ANX_OK) {
+                    return ANX_ERROR;
+                }
+                req->stage = 1;
+            } else if (line->end == line->start) {
+                // 空行：请求头结束
+                req->stage = 2;
+                req->header_len = line->next;
+            } else if (parse_header_line(req, buf, line) != ANX_OK) {
+                return ANX_ERROR;
+            }
+        }
+    }
+    return ANX_OK;
+}
+
+const char *http_request_known(const http_request_t *req, const char *base,
+                               http_header_id_t id, size_t *len) {
+    int index = req->known[id];
+    if (index < 0) {
+        *len = 0;
+        return NULL;
+    }
+    *len = req->headers[index].value.len;
+    return http_slice_ptr(base, req->headers[index].value);
+}
+
+const http_header_t *http_request_find(const http_request_t *req, const char *base,
+                                       const char *name) {
+    size_t len = strlen(name);
+    for (int i = 0; i < req->header_count; i++) {
+        const http_header_t *h = &req->headers[i];
+        if (h->name.len == len && strncasecmp(http_slice_ptr(base, h->name), name, len) == 0) {
+            return h;
+        }
+    }
+    return NULL;
+}
+
+int http_slice_equals(const char *base, http_slice_t s, const char *str) {
+    return strlen(str) == s.len && memcmp(base + s.off, str, s.len) == 0;
+}
+
+int http_slice_iequals(const char *base, http_slice_t s, const char *str) {
+    return strlen(str) == s.len && strncasecmp(base + s.off, str, s.len) == 0;
+}
+
+int http_value_has_token(const char *value, size_t len, const char *token) {
+    size_t token_len = strlen(token);
+    const char *p = value;
+    const char *end = value + len;
+
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) p++;
+        const char *start = p;
+        while (p < end && *p != ',') p++;
+        const char *stop = p;
+        while (stop > start && (stop[-1] == ' ' || stop[-1] == '\t')) stop--;
+        if ((size_t)(stop - start) == token_len && strncasecmp(start, token, token_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+size_t http_slice_copy(char *dst, size_t cap, const char *base, http_slice_t s) {
+    if (cap == 0) return 0;
+    size_t n = ANX_MIN((size_t)s.len, cap - 1);
+    memcpy(dst, base + s.off, n);
+    dst[n] = '\0';
+    return n;
+}
@@ -0,0 +1,92 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "asm_http_scan.h"
+
+// 零拷贝请求解析：一次线性扫描请求头，结果全部是指向请求缓冲区的(偏移,长度)切片，
+// 解析过程不分配内存、不修改缓冲区。偏移相对于请求起始位置，缓冲区整理或扩容后仍然有效
+// 解析可以跨多次读取增量进行：已解析的行和已扫描过的字节不会再次检查
+// 行边界和':'的定位由向量化分词器asm_http_scan完成
+
+#define HTTP_MAX_HEADERS 64  // 单个请求最多的头部行数，超出视为非法请求
+
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+} http_slice_t;
+
+// 处理请求时需要的常用头部，解析时直接建立索引，无需再次查找
+typedef enum {
+    HTTP_HEADER_HOST = 0,
+    HTTP_HEADER_USER_AGENT,
+    HTTP_HEADER_REFERER,
+    HTTP_HEADER_CONNECTION,
+    HTTP_HEADER_CONTENT_LENGTH,
+    HTTP_HEADER_TRANSFER_ENCODING,
+    HTTP_HEADER_ACCEPT_ENCODING,
+    HTTP_HEADER_IF_NONE_MATCH,
+    HTTP_HEADER_IF_MODIFIED_SINCE,
+    HTTP_HEADER_RANGE,
+    HTTP_HEADER_IF_RANGE,
+    HTTP_HEADER_KNOWN_COUNT
+} http_header_id_t;
+
+typedef struct {
+    http_slice_t name;
+    http_slice_t value;
+} http_header_t;
+
+typedef struct {
+    http_slice_t method;
+    http_slice_t uri;        // 完整请求目标（含查询串）
+    http_slice_t path;       // uri中'?'之前的部分
+    http_slice_t query;      // '?'之后的部分，没有查询串时长度为0
+    http_slice_t version;    // 如"HTTP/1.1"
+    int version_minor;       // HTTP/1.x中的x
+
+    http_header_t headers[HTTP_MAX_HEADERS];
+    int header_count;
+    int8_t known[HTTP_HEADER_KNOWN_COUNT];  // 常用头部在headers中的下标，-1表示不存在
+
+    size_t header_len;       // 请求行+请求头的总长度（含结尾的空行）
+    size_t content_length;   // Content-Length，没有时为0
+    int chunked;             // Transfer-Encoding不为空（请求体无法按长度定界）
+
+    // 增量解析进度
+    int stage;               // 0:请求行 1:请求头 2:完成
+    asm_http_scan_state_t scan;
+} http_request_t;
+
+// 开始解析一个新请求前调用
+void http_request_reset(http_request_t *req);
+
+// 解析buf中的请求行和请求头，从上次返回ANX_AGAIN的位置继续
+// 返回ANX_OK表示请求头完整，ANX_AGAIN表示需要更多数据，ANX_ERROR表示请求非法
+int http_parse_request(http_request_t *req, const char *buf, size_t len);
+
+static inline const char *http_slice_ptr(const char *base, http_slice_t s) {
+    return base + s.off;
+}
+
+// 常用头部的值；不存在时返回NULL，*len置0
+const char *http_request_known(const http_request_t *req, const char *base,
+                               http_header_id_t id, size_t *len);
+
+// 按名称查找任意头部（大小写不敏感），返回值切片，不存在返回NULL
+const http_header_t *http_request_find(const http_request_t *req, const char *base,
+                                       const char *name);
+
+// 切片与字符串比较
+int http_slice_equals(const char *base, http_slice_t s, const char *str);
+int http_slice_iequals(const char *base, http_slice_t s, const char *str);
+
+// 逗号分隔的头部值中是否包含指定token（大小写不敏感），如Connection: keep-alive, Upgrade
+int http_value_has_token(const char *value, size_t len, const char *token);
+
+// 把切片复制到调用者提供的缓冲区并以'\0'结尾，超长时截断；返回复制的长度
+size_t http_slice_copy(char *dst, size_t cap, const char *base, http_slice_t s);
+
+#endif  // HTTP_PARSER_H
@@ -18,192 +18,172 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
+#include "common.h"
 #include "config.h"
 #include "core.h"
 #include "log.h"
 #include "util.h"
 #include "proxy.h"
 #include "lb_proxy.h"
-#include "headers.h"
+#include "location_conf.h"
+#include "open_file_cache.h"
+#include "range.h"
+#include "precompressed.h"
+#include "compress_stream.h"
 #include "compress.h"
 #include "cache.h"
 
 #define BUFFER_SIZE 4096
-#define TEMP_DEFAULT_PAGE "/index.html"
-#define TEMP_NOT_FOUND_PAGE "/404.html"
-
-// Helper to parse Host header from request
-static char *get_host(const char *buffer) {
-    const char *host_hdr = "Host: ";
-    char *host_start = strcasestr(buffer, host_hdr);
-    if (!host_start) return NULL;
-
-    host_start += strlen(host_hdr);
-    char *host_end = strstr(host_start, "\r\n");
-    if (!host_end) return NULL;
-
-    return strndup(host_start, host_end - host_start);
+#define TEMP_DEFAULT_PAGE "index.html"
+#define TEMP_NOT_FOUND_PAGE "404.html"
+
+// 转发给上游的请求头：请求行之后到最后一个头部行，没有头部时为NULL
+static char *request_headers(const http_request_t *req, const char *buffer) {
+    if (req->header_count == 0) return NULL;
+    const http_header_t *first = &req->headers[0];
+    const http_header_t *last = &req->headers[req->header_count - 1];
+    return strndup(buffer + first->name.off, last->value.off + last->value.len - first->name.off);
 }
 
-// Helper to extract User-Agent header from request
-static char *get_user_agent(const char *buffer) {
-    const char *ua_hdr = "User-Agent: ";
-    char *ua_start = strcasestr(buffer, ua_hdr);
-    if (!ua_start) return strdup("-");
-
-    ua_start += strlen(ua_hdr);
-    char *ua_end = strstr(ua_start, "\r\n");
-    if (!ua_end) return strdup("-");
-
-    return strndup(ua_start, ua_end - ua_start);
+// 编码对应的缓存表示形式
+static cache_variant_t cache_variant(compress_encoding_t encoding) {
+    return (cache_variant_t)(encoding + 1);
 }
 
-// Helper to extract Referer header from request
-static char *get_referer(const char *buffer) {
-    const char *ref_hdr = "Referer: ";
-    char *ref_start = strcasestr(buffer, ref_hdr);
-    if (!ref_start) return strdup("-");
-
-    ref_start += strlen(ref_hdr);
-    char *ref_end = strstr(ref_start, "\r\n");
-    if (!ref_end) return strdup("-");
-
-    return strndup(ref_start, ref_end - ref_start);
+// 请求的字节区间，If-Range与当前内容不一致时发送完整内容
+// 返回区间数，0表示都不可满足，-1表示发送完整内容
+static int request_ranges(const char *range, size_t range_len, const char *if_range,
+                          size_t if_range_len, const char *etag, const char *last_modified,
+                          off_t size, http_range_t *ranges) {
+    if (!range) return -1;
+    if (if_range && !http_range_if_range(if_range, if_range_len, etag, last_modified)) {
+        return -1;
+    }
+    return http_range_parse(range, range_len, size, ranges, HTTP_RANGE_MAX);
 }
 
-// 从SSL缓冲区提取HTTP头部信息
-static char *extract_ssl_headers(const char *buffer) {
-    const char *headers_start = strchr(buffer, '\n');
-    if (!headers_start) return NULL;
-    
-    headers_start++; // 跳过第一行
-    const char *headers_end = strstr(headers_start, "\r\n\r\n");
-    if (!headers_end) return NULL;
-    
-    return strndup(headers_start, headers_end - headers_start);
-}
+// 按区间生成Content-Range或multipart的Content-Type头，返回响应体长度
+// 多区间时*multipart为组装好的响应体（内存内容）或*parts为文件各部分，二者由调用者传入其一
+static long range_headers(char *buf, size_t size, const http_range_t *ranges, int count,
+                          off_t total, const char *mime, const char *content,
+                          char **multipart, http_response_parts_t **parts) {
+    if (count == 0) {
+        snprintf(buf, size, "Content-Range: bytes */%lld\r\n", (long long)total);
+        return 0;
+    }
+    if (count == 1) {
+        snprintf(buf, size, "Content-Range: bytes %lld-%lld/%lld\r\n",
+                 (long long)ranges[0].start, (long long)ranges[0].end, (long long)total);
+        return (long)(ranges[0].end - ranges[0].start + 1);
+    }
 
-// 提取特定头部的值
-static char *extract_header_value(const char *buffer, const char *header_name) {
-    if (!buffer || !header_name) return NULL;
-    
-    char search_header[64];
-    snprintf(search_header, sizeof(search_header), "%s: ", header_name);
-    
-    char *header_start = strcasestr(buffer, search_header);
-    if (!header_start) return NULL;
-    
-    header_start += strlen(search_header);
-    char *header_end = strstr(header_start, "\r\n");
-    if (!header_end) return NULL;
-    
-    return strndup(header_start, header_end - header_start);
+    char boundary[HTTP_RANGE_BOUNDARY_SIZE];
+    http_range_boundary(boundary, sizeof(boundary));
+    long body_len;
+    if (content) {
+        size_t len;
+        *multipart = http_range_multipart_body(content, ranges, count, total, mime, boundary, &len);
+        if (!*multipart) return -1;
+        body_len = (long)len;
+    } else {
+        off_t len;
+        *parts = http_range_file_parts(ranges, count, total, mime, boundary, &len);
+        if (!*parts) return -1;
+        body_len = (long)len;
+    }
+    snprintf(buf, size, "Content-Type: multipart/byteranges; boundary=%s\r\n", boundary);
+    return body_len;
 }
 
-void handle_https_request(SSL *ssl, const char *client_ip, core_config_t *core_conf) {
+int handle_https_request(connection_t *conn, core_config_t *core_conf) {
     struct timeval start_time;
     gettimeofday(&start_time, NULL);
 
-    char buffer[BUFFER_SIZE];
-    int bytes_read = SSL_read(ssl, buffer, sizeof(buffer) - 1);
-
-    if (bytes_read <= 0) {
-        SSL_shutdown(ssl);
-        SSL_free(ssl);
-        return;
+    // 请求已由连接状态机解密读入conn->buffer并定界，SSL会话由连接持有
+    SSL *ssl = conn->ssl;
+    const char *client_ip = conn->client_ip;
+    const char *buffer = conn_request(conn);
+    http_response_t *resp = &conn->response;
+
+    // 请求已由连接状态机解析，字段均为指向缓冲区的切片；
+    // 路由、文件查找和缓存需要以'\0'结尾的方法、路径和Host，复制到栈上
+    const http_request_t *req = &conn->request;
+    char method[16];
+    char req_path[ANX_MAX_URI_LENGTH];
+    char host_buf[ANX_MAX_HOST_LENGTH];
+    if (req->method.len >= sizeof(method)) {
+        return http_response_set_error(resp, 400);
+    }
+    if (req->path.len >= sizeof(req_path)) {
+        return http_response_set_error(resp, 414);
+    }
+    http_slice_copy(method, sizeof(method), buffer, req->method);
+    http_slice_copy(req_path, sizeof(req_path), buffer, req->path);
+    bool is_get = strcmp(method, "GET") == 0;
+
+    const char *host = NULL;
+    if (req->known[HTTP_HEADER_HOST] >= 0) {
+        http_slice_copy(host_buf, sizeof(host_buf), buffer,
+                        req->headers[req->known[HTTP_HEADER_HOST]].value);
+        host = host_buf;
     }
-    buffer[bytes_read] = '\0';
-
-    char *buffer_copy = strdup(buffer);
-    char *method = strtok(buffer_copy, " ");
-    char *req_path = strtok(NULL, " ");
-    char *http_version = strtok(NULL, "\r\n");
-    char *host = get_host(buffer);
-    char *user_agent = get_user_agent(buffer);
-    char *referer = get_referer(buffer);
 
-    // 提取条件请求头部
-    char *if_none_match = extract_header_value(buffer, "If-None-Match");
-    char *if_modified_since_str = extract_header_value(buffer, "If-Modified-Since");
+    // 条件请求头部
+    char if_none_match_buf[256];
+    const char *if_none_match = NULL;
+    if (req->known[HTTP_HEADER_IF_NONE_MATCH] >= 0) {
+        http_slice_copy(if_none_match_buf, sizeof(if_none_match_buf), buffer,
+                        req->headers[req->known[HTTP_HEADER_IF_NONE_MATCH]].value);
+        if_none_match = if_none_match_buf;
+    }
     time_t if_modified_since = 0;
-    if (if_modified_since_str) {
-        if_modified_since = atol(if_modified_since_str);
+    if (req->known[HTTP_HEADER_IF_MODIFIED_SINCE] >= 0) {
+        char value[64];
+        http_slice_copy(value, sizeof(value), buffer,
+                        req->headers[req->known[HTTP_HEADER_IF_MODIFIED_SINCE]].value);
+        if_modified_since = atol(value);
     }
 
     // Create access log entry
     access_log_entry_t *access_entry = create_access_log_entry();
     if (access_entry) {
-        // Set basic request info
+        size_t len;
+        const char *value;
         free(access_entry->client_ip);
         access_entry->client_ip = strdup(client_ip ? client_ip : "-");
-        
-        if (method) {
-            free(access_entry->method);
-            access_entry->method = strdup(method);
-        }
-        
-        if (req_path) {
-            free(access_entry->uri);
-            access_entry->uri = strdup(req_path);
-        }
-        
-        if (http_version) {
-            free(access_entry->protocol);
-            access_entry->protocol = strdup(http_version);
-        }
-        
-        if (user_agent) {
+        free(access_entry->method);
+        access_entry->method = strdup(method);
+        free(access_entry->uri);
+        access_entry->uri = strndup(http_slice_ptr(buffer, req->uri), req->uri.len);
+        free(access_entry->protocol);
+        access_entry->protocol = strndup(http_slice_ptr(buffer, req->version), req->version.len);
+        value = http_request_known(req, buffer, HTTP_HEADER_USER_AGENT, &len);
+        if (value) {
             free(access_entry->user_agent);
-            access_entry->user_agent = strdup(user_agent);
+            access_entry->user_agent = strndup(value, len);
         }
-        
-        if (referer) {
+        value = http_request_known(req, buffer, HTTP_HEADER_REFERER, &len);
+        if (value) {
             free(access_entry->referer);
-            access_entry->referer = strdup(referer);
+            access_entry->referer = strndup(value, len);
         }
-        
         access_entry->request_time = start_time;
         access_entry->server_port = 443; // Default HTTPS port
     }
 
-    if (!method || !req_path) {
-        // Invalid request format
-        if (access_entry) {
-            access_entry->status_code = 400;
-            access_entry->response_size = 0;
-            
-            struct timeval end_time;
-            gettimeofday(&end_time, NULL);
-            access_entry->request_duration_ms = 
-                (end_time.tv_sec - start_time.tv_sec) * 1000.0 +
-                (end_time.tv_usec - start_time.tv_usec) / 1000.0;
-            
-            log_access_entry(access_entry);
-            free_access_log_entry(access_entry);
-        }
-        
-        free(buffer_copy);
-        free(host);
-        free(user_agent);
-        free(referer);
-        if (if_none_match) free(if_none_match);
-        if (if_modified_since_str) free(if_modified_since_str);
-        SSL_shutdown(ssl);
-        SSL_free(ssl);
-        return;
-    }
-
     char log_msg[BUFFER_SIZE];
     snprintf(log_msg, sizeof(log_msg), "HTTPS Request from %s: %s %s (Host: %s)",
              client_ip, method, req_path, host ? host : "none");
     log_message(LOG_LEVEL_INFO, log_msg);
 
     // --- Routing ---
-    route_t route = find_route(core_conf, host, req_path, 8443);
+    route_t route = find_route(core_conf, host, req_path, conn->local_port);
     if (!route.server) {
         log_message(LOG_LEVEL_ERROR, "Could not find a server block for the request.");
-        const char *response = "HTTP/1.1 500 Internal Server Error\r\n\r\n";
-        SSL_write(ssl, response, strlen(response));
+        const char *response = "HTTP/1.1 500 Internal Server Error\r\n"
+                              "Content-Length: 0\r\n"
+                              "Connection: close\r\n\r\n";
+        http_response_set_raw(resp, response, strlen(response));
         
         if (access_entry) {
             access_entry->status_code = 500;
@@ -219,61 +199,42 @@ void handle_https_request(SSL *ssl, const char *client_ip, core_config_t *core_c
             free_access_log_entry(access_entry);
         }
         
-        free(host);
-        free(buffer_copy);
-        free(user_agent);
-        free(referer);
-        if (if_none_match) free(if_none_match);
-        if (if_modified_since_str) free(if_modified_since_str);
-        SSL_shutdown(ssl);
-        SSL_free(ssl);
-        return;
+        return 0;
     }
 
+    // location的运行时配置在加载配置时已解析
+    const location_conf_t *lc = route.conf;
+
     // Set server info in access log
     if (access_entry) {
-        const char *server_name = get_directive_value("server_name", route.server->directives, route.server->directive_count);
-        if (server_name) {
+        if (lc->server_name) {
             free(access_entry->server_name);
-            access_entry->server_name = strdup(server_name);
-        }
-        
-        const char *listen_port = get_directive_value("listen", route.server->directives, route.server->directive_count);
-        if (listen_port) {
-            // Parse port from "443 ssl" format
-            char *port_copy = strdup(listen_port);
-            if (port_copy) {
-                char *port_str = strtok(port_copy, " ");
-                if (port_str) {
-                    access_entry->server_port = atoi(port_str);
-                }
-                free(port_copy);
-            }
+            access_entry->server_name = strdup(lc->server_name);
         }
+        access_entry->server_port = conn->local_port;
     }
 
-    // 检查是否有proxy_pass指令
-    const char *proxy_pass = NULL;
-    if (route.location) {
-        proxy_pass = get_directive_value("proxy_pass", route.location->directives, route.location->directive_count);
-    }
+    const char *proxy_pass = lc->proxy_pass;
 
-    // 如果配置了proxy_pass，执行反向代理
+    // 如果配置了proxy_pass，执行反向代理（同步转发，完成后关闭连接）
     if (proxy_pass) {
-        char *headers = extract_ssl_headers(buffer);
+        // 转发给上游的是完整的请求目标（含查询串）
+        char *uri = strndup(http_slice_ptr(buffer, req->uri), req->uri.len);
+        char *http_version = strndup(http_slice_ptr(buffer, req->version), req->version.len);
+        char *headers = request_headers(req, buffer);
         int result = -1;
         
         // 检查是否为upstream代理
         if (is_upstream_proxy(proxy_pass)) {
             char *upstream_name = extract_upstream_name(proxy_pass);
             if (upstream_name) {
-                result = handle_lb_https_proxy_request(ssl, method, req_path, http_version, 
+                result = handle_lb_https_proxy_request(ssl, method, uri, http_version, 
                                                      headers, upstream_name, client_ip, core_conf);
                 free(upstream_name);
             }
         } else {
             // 传统的直接代理
-            result = handle_https_proxy_request(ssl, method, req_path, http_version, 
+            result = handle_https_proxy_request(ssl, method, uri, http_version, 
                                               headers, proxy_pass, client_ip);
         }
         
@@ -313,150 +274,108 @@ void handle_https_request(SSL *ssl, const char *client_ip, core_config_t *core_c
                                   "Content-Length: 15\r\n"
                                   "Connection: close\r\n\r\n"
                                   "Bad Gateway";
-            SSL_write(ssl, response, strlen(response));
+            http_response_set_raw(resp, response, strlen(response));
         }
         
         free(headers);
-        free(host);
-        free(buffer_copy);
-        free(user_agent);
-        free(referer);
-        if (if_none_match) free(if_none_match);
-        if (if_modified_since_str) free(if_modified_since_str);
-        SSL_shutdown(ssl);
-        SSL_free(ssl);
-        return;
-    }
-
-    const char *root = get_directive_value("root", route.server->directives, route.server->directive_count);
-    if (route.location) {
-        const char* loc_root = get_directive_value("root", route.location->directives, route.location->directive_count);
-        if (loc_root) root = loc_root;
-    }
-    if (!root) {
-        root = "./www";
+        free(uri);
+        free(http_version);
+        return 0;
     }
 
-    char file_path[BUFFER_SIZE];
+    // 静态文件：相对于location的root打开，经过打开文件缓存
+    int status_code = 200;
+    open_file_t *of = NULL;
+    const char *rel = req_path;
     if (strcmp(req_path, "/") == 0) {
-        // 处理根目录请求，查找index文件
-        const char *index_directive = NULL;
-        if (route.location) {
-            index_directive = get_directive_value("index", route.location->directives, route.location->directive_count);
+        // 处理根目录请求，按顺序尝试index文件
+        for (int i = 0; i < lc->index_count && !of; i++) {
+            rel = lc->index[i];
+            of = open_file_cache_open(lc, rel);
         }
-        if (!index_directive && route.server) {
-            index_directive = get_directive_value("index", route.server->directives, route.server->directive_count);
-        }
-        
-        bool index_found = false;
-        if (index_directive) {
-            // 解析index指令，尝试多个文件
-            char *index_copy = strdup(index_directive);
-            char *index_file = strtok(index_copy, " \t");
-            
-            while (index_file && !index_found) {
-                snprintf(file_path, sizeof(file_path), "%s/%s", root, index_file);
-                struct stat temp_stat;
-                if (stat(file_path, &temp_stat) == 0 && S_ISREG(temp_stat.st_mode)) {
-                    index_found = true;
-                }
-                if (!index_found) {
-                    index_file = strtok(NULL, " \t");
-                }
-            }
-            free(index_copy);
-        }
-        
-        if (!index_found) {
+        if (!of) {
             // 如果没有找到配置的index文件，使用默认的
-            snprintf(file_path, sizeof(file_path), "%s%s", root, TEMP_DEFAULT_PAGE);
+            rel = TEMP_DEFAULT_PAGE;
+            of = open_file_cache_open(lc, rel);
         }
     } else {
-        snprintf(file_path, sizeof(file_path), "%s%s", root, req_path);
+        of = open_file_cache_open(lc, req_path);
     }
 
-    struct stat file_stat;
-    int status_code = 200;
-
-    if (stat(file_path, &file_stat) < 0 || !S_ISREG(file_stat.st_mode)) {
+    if (!of) {
         status_code = 404;
-        snprintf(file_path, sizeof(file_path), "%s%s", root,
-                 TEMP_NOT_FOUND_PAGE);
-        stat(file_path, &file_stat);
+        of = open_file_cache_open(lc, TEMP_NOT_FOUND_PAGE);
     }
 
-    const char *mime_type = get_mime_type(file_path);
-    
-    // 检查是否需要压缩
-    char *accept_encoding = extract_header_value(buffer, "Accept-Encoding");
-    bool should_compress = false;
-    compress_context_t *compress_ctx = NULL;
-    unsigned char *compressed_data = NULL;
-    size_t compressed_size = 0;
-    long final_content_length = file_stat.st_size;
-    
-    // 获取压缩配置
-    compress_config_t *compress_config = NULL;
-    if (core_conf && core_conf->raw_config && core_conf->raw_config->compress) {
-        compress_config = core_conf->raw_config->compress;
+    // 原文件存在时优先发送客户端接受的预压缩文件，不再实时压缩；Content-Type仍取原文件的
+    size_t accept_encoding_len;
+    const char *accept_encoding = http_request_known(req, buffer, HTTP_HEADER_ACCEPT_ENCODING,
+                                                     &accept_encoding_len);
+    const char *mime_type = of ? of->mime : "text/plain";
+    const char *static_encoding = NULL;
+    if (of && status_code == 200 && precompressed_enabled(lc)) {
+        open_file_t *sidecar = precompressed_open(lc, rel, mime_type, accept_encoding,
+                                                  accept_encoding_len, &static_encoding);
+        if (sidecar) {
+            open_file_cache_release(of);
+            of = sidecar;
+        }
     }
+
+    // fd属于打开文件缓存，用pread读取，不改变共享的文件偏移
+    int file_fd = of ? of->fd : -1;
+    off_t file_size = of ? of->size : 0;
+    time_t file_mtime = of ? of->mtime : 0;
     
-    int file_fd = open(file_path, O_RDONLY);
+    // Range只用于GET的完整文件；区间响应发送文件原文，不压缩
+    const char *range_header = NULL;
+    const char *if_range = NULL;
+    size_t range_len = 0;
+    size_t if_range_len = 0;
+    if (status_code == 200 && is_get) {
+        range_header = http_request_known(req, buffer, HTTP_HEADER_RANGE, &range_len);
+        if_range = http_request_known(req, buffer, HTTP_HEADER_IF_RANGE, &if_range_len);
+    }
+    http_range_t ranges[HTTP_RANGE_MAX];
+    int range_count = of ? request_ranges(range_header, range_len, if_range, if_range_len,
+                                          of->etag, of->last_modified, file_size, ranges)
+                         : -1;
     
-    if (compress_config && compress_config->enable_compression && 
-        accept_encoding && client_accepts_compression(accept_encoding) &&
-        should_compress_mime_type(compress_config, mime_type) &&
-        (size_t)file_stat.st_size >= compress_config->min_length && file_fd >= 0) {
-        
-        should_compress = true;
-        compress_ctx = compress_context_create(compress_config);
-        
-        if (compress_ctx) {
-            // 读取文件内容
-            char *file_content = malloc(file_stat.st_size);
-            if (file_content) {
-                ssize_t bytes_read = read(file_fd, file_content, file_stat.st_size);
-                if (bytes_read == file_stat.st_size) {
-                    // 压缩数据
-                    compressed_data = malloc(file_stat.st_size + 1024); // 预留空间
-                    compressed_size = file_stat.st_size + 1024;
-                    
-                    if (compress_data(compress_ctx, file_content, file_stat.st_size, 
-                                    compressed_data, &compressed_size, Z_FINISH) == Z_STREAM_END) {
-                        final_content_length = compressed_size;
-                        log_message(LOG_LEVEL_DEBUG, "HTTPS file compressed successfully");
-                    } else {
-                        should_compress = false;
-                        free(compressed_data);
-                        compressed_data = NULL;
-                        log_message(LOG_LEVEL_WARNING, "HTTPS compression failed, sending uncompressed");
-                    }
-                } else {
-                    should_compress = false;
-                    log_message(LOG_LEVEL_WARNING, "Failed to read file for HTTPS compression");
-                }
-                free(file_content);
-            } else {
-                should_compress = false;
-            }
-        } else {
-            should_compress = false;
-        }
+    // 按Accept-Encoding和MIME类型协商压缩编码，区间响应发送文件原文，不压缩；
+    // 可压缩的类型无论是否压缩，响应都随Accept-Encoding变化
+    compress_config_t *compress_config = lc->compress;  // 该location生效的压缩配置，关闭时为NULL
+    bool compressible = compress_config && !static_encoding && file_fd >= 0 &&
+                        should_compress_mime_type(compress_config, mime_type) &&
+                        (size_t)file_size >= compress_config->min_length;
+    compress_encoding_t encoding = COMPRESS_ENCODING_NONE;
+    if (compressible && range_count < 0) {
+        encoding = compress_negotiate(compress_config, mime_type, accept_encoding,
+                                      accept_encoding_len);
     }
     
-    // 检查缓存
+    // 检查缓存；缓存按协商出的编码存取对应的表示形式，命中时不必重新压缩。
+    // 开启预压缩文件的location不使用缓存，预压缩文件本身已经经过打开文件缓存零拷贝发送
     cache_response_t *cached_response = NULL;
-    if (core_conf->cache_manager && method && strcmp(method, "GET") == 0) {
-        cached_response = cache_get(core_conf->cache_manager, req_path, 
+    bool use_cache = core_conf->cache_manager && lc->cache && !precompressed_enabled(lc) &&
+                     is_get;
+    if (use_cache) {
+        cached_response = cache_get(core_conf->cache_manager, req_path, cache_variant(encoding),
                                    if_none_match, if_modified_since);
         
+        // 文件已修改：缓存的各表示形式全部作废，按未命中处理
+        if (cached_response && of && cached_response->last_modified != file_mtime) {
+            cache_remove(core_conf->cache_manager, req_path);
+            cache_response_free(cached_response);
+            cached_response = NULL;
+        }
+        
         if (cached_response) {
             if (cached_response->needs_validation) {
                 // 304 Not Modified
                 const char *response = "HTTP/1.1 304 Not Modified\r\n"
                                       "Server: ANX HTTP Server/0.6.0\r\n"
                                       "Connection: close\r\n\r\n";
-                SSL_write(ssl, response, strlen(response));
+                http_response_set_raw(resp, response, strlen(response));
                 
                 if (access_entry) {
                     access_entry->status_code = 304;
@@ -473,15 +392,8 @@ void handle_https_request(SSL *ssl, const char *client_ip, core_config_t *core_c
                 }
                 
                 cache_response_free(cached_response);
-                free(host);
-                free(buffer_copy);
-                free(user_agent);
-                free(referer);
-                if (if_none_match) free(if_none_match);
-                if (if_modified_since_str) free(if_modified_since_str);
-                SSL_shutdown(ssl);
-                SSL_free(ssl);
-                return;
+                open_file_cache_release(of);
+                return 0;
             }
             
             if (cached_response->is_cached && cached_response->content) {
@@ -489,40 +401,93 @@ void handle_https_request(SSL *ssl, const char *client_ip, core_config_t *core_c
                 const char *mime_type = cached_response->content_type ? 
                                        cached_response->content_type : "application/octet-stream";
                 
+                // 未压缩的缓存内容按区间切片；压缩内容忽略Range，发送完整内容
+                int hit_status = 200;
+                int hit_ranges = -1;
+                http_range_t hit_range[HTTP_RANGE_MAX];
+                char hit_last_modified[OPEN_FILE_HTTP_DATE_SIZE] = "";
+                if (cached_response->last_modified > 0) {
+                    struct tm tm;
+                    gmtime_r(&cached_response->last_modified, &tm);
+                    strftime(hit_last_modified, sizeof(hit_last_modified),
+                             "%a, %d %b %Y %H:%M:%S GMT", &tm);
+                }
+                if (cached_response->variant == CACHE_VARIANT_IDENTITY) {
+                    hit_ranges = request_ranges(range_header, range_len, if_range, if_range_len,
+                                                cached_response->etag, hit_last_modified,
+                                                (off_t)cached_response->content_length, hit_range);
+                }
+                
+                char range_line[128] = "";
+                char *multipart = NULL;
+                long content_length = (long)cached_response->content_length;
+                if (hit_ranges >= 0) {
+                    long len = range_headers(range_line, sizeof(range_line), hit_range, hit_ranges,
+                                             (off_t)cached_response->content_length, mime_type,
+                                             cached_response->content, &multipart, NULL);
+                    if (len >= 0) {
+                        hit_status = hit_ranges == 0 ? 416 : 206;
+                        content_length = len;
+                    } else {
+                        range_line[0] = '\0';
+                    }
+                }
+                
                 char header[BUFFER_SIZE * 2];
                 int header_len = snprintf(header, sizeof(header),
-                         "HTTP/1.1 200 OK\r\n"
-                         "Content-Type: %s\r\n"
-                         "Content-Length: %zu\r\n"
+                         "HTTP/1.1 %d %s\r\n"
+                         "%s%s%s"
+                         "Content-Length: %ld\r\n"
                          "Server: ANX HTTP Server/0.6.0\r\n"
-                         "X-Cache: HIT\r\n",
-                         mime_type, cached_response->content_length);
+                         "X-Cache: HIT\r\n"
+                         "Accept-Ranges: bytes\r\n",
+                         hit_status, status_reason(hit_status),
+                         multipart ? "" : "Content-Type: ", multipart ? "" : mime_type,
+                         multipart ? "" : "\r\n", content_length);
+                header_len += snprintf(header + header_len, sizeof(header) - header_len,
+                                      "%s", range_line);
                 
                 if (cached_response->etag) {
                     header_len += snprintf(header + header_len, sizeof(header) - header_len,
                                           "ETag: %s\r\n", cached_response->etag);
                 }
                 
-                if (cached_response->last_modified > 0) {
+                if (hit_last_modified[0]) {
                     header_len += snprintf(header + header_len, sizeof(header) - header_len,
-                                          "Last-Modified: %ld\r\n", cached_response->last_modified);
+                                          "Last-Modified: %s\r\n", hit_last_modified);
                 }
                 
-                if (cached_response->is_compressed) {
+                if (cached_response->variant != CACHE_VARIANT_IDENTITY) {
+                    header_len += snprintf(header + header_len, sizeof(header) - header_len,
+                                          "Content-Encoding: %s\r\n",
+                                          compress_encoding_name(encoding));
+                }
+                if (compressible && compress_config->enable_vary) {
                     header_len += snprintf(header + header_len, sizeof(header) - header_len,
-                                          "Content-Encoding: gzip\r\n"
                                           "Vary: Accept-Encoding\r\n");
                 }
                 
                 header_len += snprintf(header + header_len, sizeof(header) - header_len,
                                       "Connection: close\r\n\r\n");
                 
-                SSL_write(ssl, header, strlen(header));
-                SSL_write(ssl, cached_response->content, cached_response->content_length);
+                http_response_set_raw(resp, header, header_len);
+                if (multipart) {
+                    resp->body = multipart;
+                    resp->body_len = (size_t)content_length;
+                } else if (hit_status != 416) {
+                    // 接管缓存副本作为响应体，由连接在发送完毕后释放；单区间只发送其中的切片
+                    resp->body = cached_response->content;
+                    resp->body_len = cached_response->content_length;
+                    cached_response->content = NULL;
+                    if (hit_status == 206) {
+                        resp->body_sent = (size_t)hit_range[0].start;
+                        resp->body_len = (size_t)hit_range[0].end + 1;
+                    }
+                }
                 
                 if (access_entry) {
-                    access_entry->status_code = 200;
-                    access_entry->response_size = strlen(header) + cached_response->content_length;
+                    access_entry->status_code = hit_status;
+                    access_entry->response_size = strlen(header) + content_length;
                     
                     struct timeval end_time;
                     gettimeofday(&end_time, NULL);
@@ -535,113 +500,197 @@ void handle_https_request(SSL *ssl, const char *client_ip, core_config_t *core_c
                 }
                 
                 cache_response_free(cached_response);
-                free(host);
-                free(buffer_copy);
-                free(user_agent);
-                free(referer);
-                if (if_none_match) free(if_none_match);
-                if (if_modified_since_str) free(if_modified_since_str);
-                SSL_shutdown(ssl);
-                SSL_free(ssl);
-                return;
+                open_file_cache_release(of);
+                return 0;
             }
         }
     }
 
-    // 构建响应头
+    // 检查是否需要压缩：不超过一个压缩缓冲区的文件一次压缩完，带Content-Length；
+    // 更大的文件按块流式压缩，长度未知，HTTP/1.1用分块传输编码，内存占用与文件大小无关
+    bool should_compress = false;
+    unsigned char *compressed_data = NULL;
+    size_t compressed_size = 0;
+    http_body_stream_t *compress_stream = NULL;
+    bool chunked = req->version_minor >= 1;
+    long final_content_length = file_size;
+    
+    bool cache_result = use_cache && status_code == 200 && file_size > 0 &&
+                        cache_config_is_cacheable(lc->cache, mime_type, file_size);
+    
+    if (encoding != COMPRESS_ENCODING_NONE) {
+        if ((size_t)file_size > compress_config->compression_buffer_size) {
+            compress_stream = compress_stream_create(compress_config, encoding, of, chunked);
+            if (compress_stream) {
+                should_compress = true;
+                if (cache_result) {
+                    compress_stream_cache(compress_stream, core_conf->cache_manager, req_path,
+                                          cache_variant(encoding), mime_type, of->etag,
+                                          file_mtime, (size_t)file_size);
+                }
+                of = NULL;  // 文件引用已转移给流
+            }
+        } else {
+            // 写入缓存的结果只压缩一次，可以使用离线级别
+            compress_context_t *compress_ctx = compress_context_acquire(
+                compress_config, encoding,
+                cache_result ? COMPRESS_PROFILE_OFFLINE : COMPRESS_PROFILE_DYNAMIC,
+                (size_t)file_size);
+            if (compress_ctx) {
+                // 文件读入压缩上下文的输入缓冲区
+                ssize_t bytes_read = pread(file_fd, compress_ctx->in_buffer, file_size, 0);
+                if (bytes_read == file_size) {
+                    compressed_data = malloc(file_size + 1024); // 预留空间
+                    compressed_size = file_size + 1024;
+                    
+                    if (compressed_data &&
+                        compress_data(compress_ctx, compress_ctx->in_buffer, file_size, 
+                                    compressed_data, &compressed_size, Z_FINISH) == Z_STREAM_END) {
+                        should_compress = true;
+                        final_content_length = compressed_size;
+                        log_message(LOG_LEVEL_DEBUG, "HTTPS file compressed successfully");
+                    } else {
+                        free(compressed_data);
+                        compressed_data = NULL;
+                        log_message(LOG_LEVEL_WARNING, "HTTPS compression failed, sending uncompressed");
+                    }
+                } else {
+                    log_message(LOG_LEVEL_WARNING, "Failed to read file for HTTPS compression");
+                }
+                compress_context_release(compress_ctx);
+            }
+        }
+    }
+    
+    // 文件区间：单区间发送文件的一段，多区间的分隔行作为各部分前的内存数据
+    char range_line[128] = "";
+    http_response_parts_t *parts = NULL;
+    if (range_count >= 0 && file_fd >= 0) {
+        long len = range_headers(range_line, sizeof(range_line), ranges, range_count, file_size,
+                                 mime_type, NULL, NULL, &parts);
+        if (len >= 0) {
+            status_code = range_count == 0 ? 416 : 206;
+            final_content_length = len;
+        } else {
+            range_count = -1;
+            range_line[0] = '\0';
+        }
+    }
+    
+    // 构建响应头，location的add_header已预先渲染
+    size_t extra_len;
+    const char *extra = location_conf_headers(lc, status_code, &extra_len);
     char header[BUFFER_SIZE * 2];
+    char length_line[64];
+    if (compress_stream) {
+        snprintf(length_line, sizeof(length_line), "%s",
+                 chunked ? "Transfer-Encoding: chunked\r\n" : "");
+    } else {
+        snprintf(length_line, sizeof(length_line), "Content-Length: %ld\r\n", final_content_length);
+    }
     int header_len = snprintf(header, sizeof(header),
              "HTTP/1.1 %d %s\r\n"
-             "Content-Type: %s\r\n"
-             "Content-Length: %ld\r\n"
-             "Server: ANX HTTP Server/0.6.0\r\n",
-             status_code, (status_code == 200) ? "OK" : "Not Found", mime_type,
-             final_content_length);
+             "%s%s%s"
+             "%s"
+             "Server: ANX HTTP Server/0.6.0\r\n"
+             "Accept-Ranges: bytes\r\n"
+             "%s"
+             "%.*s",
+             status_code, status_reason(status_code),
+             parts ? "" : "Content-Type: ", parts ? "" : mime_type, parts ? "" : "\r\n",
+             length_line, range_line, (int)extra_len, extra);
     
-    // 添加压缩相关头部
+    // 添加压缩相关头部；开启预压缩文件时同一URI的响应总是随Accept-Encoding变化
+    if (static_encoding && status_code != 416) {
+        header_len += snprintf(header + header_len, sizeof(header) - header_len,
+                              "Content-Encoding: %s\r\n", static_encoding);
+    }
     if (should_compress) {
         header_len += snprintf(header + header_len, sizeof(header) - header_len,
-                              "Content-Encoding: gzip\r\n");
-        if (compress_config && compress_config->enable_vary) {
-            header_len += snprintf(header + header_len, sizeof(header) - header_len,
-                                  "Vary: Accept-Encoding\r\n");
-        }
+                              "Content-Encoding: %s\r\n", compress_encoding_name(encoding));
+    }
+    if ((compressible && compress_config->enable_vary) ||
+        (precompressed_enabled(lc) && status_code != 416)) {
+        header_len += snprintf(header + header_len, sizeof(header) - header_len,
+                              "Vary: Accept-Encoding\r\n");
     }
     
     header_len += snprintf(header + header_len, sizeof(header) - header_len,
                           "Connection: close\r\n\r\n");
 
-    // 创建头部处理上下文
-    header_context_t *header_ctx = NULL;
-    if (route.location) {
-        header_ctx = create_header_context(route.location->directives, route.location->directive_count);
-    }
-    if (!header_ctx && route.server) {
-        header_ctx = create_header_context(route.server->directives, route.server->directive_count);
-    }
-    
-    // 应用头部操作
-    if (header_ctx) {
-        apply_headers_to_response(header, sizeof(header), header_ctx, status_code, mime_type, final_content_length);
-        free_header_context(header_ctx);
-    }
-
-    SSL_write(ssl, header, strlen(header));
-
     long total_response_size = strlen(header);
     
-    if (file_fd >= 0) {
-        if (should_compress && compressed_data) {
-            // 发送压缩后的数据
-            SSL_write(ssl, compressed_data, compressed_size);
-            total_response_size += compressed_size;
-            free(compressed_data);
-        } else {
-            // 发送原始文件
-            lseek(file_fd, 0, SEEK_SET); // 重置文件指针
-            char file_buffer[BUFFER_SIZE];
-            ssize_t bytes;
-            while((bytes = read(file_fd, file_buffer, BUFFER_SIZE)) > 0) {
-                SSL_write(ssl, file_buffer, bytes);
-                total_response_size += bytes;
-            }
-        }
-        close(file_fd);
-    } else {
+    if (file_fd < 0) {
         log_message(LOG_LEVEL_ERROR, "Could not open requested file for HTTPS.");
         // Send error response body
         const char *error_body = "Internal Server Error";
-        SSL_write(ssl, error_body, strlen(error_body));
+        snprintf(header + strlen(header), sizeof(header) - strlen(header), "%s", error_body);
         total_response_size += strlen(error_body);
         status_code = 500;
     }
     
     // 将内容添加到缓存
-    if (core_conf->cache_manager && method && strcmp(method, "GET") == 0 && 
-        status_code == 200 && file_stat.st_size > 0) {
-        
-        if (cache_config_is_cacheable(core_conf->raw_config->cache, mime_type, file_stat.st_size)) {
-            // 读取文件内容用于缓存
-            char *file_content_for_cache = malloc(file_stat.st_size);
+    // 流式压缩的结果在压缩完成时由流写入缓存
+    if (cache_result && status_code == 200 && !compress_stream) {
+        // 存储发送的表示形式（已压缩则存储压缩结果），与同一文件的其他表示形式共享元数据
+        if (should_compress && compressed_data) {
+            cache_put(core_conf->cache_manager, req_path, cache_variant(encoding),
+                     (char *)compressed_data, compressed_size,
+                     mime_type, of->etag, file_mtime, 0);
+        } else if (!should_compress) {
+            // 读取文件内容用于缓存，pread不影响后续发送偏移
+            char *file_content_for_cache = malloc(file_size);
             if (file_content_for_cache) {
-                lseek(file_fd, 0, SEEK_SET);
-                if (read(file_fd, file_content_for_cache, file_stat.st_size) == file_stat.st_size) {
-                    // 存储到缓存（如果已压缩则存储压缩版本）
-                    if (should_compress && compressed_data) {
-                        cache_put(core_conf->cache_manager, req_path, 
-                                 (char *)compressed_data, compressed_size, 
-                                 mime_type, file_stat.st_mtime, 0, true);
-                    } else {
-                        cache_put(core_conf->cache_manager, req_path, 
-                                 file_content_for_cache, file_stat.st_size, 
-                                 mime_type, file_stat.st_mtime, 0, false);
-                    }
+                if (pread(file_fd, file_content_for_cache, file_size, 0) == file_size) {
+                    cache_put(core_conf->cache_manager, req_path, CACHE_VARIANT_IDENTITY,
+                             file_content_for_cache, file_size,
+                             mime_type, of->etag, file_mtime, 0);
                 }
                 free(file_content_for_cache);
             }
         }
     }
 
+    // 交给连接状态机发送：压缩数据作为内存响应体，否则按文件区间分块发送
+    if (http_response_set_raw(resp, header, strlen(header)) < 0) {
+        log_message(LOG_LEVEL_ERROR, "HTTPS response header too large");
+        status_code = 500;
+        free(compressed_data);
+        free(parts);
+        if (compress_stream) compress_stream->free(compress_stream);
+        open_file_cache_release(of);
+    } else if (status_code == 416) {
+        open_file_cache_release(of);
+    } else if (status_code == 206) {
+        resp->file_fd = file_fd;
+        resp->file = of;
+        if (parts) {
+            resp->parts = parts;
+            http_response_next_part(resp);
+        } else {
+            resp->file_offset = ranges[0].start;
+            resp->file_remaining = (size_t)final_content_length;
+        }
+        total_response_size += final_content_length;
+    } else if (compress_stream) {
+        // 压缩输出由连接状态机逐段取用，访问日志只能记录响应头
+        resp->stream = compress_stream;
+    } else if (file_fd >= 0) {
+        if (should_compress && compressed_data) {
+            resp->body = (char *)compressed_data;
+            resp->body_len = compressed_size;
+            total_response_size += compressed_size;
+            open_file_cache_release(of);
+        } else {
+            free(compressed_data);
+            resp->file_fd = file_fd;
+            resp->file = of;
+            resp->file_offset = 0;
+            resp->file_remaining = file_size;
+            total_response_size += file_size;
+        }
+    }
+
     // Log the access entry
     if (access_entry) {
         access_entry->status_code = status_code;
@@ -657,13 +706,6 @@ void handle_https_request(SSL *ssl, const char *client_ip, core_config_t *core_c
         free_access_log_entry(access_entry);
     }
 
-    free(host);
-    free(buffer_copy);
-    free(user_agent);
-    free(referer);
-    if (if_none_match) free(if_none_match);
-    if (if_modified_since_str) free(if_modified_since_str);
     if (cached_response) cache_response_free(cached_response);
-    SSL_shutdown(ssl);
-    SSL_free(ssl);
+    return 0;
 } 
\ No newline at end of file
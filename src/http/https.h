@@ -3,7 +3,10 @@
 
 #include <openssl/ssl.h>
 #include "core.h"
+#include "connection.h"
 
-void handle_https_request(SSL *ssl, const char *client_ip, core_config_t *core_conf);
+// 解析conn->buffer中已解密的请求并在conn->response中准备响应
+// 返回0表示响应已就绪，-1表示应关闭连接
+int handle_https_request(connection_t *conn, core_config_t *core_conf);
 
-#endif  // HTTPS_H 
\ No newline at end of file
+#endif  // HTTPS_H
@@ -0,0 +1,247 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "location_conf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "headers.h"
+#include "log.h"
+
+#define DEFAULT_ROOT "./www"
+
+// gzip/proxy_cache/enable_bandwidth_limit在server和location中作为on/off开关，
+// 没有设置时沿用上一级；具体参数仍来自http级的全局配置
+static void *resolve_switch(const directive_t *directives, int count, const char *key,
+                            void *global, void *inherited) {
+    const char *value = get_directive_value(key, directives, count);
+    if (!value) return inherited;
+    return strcmp(value, "on") == 0 ? global : NULL;
+}
+
+// gzip_static等按root的规则继承，取值off/on/always
+static static_compress_t resolve_static(const directive_t *directives, int count, const char *key,
+                                        static_compress_t inherited) {
+    const char *value = get_directive_value(key, directives, count);
+    if (!value) return inherited;
+    if (strcmp(value, "on") == 0) return STATIC_COMPRESS_ON;
+    if (strcmp(value, "always") == 0) return STATIC_COMPRESS_ALWAYS;
+    if (strcmp(value, "off") != 0) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Invalid %s value \"%.32s\", using off", key, value);
+        log_message(LOG_LEVEL_WARNING, msg);
+    }
+    return STATIC_COMPRESS_OFF;
+}
+
+static int set_root(location_conf_t *lc, const char *root, const location_conf_t *parent) {
+    size_t len = strlen(root);
+    while (len > 1 && root[len - 1] == '/') len--;
+
+    lc->root = strndup(root, len);
+    if (!lc->root) return -1;
+    lc->root_len = len;
+
+    if (parent && strcmp(parent->root, lc->root) == 0) {
+        lc->root_fd = parent->root_fd;
+        return 0;
+    }
+
+    lc->root_fd = open(lc->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (lc->root_fd < 0) {
+        char msg[ANX_MAX_PATH_LENGTH + 64];
+        snprintf(msg, sizeof(msg), "Cannot open root %s: %s", lc->root, strerror(errno));
+        log_message(LOG_LEVEL_WARNING, msg);
+    } else {
+        lc->owns_root_fd = 1;
+    }
+    // 根路径为"/"时去掉'/'，拼接路径时统一使用"root/rel"
+    if (len == 1 && lc->root[0] == '/') {
+        lc->root[0] = '\0';
+        lc->root_len = 0;
+    }
+    return 0;
+}
+
+static int set_index(location_conf_t *lc, const char *value) {
+    char *copy = strdup(value);
+    if (!copy) return -1;
+
+    char *save = NULL;
+    for (char *name = strtok_r(copy, " \t", &save); name; name = strtok_r(NULL, " \t", &save)) {
+        char **index = realloc(lc->index, (lc->index_count + 1) * sizeof(char *));
+        if (!index) {
+            free(copy);
+            return -1;
+        }
+        lc->index = index;
+        if (!(lc->index[lc->index_count] = strdup(name))) {
+            free(copy);
+            return -1;
+        }
+        lc->index_count++;
+    }
+    free(copy);
+    return 0;
+}
+
+static int append_line(char **buf, size_t *len, const char *name, const char *value) {
+    size_t line_len = strlen(name) + strlen(value) + 4;
+    char *grown = realloc(*buf, *len + line_len + 1);
+    if (!grown) return -1;
+    snprintf(grown + *len, line_len + 1, "%s: %s\r\n", name, value);
+    *buf = grown;
+    *len += line_len;
+    return 0;
+}
+
+// 把add_header/set_header渲染成头部行，响应时直接追加
+static int render_headers(location_conf_t *lc, const directive_t *directives, int count,
+                          const location_conf_t *parent) {
+    header_operations_t *ops = parse_header_operations(directives, count);
+    if (!ops) return -1;
+
+    int rc = 0;
+    int rendered = 0;
+    for (int i = 0; i < ops->count && rc == 0; i++) {
+        const header_operation_t *op = &ops->operations[i];
+        if (op->type == HEADER_REMOVE || !op->name || !op->value) continue;
+        rc = append_line(&lc->headers, &lc->headers_len, op->name, op->value);
+        if (rc == 0 && op->always) {
+            rc = append_line(&lc->headers_always, &lc->headers_always_len, op->name, op->value);
+        }
+        rendered = 1;
+    }
+    free_header_operations(ops);
+    if (rc < 0) return -1;
+
+    if (!rendered && parent) {
+        if (parent->headers_len && !(lc->headers = strdup(parent->headers))) return -1;
+        if (parent->headers_always_len &&
+            !(lc->headers_always = strdup(parent->headers_always))) {
+            return -1;
+        }
+        lc->headers_len = parent->headers_len;
+        lc->headers_always_len = parent->headers_always_len;
+    }
+
+    // 空列表也指向""，调用者无需判断NULL
+    if (!lc->headers && !(lc->headers = strdup(""))) return -1;
+    if (!lc->headers_always && !(lc->headers_always = strdup(""))) return -1;
+    return 0;
+}
+
+location_conf_t *location_conf_create(const config_t *config, const server_block_t *srv,
+                                      const location_block_t *loc, const location_conf_t *parent) {
+    const directive_t *directives;
+    int count;
+    if (loc) {
+        directives = loc->directives;
+        count = loc->directive_count;
+    } else if (srv) {
+        directives = srv->directives;
+        count = srv->directive_count;
+    } else {
+        directives = config->http->directives;
+        count = config->http->directive_count;
+    }
+
+    location_conf_t *lc = calloc(1, sizeof(location_conf_t));
+    if (!lc) return NULL;
+    lc->root_fd = -1;
+
+    const char *root = get_directive_value("root", directives, count);
+    if (!root) root = parent ? parent->root : DEFAULT_ROOT;
+    if (set_root(lc, root, parent) < 0) goto fail;
+
+    const char *index = get_directive_value("index", directives, count);
+    if (index) {
+        if (set_index(lc, index) < 0) goto fail;
+    } else if (parent) {
+        for (int i = 0; i < parent->index_count; i++) {
+            if (set_index(lc, parent->index[i]) < 0) goto fail;
+        }
+    }
+
+    if (loc) {
+        lc->proxy_pass = loc->proxy_pass ? loc->proxy_pass
+                                         : get_directive_value("proxy_pass", directives, count);
+    }
+    lc->server_name = srv && !loc ? get_directive_value("server_name", directives, count)
+                                  : (parent ? parent->server_name : NULL);
+
+    if (parent) {
+        lc->compress = resolve_switch(directives, count, "gzip", config->compress, parent->compress);
+        lc->cache = resolve_switch(directives, count, "proxy_cache", config->cache, parent->cache);
+        lc->bandwidth = resolve_switch(directives, count, "enable_bandwidth_limit",
+                                       config->bandwidth, parent->bandwidth);
+    } else {
+        // http级的开关已由配置解析写入全局配置
+        lc->compress = config->compress && config->compress->enable_compression
+                           ? config->compress : NULL;
+        lc->cache = config->cache && config->cache->enable_cache ? config->cache : NULL;
+        lc->bandwidth = config->bandwidth && config->bandwidth->enable_bandwidth_limit
+                            ? config->bandwidth : NULL;
+    }
+
+    lc->gzip_static = resolve_static(directives, count, "gzip_static",
+                                     parent ? parent->gzip_static : STATIC_COMPRESS_OFF);
+    lc->brotli_static = resolve_static(directives, count, "brotli_static",
+                                       parent ? parent->brotli_static : STATIC_COMPRESS_OFF);
+    lc->zstd_static = resolve_static(directives, count, "zstd_static",
+                                     parent ? parent->zstd_static : STATIC_COMPRESS_OFF);
+
+    if (render_headers(lc, directives, count, parent) < 0) goto fail;
+    return lc;
+
+fail:
+    log_message(LOG_LEVEL_ERROR, "Failed to allocate location configuration");
+    location_conf_free(lc);
+    return NULL;
+}
+
+void location_conf_free(location_conf_t *lc) {
+    if (!lc) return;
+    if (lc->owns_root_fd) close(lc->root_fd);
+    free(lc->root);
+    for (int i = 0; i < lc->index_count; i++) free(lc->index[i]);
+    free(lc->index);
+    free(lc->headers);
+    free(lc->headers_always);
+    free(lc);
+}
+
+static int open_under_root(const location_conf_t *lc, const char *rel) {
+    while (*rel == '/') rel++;
+    if (lc->root_fd >= 0) {
+        return openat(lc->root_fd, *rel ? rel : ".", O_RDONLY | O_CLOEXEC);
+    }
+
+    char path[ANX_MAX_PATH_LENGTH];
+    int n = snprintf(path, sizeof(path), "%s/%s", lc->root, rel);
+    if (n < 0 || (size_t)n >= sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+int location_conf_open_file(const location_conf_t *lc, const char *rel, struct stat *st) {
+    int fd = open_under_root(lc, rel);
+    if (fd < 0) return -1;
+    if (fstat(fd, st) < 0 || !S_ISREG(st->st_mode)) {
+        int err = errno;
+        if (err == 0 || S_ISDIR(st->st_mode)) err = S_ISDIR(st->st_mode) ? EISDIR : EACCES;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
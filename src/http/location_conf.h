@@ -0,0 +1,66 @@
+#ifndef LOCATION_CONF_H
+#define LOCATION_CONF_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+#include "config.h"
+
+// 预编译的location运行时配置：加载配置时由http/server/location三级指令解析一次，
+// 请求处理只读取这里的字段，不再查找或拆分指令
+// 继承规则与nginx一致：root、index和add_header在当前级别没有设置时沿用上一级
+
+// 预压缩文件（gzip_static/brotli_static/zstd_static）的模式
+typedef enum {
+    STATIC_COMPRESS_OFF = 0,
+    STATIC_COMPRESS_ON,         // 客户端的Accept-Encoding接受时发送预压缩文件
+    STATIC_COMPRESS_ALWAYS      // 不检查Accept-Encoding，总是发送预压缩文件
+} static_compress_t;
+
+typedef struct {
+    char *root;                 // 文档根目录，已去掉结尾的'/'
+    size_t root_len;
+    int root_fd;                // 启动时打开的根目录，文件按相对路径openat；打开失败时为-1
+    int owns_root_fd;           // 与上一级root相同时共用上一级的fd
+    char **index;               // index文件列表，按配置顺序尝试
+    int index_count;
+    const char *proxy_pass;     // 指向location的proxy_pass，没有时为NULL
+    const char *server_name;    // 所属server的第一个server_name（访问日志用）
+    compress_config_t *compress;    // 生效的压缩配置，关闭时为NULL
+    static_compress_t gzip_static;  // 同目录下的.gz/.br/.zst文件
+    static_compress_t brotli_static;
+    static_compress_t zstd_static;
+    cache_config_t *cache;          // 生效的缓存配置，关闭时为NULL
+    bandwidth_config_t *bandwidth;  // 生效的带宽限制配置，关闭时为NULL
+    char *headers;              // 预先渲染的add_header/set_header行（"Name: value\r\n"...）
+    size_t headers_len;
+    char *headers_always;       // 其中带always的行，用于4xx/5xx响应
+    size_t headers_always_len;
+} location_conf_t;
+
+// 解析一级配置，parent为上一级（http级为NULL）；loc为NULL时解析server本身
+location_conf_t *location_conf_create(const config_t *config, const server_block_t *srv,
+                                      const location_block_t *loc, const location_conf_t *parent);
+
+void location_conf_free(location_conf_t *lc);
+
+// 打开root下的普通文件并填充st，rel为相对路径（可以带开头的'/'）
+// 返回fd；文件不存在、不是普通文件或路径过长时返回-1
+int location_conf_open_file(const location_conf_t *lc, const char *rel, struct stat *st);
+
+// 响应应附加的头部行：错误响应只附加带always的行
+static inline const char *location_conf_headers(const location_conf_t *lc, int status_code,
+                                                size_t *len) {
+    if (!lc) {
+        *len = 0;
+        return "";
+    }
+    if (status_code >= 400) {
+        *len = lc->headers_always_len;
+        return lc->headers_always;
+    }
+    *len = lc->headers_len;
+    return lc->headers;
+}
+
+#endif // LOCATION_CONF_H
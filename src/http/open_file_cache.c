@@ -0,0 +1,238 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "open_file_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "timer.h"
+#include "util.h"
+
+typedef struct of_entry {
+    open_file_t file;               // 必须是第一个成员，open_file_t*直接转换回条目
+    int refs;                       // 在缓存中时缓存持有一个引用，每个使用中的响应各持有一个
+    int err;                        // 失败条目的errno，此时file.fd为-1
+    int root_fd;
+    dev_t dev;
+    ino_t ino;
+    uint64_t hash;
+    uint64_t last_used;             // 毫秒，用于inactive淘汰
+    uint64_t validated;             // 上次确认与文件系统一致的时间
+    struct of_entry *hash_next;
+    struct of_entry *prev;          // LRU链表，head为最近使用
+    struct of_entry *next;
+    size_t len;
+    char path[];                    // 去掉开头'/'的相对路径
+} of_entry_t;
+
+// 缓存状态（每个worker进程一份）
+static int cache_max = 0;
+static uint64_t cache_inactive = 0;
+static uint64_t cache_valid = 0;
+static int cache_errors = 0;
+static of_entry_t **buckets = NULL;
+static size_t bucket_mask = 0;
+static int cache_count = 0;
+static of_entry_t *lru_head = NULL;
+static of_entry_t *lru_tail = NULL;
+
+static uint64_t key_hash(int root_fd, const char *path, size_t len) {
+    uint64_t h = 14695981039346656037ULL ^ (uint64_t)(unsigned)root_fd;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)path[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static void entry_put(of_entry_t *e) {
+    if (--e->refs > 0) return;
+    if (e->file.fd >= 0) close(e->file.fd);
+    free(e);
+}
+
+static void lru_unlink(of_entry_t *e) {
+    if (e->prev) e->prev->next = e->next; else lru_head = e->next;
+    if (e->next) e->next->prev = e->prev; else lru_tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void lru_push_head(of_entry_t *e) {
+    e->prev = NULL;
+    e->next = lru_head;
+    if (lru_head) lru_head->prev = e; else lru_tail = e;
+    lru_head = e;
+}
+
+// 从缓存中移除并归还缓存持有的引用
+static void entry_remove(of_entry_t *e) {
+    of_entry_t **pp = &buckets[e->hash & bucket_mask];
+    while (*pp != e) pp = &(*pp)->hash_next;
+    *pp = e->hash_next;
+    lru_unlink(e);
+    cache_count--;
+    entry_put(e);
+}
+
+static void entry_insert(of_entry_t *e) {
+    if (cache_count >= cache_max && lru_tail) entry_remove(lru_tail);
+    of_entry_t **bucket = &buckets[e->hash & bucket_mask];
+    e->hash_next = *bucket;
+    *bucket = e;
+    lru_push_head(e);
+    e->refs++;
+    cache_count++;
+}
+
+static of_entry_t *entry_find(int root_fd, const char *path, size_t len, uint64_t hash) {
+    for (of_entry_t *e = buckets[hash & bucket_mask]; e; e = e->hash_next) {
+        if (e->hash == hash && e->root_fd == root_fd && e->len == len &&
+            memcmp(e->path, path, len) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// 打开文件并生成条目；文件不存在等失败也生成条目（fd为-1），只有内存不足时返回NULL
+static of_entry_t *entry_open(const location_conf_t *lc, const char *path, size_t len) {
+    of_entry_t *e = calloc(1, sizeof(of_entry_t) + len + 1);
+    if (!e) return NULL;
+    memcpy(e->path, path, len);
+    e->len = len;
+    e->root_fd = lc->root_fd;
+
+    struct stat st;
+    e->file.fd = location_conf_open_file(lc, path, &st);
+    if (e->file.fd < 0) {
+        e->err = errno;
+        return e;
+    }
+
+    e->dev = st.st_dev;
+    e->ino = st.st_ino;
+    e->file.size = st.st_size;
+    e->file.mtime = st.st_mtime;
+    snprintf(e->file.etag, sizeof(e->file.etag), "\"%lx-%llx\"",
+             (unsigned long)st.st_mtime, (unsigned long long)st.st_size);
+    struct tm tm;
+    gmtime_r(&st.st_mtime, &tm);
+    strftime(e->file.last_modified, sizeof(e->file.last_modified),
+             "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    e->file.mime = get_mime_type(path);
+    return e;
+}
+
+// 按路径重新stat，文件仍是同一个且未修改（失败条目：仍然以同样的原因失败）时返回1
+static int entry_still_valid(const of_entry_t *e) {
+    struct stat st;
+    if (fstatat(e->root_fd, e->len ? e->path : ".", &st, 0) < 0) {
+        return e->file.fd < 0 && errno == e->err;
+    }
+    if (e->file.fd < 0) {
+        // 不是普通文件的失败条目：仍然不是普通文件时继续有效
+        return !S_ISREG(st.st_mode);
+    }
+    return S_ISREG(st.st_mode) && st.st_dev == e->dev && st.st_ino == e->ino &&
+           st.st_size == e->file.size && st.st_mtime == e->file.mtime;
+}
+
+void open_file_cache_init(int max, int inactive_ms, int valid_ms, int errors) {
+    open_file_cache_destroy();
+    cache_max = max > 0 ? max : 0;
+    cache_inactive = inactive_ms > 0 ? (uint64_t)inactive_ms : 0;
+    cache_valid = valid_ms > 0 ? (uint64_t)valid_ms : 0;
+    cache_errors = errors;
+    if (cache_max == 0) return;
+
+    size_t size = 16;
+    while (size < (size_t)cache_max) size <<= 1;
+    buckets = calloc(size, sizeof(of_entry_t *));
+    if (!buckets) {
+        log_message(LOG_LEVEL_WARNING, "Failed to allocate open_file_cache, disabled");
+        cache_max = 0;
+        return;
+    }
+    bucket_mask = size - 1;
+}
+
+void open_file_cache_destroy(void) {
+    while (lru_head) entry_remove(lru_head);
+    free(buckets);
+    buckets = NULL;
+    bucket_mask = 0;
+    cache_max = 0;
+}
+
+open_file_t *open_file_cache_open(const location_conf_t *lc, const char *rel) {
+    while (*rel == '/') rel++;
+    size_t len = strlen(rel);
+
+    // 缓存关闭或root无法打开（按完整路径打开）时每次直接打开
+    if (cache_max == 0 || lc->root_fd < 0) {
+        of_entry_t *e = entry_open(lc, rel, len);
+        if (!e) return NULL;
+        e->refs = 1;
+        if (e->file.fd < 0) {
+            int err = e->err;
+            entry_put(e);
+            errno = err;
+            return NULL;
+        }
+        return &e->file;
+    }
+
+    uint64_t now = timer_now_ms();
+    while (cache_inactive && lru_tail && now - lru_tail->last_used >= cache_inactive) {
+        entry_remove(lru_tail);
+    }
+
+    uint64_t hash = key_hash(lc->root_fd, rel, len);
+    of_entry_t *e = entry_find(lc->root_fd, rel, len, hash);
+    if (e && now - e->validated >= cache_valid) {
+        if (entry_still_valid(e)) {
+            e->validated = now;
+        } else {
+            entry_remove(e);
+            e = NULL;
+        }
+    }
+
+    if (!e) {
+        e = entry_open(lc, rel, len);
+        if (!e) return NULL;
+        if (e->file.fd < 0 && !cache_errors) {
+            int err = e->err;
+            free(e);
+            errno = err;
+            return NULL;
+        }
+        e->hash = hash;
+        e->validated = now;
+        entry_insert(e);
+    } else {
+        lru_unlink(e);
+        lru_push_head(e);
+    }
+    e->last_used = now;
+
+    if (e->file.fd < 0) {
+        errno = e->err;
+        return NULL;
+    }
+    e->refs++;
+    return &e->file;
+}
+
+void open_file_cache_release(open_file_t *of) {
+    if (of) entry_put((of_entry_t *)of);
+}
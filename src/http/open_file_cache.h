@@ -0,0 +1,41 @@
+#ifndef OPEN_FILE_CACHE_H
+#define OPEN_FILE_CACHE_H
+
+#include <sys/types.h>
+#include <time.h>
+
+#include "location_conf.h"
+
+// 静态文件的打开文件缓存（open_file_cache），每个worker进程一份
+// 以(root目录fd, 相对路径)为键缓存已打开的fd及其大小、修改时间、ETag和MIME类型，
+// 命中时请求处理不再open/fstat；开启open_file_cache_errors时还缓存查找失败，
+// 大量404请求不会每次都访问文件系统
+// - 条目超过max时淘汰最久未使用的；inactive时间内没有被使用的条目被淘汰
+// - 条目每隔valid时间按路径重新stat一次，文件被替换、修改或删除后重新打开
+// - 响应发送期间持有条目的引用，条目被淘汰时fd推迟到最后一个引用归还后关闭
+
+#define OPEN_FILE_ETAG_SIZE 48
+#define OPEN_FILE_HTTP_DATE_SIZE 32
+
+typedef struct open_file {
+    int fd;
+    off_t size;
+    time_t mtime;
+    char etag[OPEN_FILE_ETAG_SIZE];                  // 带引号的"mtime-size"（十六进制，与nginx相同）
+    char last_modified[OPEN_FILE_HTTP_DATE_SIZE];    // RFC 1123格式的修改时间
+    const char *mime;                                // 按扩展名得到的Content-Type
+} open_file_t;
+
+// 在worker启动时调用；max为0时关闭缓存，每次请求都直接打开文件
+void open_file_cache_init(int max, int inactive_ms, int valid_ms, int errors);
+
+// 释放缓存中的条目（仍被响应引用的条目在归还时释放）
+void open_file_cache_destroy(void);
+
+// 打开location root下的普通文件，rel为相对路径（可以带开头的'/'）
+// 返回的引用必须用open_file_cache_release归还；失败返回NULL，失败结果也可能来自缓存
+open_file_t *open_file_cache_open(const location_conf_t *lc, const char *rel);
+
+void open_file_cache_release(open_file_t *of);
+
+#endif // OPEN_FILE_CACHE_H
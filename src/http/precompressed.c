@@ -0,0 +1,90 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "precompressed.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "common.h"
+
+typedef struct {
+    compress_encoding_t encoding;
+    const char *coding;     // Content-Encoding的值
+    const char *suffix;     // 预压缩文件的扩展名
+    size_t offset;          // location_conf_t中对应开关的偏移
+} precompressed_type_t;
+
+// 顺序配置中没有列出的编码按本表的顺序（压缩率从高到低）
+static const precompressed_type_t types[] = {
+    { COMPRESS_ENCODING_BR, "br", ".br", offsetof(location_conf_t, brotli_static) },
+    { COMPRESS_ENCODING_ZSTD, "zstd", ".zst", offsetof(location_conf_t, zstd_static) },
+    { COMPRESS_ENCODING_GZIP, "gzip", ".gz", offsetof(location_conf_t, gzip_static) },
+};
+
+#define TYPE_COUNT (sizeof(types) / sizeof(types[0]))
+
+static static_compress_t type_mode(const location_conf_t *lc, const precompressed_type_t *type) {
+    return *(const static_compress_t *)((const char *)lc + type->offset);
+}
+
+static const precompressed_type_t *find_type(compress_encoding_t encoding) {
+    for (size_t i = 0; i < TYPE_COUNT; i++) {
+        if (types[i].encoding == encoding) return &types[i];
+    }
+    return NULL;
+}
+
+open_file_t *precompressed_open(const location_conf_t *lc, const char *rel, const char *mime_type,
+                                const char *accept_encoding, size_t len, const char **encoding) {
+    size_t rel_len = strlen(rel);
+    char path[ANX_MAX_PATH_LENGTH];
+    if (rel_len + 5 > sizeof(path)) return NULL;
+    memcpy(path, rel, rel_len);
+
+    // 按客户端的q值从高到低尝试；always不看Accept-Encoding，按最低的正q值参与选择
+    // q值相同时与实时压缩一样按该类型的compress_order，顺序中没有列出的排在最后
+    size_t count = TYPE_COUNT;
+    int q[TYPE_COUNT];
+    int rank[TYPE_COUNT];
+    for (size_t i = 0; i < count; i++) {
+        rank[i] = compress_order_rank(lc->compress, mime_type, types[i].encoding);
+        if (rank[i] < 0) rank[i] = COMPRESS_ENCODING_COUNT;
+        static_compress_t mode = type_mode(lc, &types[i]);
+        q[i] = mode == STATIC_COMPRESS_OFF ? 0
+                                           : compress_accept_qvalue(accept_encoding, len,
+                                                                    types[i].coding);
+        if (mode == STATIC_COMPRESS_ALWAYS && q[i] <= 0) q[i] = 1;
+    }
+
+    for (;;) {
+        size_t best = count;
+        for (size_t i = 0; i < count; i++) {
+            if (q[i] > 0 && (best == count || q[i] > q[best] ||
+                             (q[i] == q[best] && rank[i] < rank[best]))) {
+                best = i;
+            }
+        }
+        if (best == count) break;
+        q[best] = 0;
+
+        strcpy(path + rel_len, types[best].suffix);
+        open_file_t *of = open_file_cache_open(lc, path);
+        if (of) {
+            *encoding = types[best].coding;
+            return of;
+        }
+    }
+    return NULL;
+}
+
+const char *precompressed_suffix(compress_encoding_t encoding) {
+    const precompressed_type_t *type = find_type(encoding);
+    return type ? type->suffix : NULL;
+}
+
+static_compress_t precompressed_mode(const location_conf_t *lc, compress_encoding_t encoding) {
+    const precompressed_type_t *type = find_type(encoding);
+    return type ? type_mode(lc, type) : STATIC_COMPRESS_OFF;
+}
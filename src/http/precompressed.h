@@ -0,0 +1,32 @@
+#ifndef PRECOMPRESSED_H
+#define PRECOMPRESSED_H
+
+#include <stddef.h>
+
+#include "compress.h"
+#include "location_conf.h"
+#include "open_file_cache.h"
+
+// 预压缩文件（gzip_static/brotli_static/zstd_static）
+// 原文件旁边存在file.br、file.zst或file.gz并且客户端接受对应编码时，直接发送该文件：
+// 与原文件一样经过打开文件缓存并用sendfile零拷贝发送，不消耗压缩的CPU；
+// 预压缩文件不存在时的查找失败也可由open_file_cache_errors缓存
+
+// location是否开启了任何预压缩文件，此时响应随Accept-Encoding变化，需要Vary头
+static inline int precompressed_enabled(const location_conf_t *lc) {
+    return lc->gzip_static || lc->brotli_static || lc->zstd_static;
+}
+
+// 为rel（原文件的相对路径）选择并打开预压缩文件，按客户端的q值从高到低尝试，
+// q值相同时按原文件类型mime_type的compress_order（与实时压缩的协商一致），
+// 顺序中没有列出的编码排在最后，之间按br、zstd、gzip
+// accept_encoding为请求的Accept-Encoding值（可以为NULL）
+// 成功时返回预压缩文件的引用（用open_file_cache_release归还）并设置*encoding，否则返回NULL
+open_file_t *precompressed_open(const location_conf_t *lc, const char *rel, const char *mime_type,
+                                const char *accept_encoding, size_t len, const char **encoding);
+
+// 编码对应的预压缩文件扩展名（".gz"、".br"、".zst"）和location中的开关，后台生成预压缩文件用
+const char *precompressed_suffix(compress_encoding_t encoding);
+static_compress_t precompressed_mode(const location_conf_t *lc, compress_encoding_t encoding);
+
+#endif // PRECOMPRESSED_H
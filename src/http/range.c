@@ -0,0 +1,182 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "range.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static const char *skip_ows(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+static int parse_offset(const char **p, const char *end, off_t *out) {
+    if (*p >= end || !is_digit(**p)) return -1;
+    int64_t n = 0;
+    while (*p < end && is_digit(**p)) {
+        int d = **p - '0';
+        if (n > (INT64_MAX - d) / 10) return -1;
+        n = n * 10 + d;
+        (*p)++;
+    }
+    *out = (off_t)n;
+    return 0;
+}
+
+int http_range_parse(const char *value, size_t len, off_t size, http_range_t *ranges, int max) {
+    const char *p = value;
+    const char *end = value + len;
+    if (len < 6 || strncasecmp(p, "bytes=", 6) != 0) return -1;
+    p += 6;
+
+    int specs = 0;
+    int count = 0;
+    off_t total = 0;
+    for (;;) {
+        p = skip_ows(p, end);
+        if (p < end && *p == ',') {
+            p++;
+            continue;
+        }
+        if (p >= end) break;
+
+        off_t start = 0, last = -1;
+        if (*p == '-') {
+            // "-N"：最后N个字节
+            p++;
+            off_t suffix;
+            if (parse_offset(&p, end, &suffix) < 0) return -1;
+            if (suffix == 0 || size == 0) goto next;
+            start = suffix >= size ? 0 : size - suffix;
+            last = size - 1;
+        } else {
+            if (parse_offset(&p, end, &start) < 0) return -1;
+            if (p >= end || *p != '-') return -1;
+            p++;
+            if (p < end && is_digit(*p)) {
+                if (parse_offset(&p, end, &last) < 0) return -1;
+                if (last < start) return -1;
+            }
+            if (start >= size) goto next;
+            if (last < 0 || last >= size) last = size - 1;
+        }
+
+        if (count == max) return -1;
+        ranges[count].start = start;
+        ranges[count].end = last;
+        count++;
+        total += last - start + 1;
+        if (total > size) return -1;
+
+    next:
+        specs++;
+        p = skip_ows(p, end);
+        if (p < end && *p != ',') return -1;
+    }
+    return specs > 0 ? count : -1;
+}
+
+int http_range_if_range(const char *value, size_t len, const char *etag, const char *last_modified) {
+    while (len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t')) len--;
+    if (len >= 2 && value[0] == '"') {
+        return etag && strlen(etag) == len && memcmp(etag, value, len) == 0;
+    }
+    if (len >= 2 && value[0] == 'W' && value[1] == '/') {
+        return 0;  // 弱实体标签不能用于If-Range
+    }
+    return last_modified && strlen(last_modified) == len && memcmp(last_modified, value, len) == 0;
+}
+
+void http_range_boundary(char *boundary, size_t size) {
+    static unsigned long counter = 0;
+    if (counter == 0) counter = ((unsigned long)time(NULL) << 16) ^ (unsigned long)getpid();
+    snprintf(boundary, size, "%020lu", counter++);
+}
+
+static int format_prefix(char *buf, size_t size, const http_range_t *range, off_t total,
+                         const char *mime, const char *boundary) {
+    return snprintf(buf, size,
+                    "\r\n--%s\r\n"
+                    "Content-Type: %s\r\n"
+                    "Content-Range: bytes %lld-%lld/%lld\r\n\r\n",
+                    boundary, mime, (long long)range->start, (long long)range->end,
+                    (long long)total);
+}
+
+static int format_trailer(char *buf, size_t size, const char *boundary) {
+    return snprintf(buf, size, "\r\n--%s--\r\n", boundary);
+}
+
+http_response_parts_t *http_range_file_parts(const http_range_t *ranges, int count, off_t size,
+                                             const char *mime, const char *boundary,
+                                             off_t *body_len) {
+    size_t text_len = (size_t)format_trailer(NULL, 0, boundary);
+    for (int i = 0; i < count; i++) {
+        text_len += (size_t)format_prefix(NULL, 0, &ranges[i], size, mime, boundary);
+    }
+
+    size_t parts_size = sizeof(http_response_parts_t) + (count + 1) * sizeof(http_response_part_t);
+    http_response_parts_t *parts = malloc(parts_size + text_len + 1);
+    if (!parts) return NULL;
+    parts->count = count + 1;
+    parts->next = 0;
+    parts->text = (char *)parts + parts_size;
+
+    size_t off = 0;
+    off_t total = 0;
+    for (int i = 0; i < count; i++) {
+        http_response_part_t *part = &parts->parts[i];
+        part->prefix_off = off;
+        part->prefix_len = (size_t)format_prefix(parts->text + off, text_len + 1 - off,
+                                                 &ranges[i], size, mime, boundary);
+        part->offset = ranges[i].start;
+        part->len = (size_t)(ranges[i].end - ranges[i].start + 1);
+        off += part->prefix_len;
+        total += (off_t)(part->prefix_len + part->len);
+    }
+    http_response_part_t *trailer = &parts->parts[count];
+    trailer->prefix_off = off;
+    trailer->prefix_len = (size_t)format_trailer(parts->text + off, text_len + 1 - off, boundary);
+    trailer->offset = 0;
+    trailer->len = 0;
+    total += (off_t)trailer->prefix_len;
+
+    *body_len = total;
+    return parts;
+}
+
+char *http_range_multipart_body(const char *content, const http_range_t *ranges, int count,
+                                off_t size, const char *mime, const char *boundary,
+                                size_t *body_len) {
+    size_t total = (size_t)format_trailer(NULL, 0, boundary);
+    for (int i = 0; i < count; i++) {
+        total += (size_t)format_prefix(NULL, 0, &ranges[i], size, mime, boundary);
+        total += (size_t)(ranges[i].end - ranges[i].start + 1);
+    }
+
+    char *body = malloc(total + 1);
+    if (!body) return NULL;
+
+    size_t off = 0;
+    for (int i = 0; i < count; i++) {
+        off += (size_t)format_prefix(body + off, total + 1 - off, &ranges[i], size, mime, boundary);
+        size_t n = (size_t)(ranges[i].end - ranges[i].start + 1);
+        memcpy(body + off, content + ranges[i].start, n);
+        off += n;
+    }
+    off += (size_t)format_trailer(body + off, total + 1 - off, boundary);
+
+    *body_len = off;
+    return body;
+}
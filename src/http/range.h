@@ -0,0 +1,54 @@
+#ifndef RANGE_H
+#define RANGE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "connection.h"
+
+// HTTP字节区间（RFC 7233）：Range/If-Range解析与multipart/byteranges响应体
+// 文件响应的各部分作为http_response_parts_t交给连接状态机，区间数据仍走sendfile/splice；
+// 内存中的响应体（缓存命中）直接按区间切片
+
+#define HTTP_RANGE_MAX 16              // 超过该数量的区间时忽略Range，发送完整内容
+#define HTTP_RANGE_BOUNDARY_SIZE 24
+
+typedef struct {
+    off_t start;
+    off_t end;                         // 包含在内
+} http_range_t;
+
+// 静态文件响应的原因短语，HTTP与HTTPS共用，206/416与区间处理配套
+static inline const char *status_reason(int status_code) {
+    switch (status_code) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 404: return "Not Found";
+    case 416: return "Range Not Satisfiable";
+    default: return "Internal Server Error";
+    }
+}
+
+// 解析Range头（"bytes=0-99,200-,-500"），size为完整内容的长度
+// 返回可满足的区间数（>0）；0表示都不可满足（416）；
+// -1表示忽略Range：格式错误、不是bytes单位、区间过多或总长度超过内容本身（重叠区间）
+int http_range_parse(const char *value, size_t len, off_t size, http_range_t *ranges, int max);
+
+// If-Range与当前表示一致时返回1（Range有效），否则返回0（发送完整内容）
+// 实体标签按强比较，日期须与Last-Modified完全相同；etag或last_modified可以为NULL
+int http_range_if_range(const char *value, size_t len, const char *etag, const char *last_modified);
+
+// 生成multipart的分隔符，每次调用都不同
+void http_range_boundary(char *boundary, size_t size);
+
+// 为文件区间生成multipart各部分（最后一部分为结尾分隔行），*body_len为响应体总长度
+http_response_parts_t *http_range_file_parts(const http_range_t *ranges, int count, off_t size,
+                                             const char *mime, const char *boundary,
+                                             off_t *body_len);
+
+// 把内存内容中的区间组装成完整的multipart响应体，返回的内存由调用者释放
+char *http_range_multipart_body(const char *content, const http_range_t *ranges, int count,
+                                off_t size, const char *mime, const char *boundary,
+                                size_t *body_len);
+
+#endif // RANGE_H
@@ -0,0 +1,675 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "warmup.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "compress.h"
+#include "log.h"
+#include "open_file_cache.h"
+#include "precompressed.h"
+#include "timer.h"
+#include "util.h"
+
+#define WARMUP_MAX_DEPTH 32         // 目录的最大嵌套深度
+#define WARMUP_MAX_FILES 100000     // 一轮扫描最多收集的文件数
+#define WARMUP_MAX_THREADS 64
+
+typedef struct {
+    const location_conf_t *lc;      // 按URI查找到的location
+    char *rel;                      // URI路径，以'/'开头
+    off_t size;
+    unsigned encodings;             // 预压缩：需要生成的编码（按compress_encoding_t的位）
+} warmup_file_t;
+
+typedef struct {
+    warmup_file_t *files;
+    size_t count;
+    size_t cap;
+} warmup_list_t;
+
+// 一种遍历任务：扫描时筛选location和文件，再由线程池逐个处理
+typedef struct {
+    int (*want_location)(const location_conf_t *lc);
+    // 返回0表示跳过，否则保存到warmup_file_t的encodings
+    unsigned (*want_file)(const location_conf_t *lc, const char *rel, const struct stat *st);
+    // 返回1表示已处理，0表示跳过，-1表示失败
+    int (*process)(const warmup_file_t *file);
+} warmup_task_t;
+
+typedef struct {
+    const warmup_task_t *task;
+    const route_table_t *rt;
+    int server;
+    const char *root;
+    warmup_list_t *list;
+    char path[ANX_MAX_PATH_LENGTH];  // 当前文件相对root的路径，即URI
+} warmup_scan_t;
+
+typedef struct {
+    const warmup_task_t *task;
+    const char **roots;
+    int count;
+    int cap;
+} warmup_roots_t;
+
+typedef struct {
+    const warmup_task_t *task;
+    const warmup_list_t *list;
+    size_t next;
+    size_t done;
+    size_t failed;
+    pthread_mutex_t lock;
+} warmup_pool_t;
+
+static core_config_t *warmup_conf;
+static volatile sig_atomic_t warmup_stopping;
+static uint64_t warmup_deadline;    // 缓存预热的截止时间（单调时钟，毫秒），0表示不限
+
+static pthread_t precompress_thread;
+static int precompress_running;
+static pthread_mutex_t stop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stop_cond = PTHREAD_COND_INITIALIZER;
+
+// 缓存预热的剩余容量
+static pthread_mutex_t budget_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t budget_bytes;
+static size_t budget_entries;
+static size_t warmed_bytes;
+
+// 收到停止信号或缓存预热超过cache_warmup_timeout时中断扫描和处理
+static int warmup_interrupted(void) {
+    return warmup_stopping || (warmup_deadline && timer_now_ms() >= warmup_deadline);
+}
+
+static int list_add(warmup_list_t *list, const location_conf_t *lc, const char *rel, off_t size,
+                    unsigned encodings) {
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        warmup_file_t *files = realloc(list->files, cap * sizeof(warmup_file_t));
+        if (!files) return -1;
+        list->files = files;
+        list->cap = cap;
+    }
+    char *copy = strdup(rel);
+    if (!copy) return -1;
+    warmup_file_t *file = &list->files[list->count++];
+    file->lc = lc;
+    file->rel = copy;
+    file->size = size;
+    file->encodings = encodings;
+    return 0;
+}
+
+static void list_free(warmup_list_t *list) {
+    for (size_t i = 0; i < list->count; i++) free(list->files[i].rel);
+    free(list->files);
+    memset(list, 0, sizeof(*list));
+}
+
+// 预压缩文件本身不作为原文件处理
+static int is_sidecar(const char *name, size_t len) {
+    for (int e = 0; e < COMPRESS_ENCODING_COUNT; e++) {
+        const char *suffix = precompressed_suffix((compress_encoding_t)e);
+        size_t n = strlen(suffix);
+        if (len > n && strcmp(name + len - n, suffix) == 0) return 1;
+    }
+    return 0;
+}
+
+// root之后接rel和suffix的完整路径，过长时返回-1
+static int file_path(const location_conf_t *lc, const char *rel, const char *suffix,
+                     char *buf, size_t size) {
+    int n = snprintf(buf, size, "%s%s%s", lc->root, rel, suffix);
+    return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+static void scan_file(warmup_scan_t *scan, const struct stat *st) {
+    route_t route = route_table_lookup_server(scan->rt, scan->server, scan->path);
+    const location_conf_t *lc = route.conf;
+    if (!lc || !lc->root || strcmp(lc->root, scan->root) != 0 || !scan->task->want_location(lc)) {
+        return;
+    }
+    unsigned encodings = scan->task->want_file(lc, scan->path, st);
+    if (encodings) list_add(scan->list, lc, scan->path, st->st_size, encodings);
+}
+
+// 递归遍历目录，fd由本函数关闭；scan->path[0..len)为目录对应的URI
+static void walk_dir(warmup_scan_t *scan, int fd, size_t len, int depth) {
+    DIR *dir = fdopendir(fd);
+    if (!dir) {
+        close(fd);
+        return;
+    }
+
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL && scan->list->count < WARMUP_MAX_FILES && !warmup_interrupted()) {
+        // 跳过隐藏文件（包括正在写入的预压缩临时文件）、"."和".."；带'?'的名称无法作为URI请求
+        if (de->d_name[0] == '.' || strchr(de->d_name, '?')) continue;
+        size_t name_len = strlen(de->d_name);
+        if (len + 1 + name_len >= sizeof(scan->path)) continue;
+
+        struct stat st;
+        if (fstatat(dirfd(dir), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) continue;
+        scan->path[len] = '/';
+        memcpy(scan->path + len + 1, de->d_name, name_len + 1);
+
+        if (S_ISDIR(st.st_mode)) {
+            if (depth >= WARMUP_MAX_DEPTH) continue;
+            int sub = openat(dirfd(dir), de->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (sub >= 0) walk_dir(scan, sub, len + 1 + name_len, depth + 1);
+        } else if (S_ISREG(st.st_mode) && !is_sidecar(de->d_name, name_len)) {
+            scan_file(scan, &st);
+        }
+    }
+    scan->path[len] = '\0';
+    closedir(dir);
+}
+
+static void add_root(const location_conf_t *lc, void *arg) {
+    warmup_roots_t *roots = arg;
+    if (!lc->root || !roots->task->want_location(lc)) return;
+    for (int i = 0; i < roots->count; i++) {
+        if (strcmp(roots->roots[i], lc->root) == 0) return;
+    }
+    if (roots->count == roots->cap) {
+        int cap = roots->cap ? roots->cap * 2 : 8;
+        const char **list = realloc(roots->roots, cap * sizeof(char *));
+        if (!list) return;
+        roots->roots = list;
+        roots->cap = cap;
+    }
+    roots->roots[roots->count++] = lc->root;
+}
+
+// 收集所有server中task关心的文件；多个location共用的root只遍历一次
+static void scan_roots(const warmup_task_t *task, warmup_list_t *list) {
+    const route_table_t *rt = warmup_conf->routes;
+    int servers = route_table_server_count(rt);
+
+    for (int i = 0; i < servers && !warmup_interrupted(); i++) {
+        warmup_roots_t roots = { task, NULL, 0, 0 };
+        route_table_foreach_conf(rt, i, add_root, &roots);
+
+        for (int j = 0; j < roots.count && !warmup_interrupted(); j++) {
+            int fd = open(roots.roots[j], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0) continue;
+            warmup_scan_t *scan = malloc(sizeof(warmup_scan_t));
+            if (!scan) {
+                close(fd);
+                continue;
+            }
+            scan->task = task;
+            scan->rt = rt;
+            scan->server = i;
+            scan->root = roots.roots[j];
+            scan->list = list;
+            scan->path[0] = '\0';
+            walk_dir(scan, fd, 0, 0);
+            free(scan);
+        }
+        free(roots.roots);
+    }
+
+    if (list->count >= WARMUP_MAX_FILES) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Warm-up scan stopped at %d files", WARMUP_MAX_FILES);
+        log_message(LOG_LEVEL_WARNING, msg);
+    }
+}
+
+static void *pool_thread(void *arg) {
+    warmup_pool_t *pool = arg;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        size_t i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->list->count || warmup_interrupted()) break;
+
+        int rc = pool->task->process(&pool->list->files[i]);
+        pthread_mutex_lock(&pool->lock);
+        if (rc > 0) pool->done++;
+        if (rc < 0) pool->failed++;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+// 用最多threads个线程处理list中的文件，全部完成后返回已处理的文件数；
+// 新线程继承调用线程的调度策略和nice值
+static size_t run_pool(const warmup_task_t *task, const warmup_list_t *list, int threads,
+                       size_t *failed) {
+    warmup_pool_t pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.task = task;
+    pool.list = list;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_t tids[WARMUP_MAX_THREADS];
+    int started = 0;
+
+    if (threads > WARMUP_MAX_THREADS) threads = WARMUP_MAX_THREADS;
+    if ((size_t)threads > list->count) threads = (int)list->count;
+    while (started < threads && pthread_create(&tids[started], NULL, pool_thread, &pool) == 0) {
+        started++;
+    }
+    if (started == 0) pool_thread(&pool);
+    for (int i = 0; i < started; i++) pthread_join(tids[i], NULL);
+
+    pthread_mutex_destroy(&pool.lock);
+    if (failed) *failed = pool.failed;
+    return pool.done;
+}
+
+// 把fd中size字节按压缩缓冲区分块压缩，每段输出交给emit；停止或预热超时时返回-1
+static int compress_file(compress_context_t *ctx, int fd, off_t size,
+                         int (*emit)(void *arg, const void *data, size_t len), void *arg) {
+    off_t offset = 0;
+    size_t in_pos = 0;
+    size_t in_len = 0;
+    int eof = size == 0;
+
+    for (;;) {
+        if (warmup_interrupted()) return -1;
+        if (in_pos == in_len && !eof) {
+            size_t want = ctx->buffer_size;
+            if ((off_t)want > size - offset) want = (size_t)(size - offset);
+            ssize_t n = pread(fd, ctx->in_buffer, want, offset);
+            if (n <= 0) return -1;
+            offset += n;
+            in_pos = 0;
+            in_len = (size_t)n;
+            eof = offset >= size;
+        }
+
+        size_t avail = in_len - in_pos;
+        size_t out_len = ctx->buffer_size;
+        int ret = compress_data(ctx, ctx->in_buffer + in_pos, avail, ctx->out_buffer, &out_len,
+                                eof ? Z_FINISH : Z_NO_FLUSH);
+        if (ret < 0) return -1;
+        in_pos += avail - ctx->avail_in;
+        if (out_len > 0 && emit(arg, ctx->out_buffer, out_len) < 0) return -1;
+        if (ret == Z_STREAM_END) return 0;
+    }
+}
+
+static int emit_fd(void *arg, const void *data, size_t len) {
+    int fd = *(int *)arg;
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} warmup_buffer_t;
+
+// 压缩结果不比原文件小时放弃，这样的表示形式不值得占用缓存
+static int emit_buffer(void *arg, const void *data, size_t len) {
+    warmup_buffer_t *buf = arg;
+    if (buf->len + len > buf->cap) return -1;
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+// ---- 后台预压缩 ----
+
+// gzip关闭的location也可以发送预压缩文件，此时按http级的压缩配置判断类型和级别
+static compress_config_t *precompress_config(const location_conf_t *lc) {
+    return lc->compress ? lc->compress : warmup_conf->raw_config->compress;
+}
+
+static int precompress_encoding(const location_conf_t *lc, compress_encoding_t encoding) {
+    return precompressed_mode(lc, encoding) != STATIC_COMPRESS_OFF &&
+           compress_encoding_supported(encoding);
+}
+
+static int precompress_want_location(const location_conf_t *lc) {
+    for (int e = 0; e < COMPRESS_ENCODING_COUNT; e++) {
+        if (precompress_encoding(lc, (compress_encoding_t)e)) return 1;
+    }
+    return 0;
+}
+
+static int timespec_before(const struct timespec *a, const struct timespec *b) {
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+// 预压缩文件不存在或比原文件旧的编码；不比原文件旧的（包括构建流程生成的）保持不动
+static unsigned precompress_want_file(const location_conf_t *lc, const char *rel,
+                                      const struct stat *st) {
+    compress_config_t *config = precompress_config(lc);
+    if (!config || (size_t)st->st_size < config->min_length ||
+        !should_compress_mime_type(config, get_mime_type(rel))) {
+        return 0;
+    }
+
+    unsigned encodings = 0;
+    for (int e = 0; e < COMPRESS_ENCODING_COUNT; e++) {
+        if (!precompress_encoding(lc, (compress_encoding_t)e)) continue;
+        char path[ANX_MAX_PATH_LENGTH];
+        struct stat sst;
+        if (file_path(lc, rel, precompressed_suffix((compress_encoding_t)e), path, sizeof(path)) < 0) {
+            continue;
+        }
+        if (stat(path, &sst) == 0 && !timespec_before(&sst.st_mtim, &st->st_mtim)) continue;
+        encodings |= 1u << e;
+    }
+    return encodings;
+}
+
+// 压缩到同目录的临时文件，修改时间设为与原文件相同后rename，请求不会读到写了一半的文件
+static int write_sidecar(compress_config_t *config, compress_encoding_t encoding, int fd,
+                         const struct stat *st, const char *path) {
+    const char *suffix = precompressed_suffix(encoding);
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    char target[ANX_MAX_PATH_LENGTH];
+    char tmp[ANX_MAX_PATH_LENGTH];
+    int n = snprintf(target, sizeof(target), "%s%s", path, suffix);
+    if (n < 0 || (size_t)n >= sizeof(target)) return -1;
+    n = snprintf(tmp, sizeof(tmp), "%.*s.%s%s.XXXXXX", (int)(name - path), path, name, suffix);
+    if (n < 0 || (size_t)n >= sizeof(tmp)) return -1;
+
+    compress_context_t *ctx = compress_context_create(config, encoding,
+                                                      config->offline_levels[encoding],
+                                                      (size_t)st->st_size);
+    if (!ctx) return -1;
+    int out = mkostemp(tmp, O_CLOEXEC);
+    if (out < 0) {
+        compress_context_free(ctx);
+        return -1;
+    }
+
+    // 时间精确到纳秒与原文件相同，下一轮扫描据此判断预压缩文件是否过期
+    struct timespec times[2] = { { 0, UTIME_OMIT }, st->st_mtim };
+    int rc = compress_file(ctx, fd, st->st_size, emit_fd, &out);
+    if (rc == 0 && (fchmod(out, st->st_mode & 0666) < 0 || futimens(out, times) < 0)) rc = -1;
+    if (close(out) < 0) rc = -1;
+    if (rc == 0 && rename(tmp, target) < 0) rc = -1;
+    if (rc < 0) unlink(tmp);
+    compress_context_free(ctx);
+    return rc;
+}
+
+static int precompress_file(const warmup_file_t *file) {
+    char path[ANX_MAX_PATH_LENGTH];
+    if (file_path(file->lc, file->rel, "", path, sizeof(path)) < 0) return -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;   // 扫描之后被删除
+
+    struct stat st;
+    int rc = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? 0 : -1;
+    compress_config_t *config = precompress_config(file->lc);
+    for (int e = 0; rc == 0 && e < COMPRESS_ENCODING_COUNT; e++) {
+        if (file->encodings & (1u << e)) rc = write_sidecar(config, (compress_encoding_t)e, fd, &st, path);
+    }
+    close(fd);
+
+    if (rc < 0 && warmup_stopping) return 0;   // 停止时中断，不算失败
+    if (rc < 0) {
+        char msg[ANX_MAX_PATH_LENGTH + 64];
+        snprintf(msg, sizeof(msg), "Failed to precompress %s", path);
+        log_message(LOG_LEVEL_DEBUG, msg);
+    }
+    return rc < 0 ? -1 : 1;
+}
+
+static const warmup_task_t precompress_task = {
+    precompress_want_location, precompress_want_file, precompress_file
+};
+
+static void precompress_scan(void) {
+    warmup_list_t list = { NULL, 0, 0 };
+    scan_roots(&precompress_task, &list);
+
+    size_t failed = 0;
+    size_t done = run_pool(&precompress_task, &list, warmup_conf->precompress_threads, &failed);
+    if (done > 0 || failed > 0) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Precompressed %zu files, %zu failed", done, failed);
+        log_message(failed > 0 ? LOG_LEVEL_WARNING : LOG_LEVEL_INFO, msg);
+    }
+    list_free(&list);
+}
+
+// 后台线程只使用空闲的CPU，不与worker争抢；SCHED_IDLE不可用时把nice值调到最低
+static void lower_priority(void) {
+    struct sched_param param = { 0 };
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0) {
+        setpriority(PRIO_PROCESS, 0, 19);
+    }
+}
+
+static void *precompress_main(void *arg) {
+    (void)arg;
+    lower_priority();
+
+    for (;;) {
+        precompress_scan();
+        if (warmup_conf->precompress_interval <= 0) break;
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += warmup_conf->precompress_interval / 1000;
+        deadline.tv_nsec += (long)(warmup_conf->precompress_interval % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        int rc = 0;
+        pthread_mutex_lock(&stop_lock);
+        while (!warmup_stopping && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&stop_cond, &stop_lock, &deadline);
+        }
+        pthread_mutex_unlock(&stop_lock);
+        if (warmup_stopping) break;
+    }
+    return NULL;
+}
+
+int warmup_start(core_config_t *core_conf) {
+    if (!core_conf || !core_conf->precompress || precompress_running) return 0;
+    // 启动过程中已收到停止信号时不再启动
+    if (warmup_stopping) return 0;
+    warmup_conf = core_conf;
+
+    // 后台线程不接收SIGINT/SIGTERM，由主线程的信号处理和wait()负责退出
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    int rc = pthread_create(&precompress_thread, NULL, precompress_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (rc != 0) {
+        log_message(LOG_LEVEL_ERROR, "Failed to start precompress thread");
+        return -1;
+    }
+    precompress_running = 1;
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Background precompression started with %d threads",
+             core_conf->precompress_threads);
+    log_message(LOG_LEVEL_INFO, msg);
+    return 0;
+}
+
+void warmup_stop(void) {
+    if (!precompress_running) return;
+    pthread_mutex_lock(&stop_lock);
+    warmup_stopping = 1;
+    pthread_cond_signal(&stop_cond);
+    pthread_mutex_unlock(&stop_lock);
+    pthread_join(precompress_thread, NULL);
+    precompress_running = 0;
+}
+
+// ---- 缓存预热 ----
+
+static int budget_reserve(size_t bytes, size_t entries) {
+    pthread_mutex_lock(&budget_lock);
+    int ok = bytes <= budget_bytes && entries <= budget_entries;
+    if (ok) {
+        budget_bytes -= bytes;
+        budget_entries -= entries;
+        warmed_bytes += bytes;
+    }
+    pthread_mutex_unlock(&budget_lock);
+    return ok;
+}
+
+static void budget_release(size_t bytes, size_t entries) {
+    pthread_mutex_lock(&budget_lock);
+    budget_bytes += bytes;
+    budget_entries += entries;
+    warmed_bytes -= bytes;
+    pthread_mutex_unlock(&budget_lock);
+}
+
+// 开启预压缩文件的location不使用响应缓存（见https.c）
+static int warm_want_location(const location_conf_t *lc) {
+    return lc->cache && !precompressed_enabled(lc);
+}
+
+static unsigned warm_want_file(const location_conf_t *lc, const char *rel, const struct stat *st) {
+    return st->st_size > 0 &&
+           cache_config_is_cacheable(lc->cache, get_mime_type(rel), (size_t)st->st_size);
+}
+
+// 按离线级别压缩并存入缓存，只生成请求时可能协商出的编码（compress_order可能排除某些编码）
+static void warm_variant(compress_config_t *config, compress_encoding_t encoding, int fd,
+                         const struct stat *st, const char *rel, const char *mime,
+                         const char *etag) {
+    const char *name = compress_encoding_name(encoding);
+    if (compress_negotiate(config, mime, name, strlen(name)) != encoding) return;
+
+    compress_context_t *ctx = compress_context_create(
+        config, encoding, compress_level(config, encoding, COMPRESS_PROFILE_OFFLINE),
+        (size_t)st->st_size);
+    warmup_buffer_t buf = { malloc((size_t)st->st_size), 0, (size_t)st->st_size };
+    if (ctx && buf.data && compress_file(ctx, fd, st->st_size, emit_buffer, &buf) == 0 &&
+        budget_reserve(buf.len, 0)) {
+        // 表示形式与编码一一对应（见cache_variant_t）；存入失败时归还预留的容量
+        if (cache_put(warmup_conf->cache_manager, rel, (cache_variant_t)(encoding + 1), buf.data,
+                      buf.len, mime, etag, st->st_mtime, 0) != 0) {
+            budget_release(buf.len, 0);
+        }
+    }
+    free(buf.data);
+    compress_context_free(ctx);
+}
+
+static int warm_file(const warmup_file_t *file) {
+    const location_conf_t *lc = file->lc;
+    struct stat st;
+    int fd = location_conf_open_file(lc, file->rel, &st);
+    if (fd < 0) return 0;
+
+    size_t size = (size_t)st.st_size;
+    const char *mime = get_mime_type(file->rel);
+    // 与打开文件缓存的ETag相同，请求的条件判断和缓存命中使用同一个值
+    char etag[OPEN_FILE_ETAG_SIZE];
+    snprintf(etag, sizeof(etag), "\"%lx-%llx\"",
+             (unsigned long)st.st_mtime, (unsigned long long)st.st_size);
+
+    // 文件按从小到大处理，容量用完后其余文件都放不下
+    if (!budget_reserve(size, 1)) {
+        close(fd);
+        return 0;
+    }
+    int rc = -1;
+    char *content = malloc(size);
+    if (content && pread(fd, content, size, 0) == (ssize_t)size &&
+        cache_put(warmup_conf->cache_manager, file->rel, CACHE_VARIANT_IDENTITY, content, size,
+                  mime, etag, st.st_mtime, 0) == 0) {
+        rc = 1;
+    } else {
+        budget_release(size, 1);
+    }
+    free(content);
+
+    compress_config_t *config = lc->compress;
+    if (rc > 0 && config && size >= config->min_length && should_compress_mime_type(config, mime)) {
+        for (int e = 0; e < COMPRESS_ENCODING_COUNT; e++) {
+            warm_variant(config, (compress_encoding_t)e, fd, &st, file->rel, mime, etag);
+        }
+    }
+    close(fd);
+    return rc;
+}
+
+static const warmup_task_t warm_task = { warm_want_location, warm_want_file, warm_file };
+
+static int compare_size(const void *a, const void *b) {
+    const warmup_file_t *fa = a;
+    const warmup_file_t *fb = b;
+    return (fa->size > fb->size) - (fa->size < fb->size);
+}
+
+void warmup_cancel(void) {
+    warmup_stopping = 1;
+}
+
+int warmup_fill_cache(core_config_t *core_conf) {
+    if (!core_conf || !core_conf->cache_warmup || !core_conf->cache_manager) return 0;
+    warmup_conf = core_conf;
+
+    cache_stats_t *stats = cache_get_stats(core_conf->cache_manager);
+    if (!stats) return 0;
+    cache_config_t *config = core_conf->cache_manager->config;
+    budget_bytes = config->max_size > stats->current_size ? config->max_size - stats->current_size : 0;
+    budget_entries = config->max_entries > stats->current_entries
+                         ? config->max_entries - stats->current_entries : 0;
+    warmed_bytes = 0;
+    free(stats);
+
+    warmup_deadline = core_conf->cache_warmup_timeout > 0
+                          ? timer_now_ms() + (uint64_t)core_conf->cache_warmup_timeout : 0;
+
+    warmup_list_t list = { NULL, 0, 0 };
+    scan_roots(&warm_task, &list);
+    if (list.count > 1) qsort(list.files, list.count, sizeof(warmup_file_t), compare_size);
+
+    size_t done = run_pool(&warm_task, &list, core_conf->precompress_threads, NULL);
+    size_t count = list.count;
+    int timed_out = !warmup_stopping && done < count && warmup_interrupted();
+    warmup_deadline = 0;
+    list_free(&list);
+
+    if (warmup_stopping) {
+        log_message(LOG_LEVEL_INFO, "Cache warm-up interrupted by signal");
+        return -1;
+    }
+    char msg[160];
+    snprintf(msg, sizeof(msg), "Cache warm-up: %zu of %zu files, %zu bytes%s", done, count,
+             warmed_bytes, timed_out ? " (cache_warmup_timeout reached)" : "");
+    log_message(timed_out ? LOG_LEVEL_WARNING : LOG_LEVEL_INFO, msg);
+    return 0;
+}
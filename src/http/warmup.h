@@ -0,0 +1,34 @@
+#ifndef WARMUP_H
+#define WARMUP_H
+
+#include "core.h"
+
+// 启动时遍历各server的文档根目录，减少部署后冷启动时首个请求的压缩和磁盘读取
+// - 缓存预热（cache_warmup on）：fork worker之前把开启proxy_cache的location下的可缓存文件
+//   按从小到大读入响应缓存，可压缩的同时按离线级别生成各编码的表示形式，直到缓存的
+//   max_size/max_entries；worker继承填好的缓存（写时复制），首个请求即命中。
+//   启动时没有访问记录，以文件大小近似热度：同样的内存装下的文件最多
+// - 后台预压缩（precompress on）：fork worker之后由主进程的低优先级（SCHED_IDLE）线程池
+//   为开启gzip_static/brotli_static/zstd_static的location生成缺少或比原文件旧的.gz/.br/.zst，
+//   先写临时文件再rename，修改时间与原文件相同；每隔precompress_interval重新扫描，
+//   文件修改后由下一轮扫描重新生成
+// 只处理普通文件，不跟随符号链接，跳过以'.'开头的文件和目录；
+// 文件按"root之后的路径"作为URI查找location，只处理location的root与所在root相同的文件
+
+// 在主进程fork worker之前调用，cache_warmup关闭时什么也不做；
+// 超过cache_warmup_timeout时停止预热，已装入的内容保留
+// 成功或超时返回0，预热期间收到停止信号（见warmup_cancel）返回-1，调用方应放弃启动
+int warmup_fill_cache(core_config_t *core_conf);
+
+// 在SIGINT/SIGTERM的信号处理函数中调用（异步信号安全）：中断正在进行的缓存预热，
+// 之后的warmup_start不再启动后台线程，运行中的后台预压缩尽快结束
+void warmup_cancel(void);
+
+// 在主进程fork完所有worker之后调用，启动后台预压缩线程；precompress关闭时返回0
+// 成功返回0，线程创建失败返回-1
+int warmup_start(core_config_t *core_conf);
+
+// 通知后台线程停止并等待其退出，在主进程释放配置之前调用
+void warmup_stop(void);
+
+#endif // WARMUP_H
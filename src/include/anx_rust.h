@@ -30,6 +30,9 @@ typedef struct CliParser CliParser;
 /// Opaque handle for CLI config
 typedef struct CliConfigHandle CliConfigHandle;
 
+/// Opaque handle for the compiled regex locations of one server
+typedef struct LocationRegexHandle LocationRegexHandle;
+
 /// Cache response structure
 typedef struct {
     uint8_t *data;
@@ -52,6 +55,39 @@ typedef struct {
     double hit_rate;
 } CacheStatsC;
 
+/// Byte range (offset, length) into a caller-owned request buffer
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+} AnxByteRange;
+
+/// Header name and value ranges
+typedef struct {
+    AnxByteRange name;
+    AnxByteRange value;
+} AnxHeaderRange;
+
+#define ANX_RUST_MAX_HEADERS 64
+
+/// AnxRequestRanges.flags: Content-Length present / Transfer-Encoding present
+#define ANX_RUST_REQ_CONTENT_LENGTH 0x1
+#define ANX_RUST_REQ_CHUNKED        0x2
+
+/// Borrowed parse result; every range points into the parsed buffer
+typedef struct {
+    AnxByteRange method;
+    AnxByteRange uri;
+    AnxByteRange path;
+    AnxByteRange query;
+    AnxByteRange version;
+    uint64_t content_length;
+    uint32_t version_minor;
+    uint32_t header_count;
+    uint32_t header_len;
+    uint32_t flags;
+    AnxHeaderRange headers[ANX_RUST_MAX_HEADERS];
+} AnxRequestRanges;
+
 // =============================================================================
 // Configuration Functions
 // =============================================================================
@@ -114,6 +150,14 @@ int anx_http_is_keep_alive(const HttpRequestHandle *handle);
 /// Free HTTP request handle
 void anx_http_request_free(HttpRequestHandle *handle);
 
+/// Parse request line and headers into ranges over data without allocating
+/// Returns 0 when complete, -2 when more data is needed, -1 on a malformed request
+int anx_http_parse_borrowed(const uint8_t *data, size_t len, AnxRequestRanges *out);
+
+/// Case-insensitive header lookup on a borrowed parse result; returns 1 and fills value when found
+int anx_http_find_header(const uint8_t *data, size_t len, const AnxRequestRanges *ranges,
+                         const uint8_t *name, size_t name_len, AnxByteRange *value);
+
 /// Create HTTP response
 HttpResponseHandle* anx_http_response_new(unsigned int status_code, const char *reason_phrase);
 
@@ -129,6 +173,23 @@ uint8_t* anx_http_response_to_bytes(const HttpResponseHandle *handle, size_t *le
 /// Free HTTP response handle
 void anx_http_response_free(HttpResponseHandle *handle);
 
+// =============================================================================
+// Location Regex Functions
+// =============================================================================
+
+/// Compile regex locations (in configuration order) into one matcher;
+/// case_insensitive[i] is non-zero for `location ~*` patterns.
+/// Returns NULL on an invalid pattern, storing its index in err_index and the message in err_buf
+LocationRegexHandle* anx_location_regex_new(const char *const *patterns, const int *case_insensitive,
+                                            size_t count, int *err_index,
+                                            char *err_buf, size_t err_len);
+
+/// Index of the first pattern matching path, or -1
+int anx_location_regex_match(const LocationRegexHandle *handle, const uint8_t *path, size_t len);
+
+/// Free location regex handle
+void anx_location_regex_free(LocationRegexHandle *handle);
+
 // =============================================================================
 // Cache Functions
 // =============================================================================
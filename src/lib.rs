@@ -12,6 +12,7 @@ pub mod rust_modules {
 pub mod http_parser;
 pub mod cache;
 pub mod cli;
+pub mod location_regex;
 pub mod ffi;
 }
 
@@ -19,6 +20,7 @@ pub mod ffi;
 pub use rust_modules::config;
 pub use rust_modules::http_parser;
 pub use rust_modules::cache;
+pub use rust_modules::location_regex;
 pub use rust_modules::ffi;
 
 // Re-export commonly used types
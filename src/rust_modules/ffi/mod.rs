@@ -8,9 +8,10 @@ use std::ptr;
 use std::time::UNIX_EPOCH;
 
 use super::config::AnxConfig;
-use super::http_parser::{HttpRequest, HttpResponse};
+use super::http_parser::{HttpRequest, HttpResponse, ByteRange, ParseStatus, RequestRanges};
 use super::cache::{Cache, CacheConfig, CacheStrategy};
 use super::cli::{CliConfig, CliParser};
+use super::location_regex::{LocationPattern, LocationRegexError, LocationRegexSet};
 
 /// C-compatible configuration handle
 pub struct ConfigHandle {
@@ -37,6 +38,11 @@ pub struct CliConfigHandle {
     config: Box<CliConfig>,
 }
 
+/// C-compatible handle for the compiled regex locations of one server
+pub struct LocationRegexHandle {
+    set: Box<LocationRegexSet>,
+}
+
 /// C-compatible cache response
 #[repr(C)]
 pub struct CacheResponseC {
@@ -362,6 +368,49 @@ pub extern "C" fn anx_http_request_free(handle: *mut HttpRequestHandle) {
     }
 }
 
+/// Parse request line and headers into byte ranges over `data` without allocating.
+/// Returns 0 when complete, -2 when more data is needed, -1 on a malformed request.
+#[no_mangle]
+pub extern "C" fn anx_http_parse_borrowed(data: *const u8, len: usize, out: *mut RequestRanges) -> c_int {
+    if data.is_null() || out.is_null() {
+        return -1;
+    }
+    
+    let slice = unsafe { std::slice::from_raw_parts(data, len) };
+    let ranges = unsafe { &mut *out };
+    
+    match ranges.parse(slice) {
+        ParseStatus::Complete => 0,
+        ParseStatus::Partial => -2,
+        ParseStatus::Invalid => -1,
+    }
+}
+
+/// Case-insensitive header lookup on a borrowed parse result.
+/// Returns 1 and fills `value` when found, 0 otherwise.
+#[no_mangle]
+pub extern "C" fn anx_http_find_header(data: *const u8, len: usize, ranges: *const RequestRanges,
+                                       name: *const u8, name_len: usize, value: *mut ByteRange) -> c_int {
+    if data.is_null() || ranges.is_null() || name.is_null() || value.is_null() {
+        return 0;
+    }
+    
+    let slice = unsafe { std::slice::from_raw_parts(data, len) };
+    let name = unsafe { std::slice::from_raw_parts(name, name_len) };
+    let ranges = unsafe { &*ranges };
+    if ranges.header_count as usize > ranges.headers.len() {
+        return 0;
+    }
+    
+    match ranges.find_header(slice, name) {
+        Some(range) => {
+            unsafe { *value = range; }
+            1
+        }
+        None => 0,
+    }
+}
+
 /// Create HTTP response
 #[no_mangle]
 pub extern "C" fn anx_http_response_new(status_code: c_uint, reason_phrase: *const c_char) -> *mut HttpResponseHandle {
@@ -449,6 +498,84 @@ pub extern "C" fn anx_http_response_free(handle: *mut HttpResponseHandle) {
     }
 }
 
+// =============================================================================
+// Location Regex Functions
+// =============================================================================
+
+/// Compile regex locations into one matcher.
+/// `case_insensitive[i]` is non-zero for `location ~*` patterns.
+/// Returns NULL when a pattern is invalid; the pattern index is stored in
+/// `err_index` and the message is copied (NUL-terminated) into `err_buf`.
+#[no_mangle]
+pub extern "C" fn anx_location_regex_new(patterns: *const *const c_char, case_insensitive: *const c_int,
+                                         count: usize, err_index: *mut c_int,
+                                         err_buf: *mut c_char, err_len: usize) -> *mut LocationRegexHandle {
+    if patterns.is_null() || case_insensitive.is_null() || count == 0 {
+        return ptr::null_mut();
+    }
+    
+    let mut list = Vec::with_capacity(count);
+    for i in 0..count {
+        let pattern = unsafe {
+            let p = *patterns.add(i);
+            if p.is_null() {
+                return ptr::null_mut();
+            }
+            match CStr::from_ptr(p).to_str() {
+                Ok(s) => s,
+                Err(_) => return ptr::null_mut(),
+            }
+        };
+        let icase = unsafe { *case_insensitive.add(i) != 0 };
+        list.push(LocationPattern { pattern, case_insensitive: icase });
+    }
+    
+    match LocationRegexSet::new(&list) {
+        Ok(set) => Box::into_raw(Box::new(LocationRegexHandle { set: Box::new(set) })),
+        Err(err) => {
+            let LocationRegexError::InvalidPattern { index, message, .. } = err;
+            if !err_index.is_null() {
+                unsafe { *err_index = index as c_int; }
+            }
+            if !err_buf.is_null() && err_len > 0 {
+                // Parse errors end with the "error: ..." line after a caret diagram
+                let message = message.lines().rev().find(|l| !l.trim().is_empty()).unwrap_or("").trim();
+                let n = message.len().min(err_len - 1);
+                unsafe {
+                    ptr::copy_nonoverlapping(message.as_ptr(), err_buf as *mut u8, n);
+                    *err_buf.add(n) = 0;
+                }
+            }
+            ptr::null_mut()
+        }
+    }
+}
+
+/// Index of the first pattern (in configuration order) matching `path`, or -1
+#[no_mangle]
+pub extern "C" fn anx_location_regex_match(handle: *const LocationRegexHandle, path: *const u8, len: usize) -> c_int {
+    if handle.is_null() || (path.is_null() && len > 0) {
+        return -1;
+    }
+    
+    let path = if len == 0 { &[][..] } else { unsafe { std::slice::from_raw_parts(path, len) } };
+    let handle = unsafe { &*handle };
+    match handle.set.first_match(path) {
+        Some(index) => index as c_int,
+        None => -1,
+    }
+}
+
+/// Free a location regex handle
+#[no_mangle]
+pub extern "C" fn anx_location_regex_free(handle: *mut LocationRegexHandle) {
+    if !handle.is_null() {
+        unsafe {
+            let _ = Box::from_raw(handle);
+        }
+    }
+}
+
 // =============================================================================
 // Cache Functions
 // =============================================================================
@@ -0,0 +1,418 @@
+//! Borrowed (zero-copy) HTTP request parsing.
+//!
+//! [`RequestRanges::parse`] fills a `#[repr(C)]` struct with byte ranges into
+//! the caller's buffer: nothing is allocated and nothing is copied, so the
+//! result can be handed across FFI and read from C directly. Header lookup is
+//! case-insensitive and also allocation-free.
+
+/// Maximum number of header lines recorded per request; more is an error.
+pub const MAX_HEADERS: usize = 64;
+
+/// Set in [`RequestRanges::flags`] when a Content-Length header was present.
+pub const FLAG_CONTENT_LENGTH: u32 = 1 << 0;
+/// Set in [`RequestRanges::flags`] when Transfer-Encoding is non-empty.
+pub const FLAG_CHUNKED: u32 = 1 << 1;
+
+/// A `(offset, length)` range into the parsed buffer.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct ByteRange {
+    pub off: u32,
+    pub len: u32,
+}
+
+impl ByteRange {
+    fn new(start: usize, end: usize) -> Self {
+        Self { off: start as u32, len: (end - start) as u32 }
+    }
+
+    /// Resolve the range against the buffer it was parsed from.
+    pub fn get<'a>(&self, buf: &'a [u8]) -> &'a [u8] {
+        let start = self.off as usize;
+        &buf[start..start + self.len as usize]
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+}
+
+/// Name and value ranges of one header line.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct HeaderRange {
+    pub name: ByteRange,
+    pub value: ByteRange,
+}
+
+/// Outcome of a borrowed parse.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ParseStatus {
+    /// The request line and all headers are present.
+    Complete,
+    /// The header block is not terminated yet; parse again with more data.
+    Partial,
+    /// The request is malformed.
+    Invalid,
+}
+
+/// Parsed request line and headers as ranges into the caller's buffer.
+///
+/// The layout is shared with C (`AnxRequestRanges` in anx_rust.h).
+#[repr(C)]
+#[derive(Debug, Clone)]
+pub struct RequestRanges {
+    pub method: ByteRange,
+    pub uri: ByteRange,
+    /// `uri` up to the first `?`.
+    pub path: ByteRange,
+    /// `uri` after the first `?`, empty when there is no query string.
+    pub query: ByteRange,
+    pub version: ByteRange,
+    pub content_length: u64,
+    /// The `x` in `HTTP/1.x`.
+    pub version_minor: u32,
+    pub header_count: u32,
+    /// Length of the request line and headers, including the blank line.
+    pub header_len: u32,
+    pub flags: u32,
+    pub headers: [HeaderRange; MAX_HEADERS],
+}
+
+impl Default for RequestRanges {
+    fn default() -> Self {
+        Self {
+            method: ByteRange::default(),
+            uri: ByteRange::default(),
+            path: ByteRange::default(),
+            query: ByteRange::default(),
+            version: ByteRange::default(),
+            content_length: 0,
+            version_minor: 0,
+            header_count: 0,
+            header_len: 0,
+            flags: 0,
+            headers: [HeaderRange::default(); MAX_HEADERS],
+        }
+    }
+}
+
+/// RFC 7230 `tchar`.
+fn is_token(c: u8) -> bool {
+    matches!(c,
+        b'!' | b'#' | b'$' | b'%' | b'&' | b'\'' | b'*' | b'+' | b'-' | b'.' |
+        b'^' | b'_' | b'`' | b'|' | b'~' | b'0'..=b'9' | b'a'..=b'z' | b'A'..=b'Z')
+}
+
+/// Control characters other than HTAB, and DEL, are never valid in a header.
+fn is_invalid(c: u8) -> bool {
+    (c < 0x20 && c != b'\t') || c == 0x7f
+}
+
+fn trim_ows(buf: &[u8], mut start: usize, mut end: usize) -> (usize, usize) {
+    while start < end && (buf[start] == b' ' || buf[start] == b'\t') {
+        start += 1;
+    }
+    while end > start && (buf[end - 1] == b' ' || buf[end - 1] == b'\t') {
+        end -= 1;
+    }
+    (start, end)
+}
+
+impl RequestRanges {
+    /// Parse the request line and headers at the start of `buf`.
+    ///
+    /// A single pass over the header block; on anything but
+    /// [`ParseStatus::Complete`] the contents of `self` are unspecified.
+    pub fn parse(&mut self, buf: &[u8]) -> ParseStatus {
+        if buf.len() > u32::MAX as usize {
+            return ParseStatus::Invalid;
+        }
+        self.header_count = 0;
+        self.content_length = 0;
+        self.flags = 0;
+
+        // Tolerate empty lines before the request line (RFC 7230 3.5).
+        let mut pos = 0;
+        while pos < buf.len() && (buf[pos] == b'\r' || buf[pos] == b'\n') {
+            pos += 1;
+        }
+
+        let mut request_line = true;
+        loop {
+            let lf = match buf[pos..].iter().position(|&c| c == b'\n') {
+                Some(i) => pos + i,
+                None => return ParseStatus::Partial,
+            };
+            let end = if lf > pos && buf[lf - 1] == b'\r' { lf - 1 } else { lf };
+
+            if request_line {
+                if !self.parse_request_line(buf, pos, end) {
+                    return ParseStatus::Invalid;
+                }
+                request_line = false;
+            } else if end == pos {
+                self.header_len = (lf + 1) as u32;
+                return ParseStatus::Complete;
+            } else if !self.parse_header_line(buf, pos, end) {
+                return ParseStatus::Invalid;
+            }
+            pos = lf + 1;
+        }
+    }
+
+    fn parse_request_line(&mut self, buf: &[u8], start: usize, end: usize) -> bool {
+        let line = &buf[start..end];
+
+        let method_len = line.iter().position(|&c| !is_token(c)).unwrap_or(line.len());
+        if method_len == 0 || line.get(method_len) != Some(&b' ') {
+            return false;
+        }
+        self.method = ByteRange::new(start, start + method_len);
+
+        let uri_start = method_len + 1;
+        let uri_len = line[uri_start..].iter().position(|&c| c == b' ').unwrap_or(line.len() - uri_start);
+        let uri = &line[uri_start..uri_start + uri_len];
+        if uri.is_empty() || uri.iter().any(|&c| c < 0x21 || c == 0x7f) {
+            return false;
+        }
+        let uri_end = uri_start + uri_len;
+        self.uri = ByteRange::new(start + uri_start, start + uri_end);
+        match uri.iter().position(|&c| c == b'?') {
+            Some(q) => {
+                self.path = ByteRange::new(start + uri_start, start + uri_start + q);
+                self.query = ByteRange::new(start + uri_start + q + 1, start + uri_end);
+            }
+            None => {
+                self.path = self.uri;
+                self.query = ByteRange::new(start + uri_end, start + uri_end);
+            }
+        }
+
+        let version = &line[(uri_end + 1).min(line.len())..];
+        if uri_end >= line.len() || version.len() != 8 || &version[..7] != b"HTTP/1." ||
+            !version[7].is_ascii_digit() {
+            return false;
+        }
+        self.version = ByteRange::new(start + uri_end + 1, end);
+        self.version_minor = (version[7] - b'0') as u32;
+        true
+    }
+
+    fn parse_header_line(&mut self, buf: &[u8], start: usize, end: usize) -> bool {
+        let line = &buf[start..end];
+        let colon = match line.iter().position(|&c| !is_token(c)) {
+            Some(i) if i > 0 && line[i] == b':' => i,
+            _ => return false,
+        };
+        if line[colon + 1..].iter().any(|&c| is_invalid(c)) {
+            return false;
+        }
+        if self.header_count as usize == MAX_HEADERS {
+            return false;
+        }
+
+        let (value_start, value_end) = trim_ows(buf, start + colon + 1, end);
+        let name = &line[..colon];
+        let value = &buf[value_start..value_end];
+
+        if name.eq_ignore_ascii_case(b"content-length") {
+            if value.is_empty() || !value.iter().all(u8::is_ascii_digit) {
+                return false;
+            }
+            let mut n: u64 = 0;
+            for &d in value {
+                n = match n.checked_mul(10).and_then(|n| n.checked_add((d - b'0') as u64)) {
+                    Some(n) => n,
+                    None => return false,
+                };
+            }
+            // Repeated Content-Length must agree, as in the C parser; otherwise
+            // the two parsers would frame the body differently.
+            if self.flags & FLAG_CONTENT_LENGTH != 0 && n != self.content_length {
+                return false;
+            }
+            self.content_length = n;
+            self.flags |= FLAG_CONTENT_LENGTH;
+        } else if name.eq_ignore_ascii_case(b"transfer-encoding") && !value.is_empty() {
+            self.flags |= FLAG_CHUNKED;
+        }
+
+        self.headers[self.header_count as usize] = HeaderRange {
+            name: ByteRange::new(start, start + colon),
+            value: ByteRange::new(value_start, value_end),
+        };
+        self.header_count += 1;
+        true
+    }
+
+    /// Parsed headers, in order of appearance.
+    pub fn headers(&self) -> &[HeaderRange] {
+        &self.headers[..self.header_count as usize]
+    }
+
+    /// Value range of the first header called `name`, compared ASCII
+    /// case-insensitively. Does not allocate.
+    pub fn find_header(&self, buf: &[u8], name: &[u8]) -> Option<ByteRange> {
+        self.headers()
+            .iter()
+            .find(|h| h.name.len as usize == name.len() && h.name.get(buf).eq_ignore_ascii_case(name))
+            .map(|h| h.value)
+    }
+}
+
+/// A parsed request borrowing its buffer, for use from Rust.
+#[derive(Debug, Clone)]
+pub struct BorrowedRequest<'a> {
+    buf: &'a [u8],
+    ranges: RequestRanges,
+}
+
+impl<'a> BorrowedRequest<'a> {
+    /// Parse `buf`; `Err` carries [`ParseStatus::Partial`] or [`ParseStatus::Invalid`].
+    pub fn parse(buf: &'a [u8]) -> Result<Self, ParseStatus> {
+        let mut ranges = RequestRanges::default();
+        match ranges.parse(buf) {
+            ParseStatus::Complete => Ok(Self { buf, ranges }),
+            status => Err(status),
+        }
+    }
+
+    pub fn ranges(&self) -> &RequestRanges {
+        &self.ranges
+    }
+
+    pub fn method(&self) -> &'a [u8] {
+        self.ranges.method.get(self.buf)
+    }
+
+    pub fn uri(&self) -> &'a [u8] {
+        self.ranges.uri.get(self.buf)
+    }
+
+    pub fn path(&self) -> &'a [u8] {
+        self.ranges.path.get(self.buf)
+    }
+
+    pub fn query(&self) -> &'a [u8] {
+        self.ranges.query.get(self.buf)
+    }
+
+    pub fn version(&self) -> &'a [u8] {
+        self.ranges.version.get(self.buf)
+    }
+
+    /// Header value by name (case-insensitive).
+    pub fn header(&self, name: &str) -> Option<&'a [u8]> {
+        self.ranges.find_header(self.buf, name.as_bytes()).map(|r| r.get(self.buf))
+    }
+
+    /// Iterate over `(name, value)` pairs in order of appearance.
+    pub fn headers(&self) -> impl Iterator<Item = (&'a [u8], &'a [u8])> + '_ {
+        let buf = self.buf;
+        self.ranges.headers().iter().map(move |h| (h.name.get(buf), h.value.get(buf)))
+    }
+
+    pub fn content_length(&self) -> Option<u64> {
+        if self.ranges.flags & FLAG_CONTENT_LENGTH != 0 {
+            Some(self.ranges.content_length)
+        } else {
+            None
+        }
+    }
+
+    /// Length of the header block; the body (if any) starts here.
+    pub fn header_len(&self) -> usize {
+        self.ranges.header_len as usize
+    }
+
+    /// HTTP/1.1 keeps the connection unless `Connection: close`; HTTP/1.0
+    /// needs an explicit `Connection: keep-alive`.
+    pub fn is_keep_alive(&self) -> bool {
+        let has_token = |token: &[u8]| {
+            self.header("connection").map_or(false, |v| {
+                v.split(|&c| c == b',').any(|t| {
+                    let (s, e) = trim_ows(t, 0, t.len());
+                    t[s..e].eq_ignore_ascii_case(token)
+                })
+            })
+        };
+        if has_token(b"close") {
+            return false;
+        }
+        has_token(b"keep-alive") || self.ranges.version_minor >= 1
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_borrowed_parse_get() {
+        let req = b"GET /index.html?a=1 HTTP/1.1\r\nHost: example.com\r\nUser-Agent: ANX/1.0\r\n\r\n";
+        let parsed = BorrowedRequest::parse(req).unwrap();
+        assert_eq!(parsed.method(), b"GET");
+        assert_eq!(parsed.uri(), b"/index.html?a=1");
+        assert_eq!(parsed.path(), b"/index.html");
+        assert_eq!(parsed.query(), b"a=1");
+        assert_eq!(parsed.version(), b"HTTP/1.1");
+        assert_eq!(parsed.header("HOST"), Some(&b"example.com"[..]));
+        assert_eq!(parsed.header("user-agent"), Some(&b"ANX/1.0"[..]));
+        assert_eq!(parsed.header("referer"), None);
+        assert_eq!(parsed.header_len(), req.len());
+        assert!(parsed.is_keep_alive());
+    }
+
+    #[test]
+    fn test_borrowed_parse_body_framing() {
+        let req = b"POST /api HTTP/1.0\nContent-Length: 5\nConnection: Keep-Alive\n\nhello";
+        let parsed = BorrowedRequest::parse(req).unwrap();
+        assert_eq!(parsed.content_length(), Some(5));
+        assert_eq!(&req[parsed.header_len()..], b"hello");
+        assert!(parsed.is_keep_alive());
+
+        let chunked = b"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+        let parsed = BorrowedRequest::parse(chunked).unwrap();
+        assert!(parsed.ranges().flags & FLAG_CHUNKED != 0);
+    }
+
+    #[test]
+    fn test_borrowed_parse_duplicate_content_length() {
+        let same = b"POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\nhello";
+        assert_eq!(BorrowedRequest::parse(same).unwrap().content_length(), Some(5));
+
+        let differ = b"POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 10\r\n\r\nhello";
+        assert_eq!(BorrowedRequest::parse(differ).unwrap_err(), ParseStatus::Invalid);
+    }
+
+    #[test]
+    fn test_borrowed_parse_partial_and_invalid() {
+        assert_eq!(BorrowedRequest::parse(b"GET / HTTP/1.1\r\nHost: a").unwrap_err(),
+                   ParseStatus::Partial);
+        assert_eq!(BorrowedRequest::parse(b"GET / HTTP/2.0\r\n\r\n").unwrap_err(),
+                   ParseStatus::Invalid);
+        assert_eq!(BorrowedRequest::parse(b"GET / HTTP/1.1\r\nBad Header: x\r\n\r\n").unwrap_err(),
+                   ParseStatus::Invalid);
+        assert_eq!(BorrowedRequest::parse(b"GET / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n").unwrap_err(),
+                   ParseStatus::Invalid);
+    }
+
+    #[test]
+    fn test_find_header_is_case_insensitive() {
+        let req = b"GET / HTTP/1.1\r\nIf-None-Match:  \"abc\" \r\n\r\n";
+        let mut ranges = RequestRanges::default();
+        assert_eq!(ranges.parse(req), ParseStatus::Complete);
+        let value = ranges.find_header(req, b"if-none-match").unwrap();
+        assert_eq!(value.get(req), b"\"abc\"");
+        assert!(ranges.find_header(req, b"if-none-matc").is_none());
+    }
+
+    #[test]
+    fn test_layout_matches_c_header() {
+        // AnxRequestRanges in anx_rust.h
+        assert_eq!(std::mem::size_of::<ByteRange>(), 8);
+        assert_eq!(std::mem::size_of::<HeaderRange>(), 16);
+        assert_eq!(std::mem::size_of::<RequestRanges>(), 64 + MAX_HEADERS * 16);
+    }
+}
@@ -1,12 +1,18 @@
 //! HTTP request parser module for ANX HTTP Server
 //! 
 //! This module provides safe HTTP request parsing functionality.
+//! [`HttpRequest`] owns its data; [`borrowed`] parses into ranges over the
+//! caller's buffer without allocating.
 
 use std::collections::HashMap;
 use std::str::FromStr;
 use std::fmt;
 use thiserror::Error;
 
+pub mod borrowed;
+
+pub use borrowed::{BorrowedRequest, ByteRange, HeaderRange, ParseStatus, RequestRanges};
+
 /// HTTP request structure
 #[derive(Debug, Clone)]
 pub struct HttpRequest {
@@ -0,0 +1,137 @@
+//! Regex location matching for ANX HTTP Server
+//!
+//! All `location ~` / `location ~*` patterns of a server are compiled once at
+//! configuration load into a single [`regex::bytes::RegexSet`], so a request
+//! path is scanned once no matter how many regex locations exist. nginx tries
+//! regex locations in configuration order and takes the first match; the set
+//! reports matches by pattern index, so the lowest matching index is that
+//! location.
+
+use regex::bytes::{RegexSet, RegexSetBuilder};
+use thiserror::Error;
+
+/// Errors raised while compiling location patterns
+#[derive(Error, Debug)]
+pub enum LocationRegexError {
+    #[error("invalid regex in location #{index} \"{pattern}\": {message}")]
+    InvalidPattern {
+        index: usize,
+        pattern: String,
+        message: String,
+    },
+}
+
+/// One `location ~` (case-sensitive) or `location ~*` (case-insensitive) pattern
+#[derive(Debug, Clone)]
+pub struct LocationPattern<'a> {
+    pub pattern: &'a str,
+    pub case_insensitive: bool,
+}
+
+/// Compiled regex locations of one server, in configuration order
+#[derive(Debug)]
+pub struct LocationRegexSet {
+    set: RegexSet,
+}
+
+impl LocationRegexSet {
+    /// Compile all patterns into one set.
+    ///
+    /// On failure each pattern is compiled alone to report which one is invalid.
+    pub fn new(patterns: &[LocationPattern<'_>]) -> Result<Self, LocationRegexError> {
+        let sources: Vec<String> = patterns.iter().map(Self::source).collect();
+        match RegexSetBuilder::new(&sources).build() {
+            Ok(set) => Ok(Self { set }),
+            Err(err) => {
+                for (index, source) in sources.iter().enumerate() {
+                    if let Err(e) = RegexSetBuilder::new([source]).build() {
+                        return Err(LocationRegexError::InvalidPattern {
+                            index,
+                            pattern: patterns[index].pattern.to_string(),
+                            message: e.to_string(),
+                        });
+                    }
+                }
+                Err(LocationRegexError::InvalidPattern {
+                    index: 0,
+                    pattern: String::new(),
+                    message: err.to_string(),
+                })
+            }
+        }
+    }
+
+    fn source(p: &LocationPattern<'_>) -> String {
+        if p.case_insensitive {
+            format!("(?i){}", p.pattern)
+        } else {
+            p.pattern.to_string()
+        }
+    }
+
+    /// Number of compiled patterns
+    pub fn len(&self) -> usize {
+        self.set.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.set.is_empty()
+    }
+
+    /// Index of the first pattern (in configuration order) matching `path`
+    pub fn first_match(&self, path: &[u8]) -> Option<usize> {
+        self.set.matches(path).iter().next()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn compile(patterns: &[(&'static str, bool)]) -> LocationRegexSet {
+        let patterns: Vec<LocationPattern> = patterns
+            .iter()
+            .map(|&(pattern, case_insensitive)| LocationPattern { pattern, case_insensitive })
+            .collect();
+        LocationRegexSet::new(&patterns).unwrap()
+    }
+
+    #[test]
+    fn test_first_match_follows_config_order() {
+        let set = compile(&[(r"^/api/v\d+/", false), (r"\.php$", false), (r"^/api/", false)]);
+        assert_eq!(set.len(), 3);
+        assert_eq!(set.first_match(b"/api/v2/users"), Some(0));
+        assert_eq!(set.first_match(b"/api/info.php"), Some(1));
+        assert_eq!(set.first_match(b"/api/info"), Some(2));
+        assert_eq!(set.first_match(b"/static/app.js"), None);
+    }
+
+    #[test]
+    fn test_case_insensitive_patterns() {
+        let set = compile(&[(r"\.(gif|jpg|png)$", true), (r"\.css$", false)]);
+        assert_eq!(set.first_match(b"/img/LOGO.PNG"), Some(0));
+        assert_eq!(set.first_match(b"/site.css"), Some(1));
+        assert_eq!(set.first_match(b"/SITE.CSS"), None);
+    }
+
+    #[test]
+    fn test_non_utf8_path() {
+        let set = compile(&[(r"^/files/", false)]);
+        assert_eq!(set.first_match(b"/files/\xff\xfe"), Some(0));
+    }
+
+    #[test]
+    fn test_invalid_pattern_reports_index() {
+        let patterns = [
+            LocationPattern { pattern: r"^/ok/", case_insensitive: false },
+            LocationPattern { pattern: r"^/bad(", case_insensitive: true },
+        ];
+        match LocationRegexSet::new(&patterns) {
+            Err(LocationRegexError::InvalidPattern { index, pattern, .. }) => {
+                assert_eq!(index, 1);
+                assert_eq!(pattern, "^/bad(");
+            }
+            Ok(_) => panic!("expected an error"),
+        }
+    }
+}
@@ -0,0 +1,363 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "asm_http_scan.h"
+
+#include <string.h>
+
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#include <arm_neon.h>
+#ifndef HWCAP_SVE
+#define HWCAP_SVE (1 << 22)
+#endif
+// 编译器未默认开启SVE时，只为SVE内核打开目标特性，其余代码仍可在无SVE的CPU上运行
+#if defined(__ARM_FEATURE_SVE)
+#define HTTP_SCAN_HAVE_SVE 1
+#include <arm_sve.h>
+#elif defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 12
+#define HTTP_SCAN_HAVE_SVE 1
+#define HTTP_SCAN_SVE_PRAGMA 1
+#pragma GCC push_options
+#pragma GCC target("+sve")
+#include <arm_sve.h>
+#pragma GCC pop_options
+#endif
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTTP_SCAN_HAVE_X86 1
+#endif
+
+#define SCAN_BLOCK 64
+
+// 一个64字节块的分类结果，第i位对应块内第i个字节
+// bad包含所有CR，紧跟LF的CR由asm_http_scan_lines按cr和lf清除
+typedef struct {
+    uint64_t lf;
+    uint64_t cr;
+    uint64_t colon;
+    uint64_t bad;
+} scan_masks_t;
+
+typedef void (*scan_kernel_fn)(const uint8_t *p, scan_masks_t *m);
+
+// 标量内核：SWAR，每次处理8个字节，所有平台都可用
+#define SWAR_ONES 0x0101010101010101ULL
+#define SWAR_LOW7 0x7f7f7f7f7f7f7f7fULL
+#define SWAR_HIGH 0x8080808080808080ULL
+// 8个0/1字节乘以魔数后，最高字节即为这8个字节的位掩码
+#define GATHER_MAGIC 0x0102040810204080ULL
+
+// 等于c的字节最高位置1（无误报）
+static inline uint64_t swar_eq(uint64_t x, uint8_t c) {
+    uint64_t t = x ^ (SWAR_ONES * c);
+    return ~(((t & SWAR_LOW7) + SWAR_LOW7) | t) & SWAR_HIGH;
+}
+
+static inline uint64_t swar_gather(uint64_t high_bits) {
+    return ((high_bits >> 7) * GATHER_MAGIC) >> 56;
+}
+
+static void classify_scalar(const uint8_t *p, scan_masks_t *m) {
+    uint64_t lf = 0, cr = 0, colon = 0, bad = 0;
+    for (int i = 0; i < SCAN_BLOCK / 8; i++) {
+        uint64_t x;
+        memcpy(&x, p + 8 * i, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        x = __builtin_bswap64(x);  // 保证第0个字节对应掩码的最低位
+#endif
+        uint64_t is_lf = swar_eq(x, '\n');
+        // 小于0x20的字节：最高位为0且低7位加0x60不进位到最高位
+        uint64_t is_ctl = ~(((x & SWAR_LOW7) + SWAR_ONES * 0x60) | x) & SWAR_HIGH;
+        uint64_t allowed = is_lf | swar_eq(x, '\t');
+        uint64_t is_bad = (is_ctl & ~allowed) | swar_eq(x, 0x7f);
+
+        lf |= swar_gather(is_lf) << (8 * i);
+        cr |= swar_gather(swar_eq(x, '\r')) << (8 * i);
+        colon |= swar_gather(swar_eq(x, ':')) << (8 * i);
+        bad |= swar_gather(is_bad) << (8 * i);
+    }
+    m->lf = lf;
+    m->cr = cr;
+    m->colon = colon;
+    m->bad = bad;
+}
+
+#if defined(__aarch64__)
+// 16字节比较结果(0x00/0xff) -> 64位掩码，每次处理4个向量
+static inline uint64_t neon_movemask64(uint8x16_t m0, uint8x16_t m1,
+                                       uint8x16_t m2, uint8x16_t m3) {
+    static const uint8_t bit_table[16] = {
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+        0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80
+    };
+    const uint8x16_t bits = vld1q_u8(bit_table);
+    uint8x16_t s0 = vpaddq_u8(vandq_u8(m0, bits), vandq_u8(m1, bits));
+    uint8x16_t s1 = vpaddq_u8(vandq_u8(m2, bits), vandq_u8(m3, bits));
+    s0 = vpaddq_u8(s0, s1);
+    s0 = vpaddq_u8(s0, s0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+
+static void classify_neon(const uint8_t *p, scan_masks_t *m) {
+    const uint8x16_t lf = vdupq_n_u8('\n');
+    const uint8x16_t cr = vdupq_n_u8('\r');
+    const uint8x16_t tab = vdupq_n_u8('\t');
+    const uint8x16_t colon = vdupq_n_u8(':');
+    const uint8x16_t ctl = vdupq_n_u8(0x1f);
+    const uint8x16_t del = vdupq_n_u8(0x7f);
+    uint8x16_t v[4], is_lf[4], is_cr[4], is_colon[4], is_bad[4];
+
+    for (int i = 0; i < 4; i++) {
+        v[i] = vld1q_u8(p + 16 * i);
+        is_lf[i] = vceqq_u8(v[i], lf);
+        is_cr[i] = vceqq_u8(v[i], cr);
+        is_colon[i] = vceqq_u8(v[i], colon);
+        uint8x16_t allowed = vorrq_u8(is_lf[i], vceqq_u8(v[i], tab));
+        is_bad[i] = vorrq_u8(vbicq_u8(vcleq_u8(v[i], ctl), allowed), vceqq_u8(v[i], del));
+    }
+    m->lf = neon_movemask64(is_lf[0], is_lf[1], is_lf[2], is_lf[3]);
+    m->cr = neon_movemask64(is_cr[0], is_cr[1], is_cr[2], is_cr[3]);
+    m->colon = neon_movemask64(is_colon[0], is_colon[1], is_colon[2], is_colon[3]);
+    m->bad = neon_movemask64(is_bad[0], is_bad[1], is_bad[2], is_bad[3]);
+}
+#endif
+
+#if defined(HTTP_SCAN_HAVE_SVE)
+#if defined(HTTP_SCAN_SVE_PRAGMA)
+#pragma GCC push_options
+#pragma GCC target("+sve")
+#endif
+// 与标量内核相同，每个64位通道内的8个0/1字节乘以魔数得到位掩码
+
+static inline void sve_store_mask(svbool_t hit, svbool_t pg_d, uint8_t *dst) {
+    svuint8_t ones = svsel_u8(hit, svdup_n_u8(1), svdup_n_u8(0));
+    svuint64_t g = svmul_n_u64_x(pg_d, svreinterpret_u64_u8(ones), GATHER_MAGIC);
+    g = svlsr_n_u64_x(pg_d, g, 56);
+    svst1b_u64(pg_d, dst, g);
+}
+
+// 向量长度不固定：每轮处理svcntb()字节，输出svcntd()个字节的掩码
+static void classify_sve(const uint8_t *p, scan_masks_t *m) {
+    uint8_t lf_bytes[8], cr_bytes[8], colon_bytes[8], bad_bytes[8];
+
+    for (uint64_t i = 0; i < SCAN_BLOCK; i += svcntb()) {
+        svbool_t pg = svwhilelt_b8_u64(i, SCAN_BLOCK);
+        svbool_t pg_d = svwhilelt_b64_u64(i / 8, SCAN_BLOCK / 8);
+        svuint8_t v = svld1_u8(pg, p + i);
+
+        svbool_t is_lf = svcmpeq_n_u8(pg, v, '\n');
+        svbool_t is_cr = svcmpeq_n_u8(pg, v, '\r');
+        svbool_t is_colon = svcmpeq_n_u8(pg, v, ':');
+        svbool_t allowed = svorr_b_z(pg, is_lf, svcmpeq_n_u8(pg, v, '\t'));
+        svbool_t is_bad = svorr_b_z(pg, svbic_b_z(pg, svcmple_n_u8(pg, v, 0x1f), allowed),
+                                    svcmpeq_n_u8(pg, v, 0x7f));
+
+        sve_store_mask(is_lf, pg_d, lf_bytes + i / 8);
+        sve_store_mask(is_cr, pg_d, cr_bytes + i / 8);
+        sve_store_mask(is_colon, pg_d, colon_bytes + i / 8);
+        sve_store_mask(is_bad, pg_d, bad_bytes + i / 8);
+    }
+    memcpy(&m->lf, lf_bytes, 8);
+    memcpy(&m->cr, cr_bytes, 8);
+    memcpy(&m->colon, colon_bytes, 8);
+    memcpy(&m->bad, bad_bytes, 8);
+}
+#if defined(HTTP_SCAN_SVE_PRAGMA)
+#pragma GCC pop_options
+#endif
+#endif
+
+#if defined(HTTP_SCAN_HAVE_X86)
+// SSE4.2：非法字符用PCMPESTRM的区间模式一条指令完成判断
+__attribute__((target("sse4.2")))
+static void classify_sse42(const uint8_t *p, scan_masks_t *m) {
+    const __m128i ranges = _mm_setr_epi8(0x00, 0x08, 0x0b, 0x1f, 0x7f, 0x7f, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i colon = _mm_set1_epi8(':');
+    uint64_t lf_mask = 0, cr_mask = 0, colon_mask = 0, bad_mask = 0;
+
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        __m128i bad = _mm_cmpestrm(ranges, 6, v, 16,
+                                   _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_BIT_MASK);
+        lf_mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf)) << (16 * i);
+        cr_mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, cr)) << (16 * i);
+        colon_mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, colon)) << (16 * i);
+        bad_mask |= (uint64_t)(uint16_t)_mm_cvtsi128_si32(bad) << (16 * i);
+    }
+    m->lf = lf_mask;
+    m->cr = cr_mask;
+    m->colon = colon_mask;
+    m->bad = bad_mask;
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const uint8_t *p, scan_masks_t *m) {
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i ctl = _mm256_set1_epi8(0x1f);
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    uint64_t lf_mask = 0, cr_mask = 0, colon_mask = 0, bad_mask = 0;
+
+    for (int i = 0; i < 2; i++) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + 32 * i));
+        __m256i is_lf = _mm256_cmpeq_epi8(v, lf);
+        __m256i is_cr = _mm256_cmpeq_epi8(v, cr);
+        __m256i is_ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v);  // v <= 0x1f
+        __m256i allowed = _mm256_or_si256(is_lf, _mm256_cmpeq_epi8(v, tab));
+        __m256i bad = _mm256_or_si256(_mm256_andnot_si256(allowed, is_ctl),
+                                      _mm256_cmpeq_epi8(v, del));
+        lf_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_lf) << (32 * i);
+        cr_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(is_cr) << (32 * i);
+        colon_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, colon)) << (32 * i);
+        bad_mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(bad) << (32 * i);
+    }
+    m->lf = lf_mask;
+    m->cr = cr_mask;
+    m->colon = colon_mask;
+    m->bad = bad_mask;
+}
+#endif
+
+typedef struct {
+    const char *name;
+    scan_kernel_fn fn;
+} scan_kernel_t;
+
+static const scan_kernel_t scan_kernels[] = {
+#if defined(HTTP_SCAN_HAVE_SVE)
+    { "sve", classify_sve },
+#endif
+#if defined(__aarch64__)
+    { "neon", classify_neon },
+#endif
+#if defined(HTTP_SCAN_HAVE_X86)
+    { "avx2", classify_avx2 },
+    { "sse4.2", classify_sse42 },
+#endif
+    { "scalar", classify_scalar },
+};
+
+static const scan_kernel_t *active_kernel = NULL;
+
+static int kernel_supported(const scan_kernel_t *k) {
+#if defined(HTTP_SCAN_HAVE_SVE)
+    if (k->fn == classify_sve) return (getauxval(AT_HWCAP) & HWCAP_SVE) != 0;
+#endif
+#if defined(HTTP_SCAN_HAVE_X86)
+    __builtin_cpu_init();
+    if (k->fn == classify_avx2) return __builtin_cpu_supports("avx2");
+    if (k->fn == classify_sse42) return __builtin_cpu_supports("sse4.2");
+#endif
+    (void)k;
+    return 1;  // NEON是aarch64的基础特性，标量实现总是可用
+}
+
+void asm_http_scan_select(void) {
+    // 表中按优先级排列，选择第一个CPU支持的内核
+    for (size_t i = 0; i < sizeof(scan_kernels) / sizeof(scan_kernels[0]); i++) {
+        if (kernel_supported(&scan_kernels[i])) {
+            __atomic_store_n(&active_kernel, &scan_kernels[i], __ATOMIC_RELEASE);
+            return;
+        }
+    }
+}
+
+const char *asm_http_scan_kernel(void) {
+    if (!__atomic_load_n(&active_kernel, __ATOMIC_ACQUIRE)) asm_http_scan_select();
+    return active_kernel->name;
+}
+
+int asm_http_scan_use(const char *name) {
+    for (size_t i = 0; i < sizeof(scan_kernels) / sizeof(scan_kernels[0]); i++) {
+        if (strcmp(scan_kernels[i].name, name) == 0 && kernel_supported(&scan_kernels[i])) {
+            __atomic_store_n(&active_kernel, &scan_kernels[i], __ATOMIC_RELEASE);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void asm_http_scan_reset(asm_http_scan_state_t *st) {
+    st->pos = 0;
+    st->line_start = 0;
+    st->colon = SIZE_MAX;
+}
+
+int asm_http_scan_lines(asm_http_scan_state_t *st, const char *buf, size_t len,
+                        asm_http_line_t *lines, int max) {
+    const scan_kernel_t *kernel = __atomic_load_n(&active_kernel, __ATOMIC_ACQUIRE);
+    if (!kernel) {
+        asm_http_scan_select();
+        kernel = active_kernel;
+    }
+
+    // 末尾的CR要等到下一个字节到达才能判断是否属于CRLF，留到下次扫描
+    if (len > st->pos && buf[len - 1] == '\r') len--;
+
+    int count = 0;
+    while (st->pos < len) {
+        size_t base = st->pos;
+        size_t avail = len - base;
+        scan_masks_t m;
+
+        if (avail >= SCAN_BLOCK) {
+            kernel->fn((const uint8_t *)buf + base, &m);
+        } else {
+            // 不足一个块时复制到补零的临时块，超出数据的位随后被屏蔽
+            uint8_t tail[SCAN_BLOCK] = {0};
+            memcpy(tail, buf + base, avail);
+            kernel->fn(tail, &m);
+            uint64_t valid = (1ULL << avail) - 1;
+            m.lf &= valid;
+            m.cr &= valid;
+            m.colon &= valid;
+            m.bad &= valid;
+        }
+
+        // 只有紧跟LF的CR合法（RFC 9112 2.2）；块内最后一个字节之后的LF直接查看下一个字节，
+        // 上面保证了CR之后的字节一定在buf中
+        uint64_t next_lf = m.lf >> 1;
+        if (avail > SCAN_BLOCK && buf[base + SCAN_BLOCK] == '\n') next_lf |= 1ULL << (SCAN_BLOCK - 1);
+        m.bad &= ~(m.cr & next_lf);
+
+        // 逐行处理块内的LF：每行只需一次位运算即可得到行内第一个':'和是否有非法字符
+        unsigned from = 0;
+        for (;;) {
+            uint64_t live = ~0ULL << from;
+            uint64_t lfs = m.lf & live;
+            uint64_t seg = live & (lfs ? (lfs & -lfs) - 1 : ~0ULL);
+
+            if (m.bad & seg) return -1;
+            if (st->colon == SIZE_MAX && (m.colon & seg)) {
+                st->colon = base + (unsigned)__builtin_ctzll(m.colon & seg);
+            }
+            if (!lfs) break;
+
+            unsigned bit = (unsigned)__builtin_ctzll(lfs);
+            size_t pos = base + bit;
+            asm_http_line_t *line = &lines[count++];
+            size_t end = pos;
+            if (end > st->line_start && buf[end - 1] == '\r') end--;
+            line->start = (uint32_t)st->line_start;
+            line->end = (uint32_t)end;
+            line->next = (uint32_t)(pos + 1);
+            line->colon = st->colon < end ? (uint32_t)st->colon : ASM_HTTP_NO_COLON;
+
+            st->line_start = pos + 1;
+            st->colon = SIZE_MAX;
+            st->pos = pos + 1;
+            if (end == line->start || count == max) return count;
+            if (bit == SCAN_BLOCK - 1) break;
+            from = bit + 1;
+        }
+        st->pos = base + (avail >= SCAN_BLOCK ? SCAN_BLOCK : avail);
+    }
+    return count;
+}
@@ -0,0 +1,46 @@
+#ifndef ASM_HTTP_SCAN_H
+#define ASM_HTTP_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// HTTP请求头向量化分词：每次分类64字节，得到LF、':'和非法字符的位掩码，
+// 再按位输出每一行的边界和第一个':'的位置
+// 分类内核在运行时按CPU选择：SVE、NEON、AVX2、SSE4.2，都不支持时使用标量实现
+
+#define ASM_HTTP_NO_COLON UINT32_MAX
+
+// 一个完整的行，偏移相对于扫描的缓冲区起点
+typedef struct {
+    uint32_t start;   // 行首
+    uint32_t end;     // 行尾（不含结尾的CRLF/LF）
+    uint32_t next;    // 下一行的行首
+    uint32_t colon;   // 行内第一个':'，没有时为ASM_HTTP_NO_COLON
+} asm_http_line_t;
+
+// 扫描进度：数据分多次到达时从上次停下的位置继续，已扫描过的字节不再检查
+typedef struct {
+    size_t pos;          // 下一个待分类的字节
+    size_t line_start;   // 当前（未完成）行的行首
+    size_t colon;        // 当前行已出现的第一个':'，没有时为SIZE_MAX
+} asm_http_scan_state_t;
+
+void asm_http_scan_reset(asm_http_scan_state_t *st);
+
+// 从st继续扫描buf[0, len)，把完整的行依次写入lines（最多max个）
+// 输出空行后立即停止（请求头结束）；返回输出的行数，0表示需要更多数据，
+// -1表示遇到非法字符（除HTAB外的控制字符、DEL、不在LF之前的CR）；
+// buf末尾的CR留到更多数据到达后再判断
+int asm_http_scan_lines(asm_http_scan_state_t *st, const char *buf, size_t len,
+                        asm_http_line_t *lines, int max);
+
+// 按CPU特性选择分类内核，asm_opt_init时调用；未调用时首次扫描自动选择
+void asm_http_scan_select(void);
+
+// 当前使用的内核名称（"sve"、"neon"、"avx2"、"sse4.2"、"scalar"）
+const char *asm_http_scan_kernel(void);
+
+// 强制使用指定内核（基准测试用），CPU不支持或名称未知时返回-1
+int asm_http_scan_use(const char *name);
+
+#endif // ASM_HTTP_SCAN_H
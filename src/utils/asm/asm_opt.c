@@ -3,6 +3,7 @@
 #endif
 
 #include "asm_opt.h"
+#include "asm_http_scan.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -437,48 +438,21 @@ void asm_opt_bandwidth_update_tokens(uint64_t* tokens, uint64_t rate, uint64_t i
     #endif
 }
 
-// 优化的HTTP头部解析
+// 查找请求头结束位置（空行之后），基于向量化分词器
 int asm_opt_find_http_header_end(const char* buffer, size_t len) {
-    #ifdef __aarch64__
-    if (len >= 8 && (cpu_features & CPU_FEATURE_NEON)) {
-        // 使用NEON指令快速查找 \r\n\r\n
-        const char* ptr = buffer;
-        size_t remaining = len;
-        
-        while (remaining >= 8) {
-            uint64_t chunk;
-            __asm__ volatile (
-                "ldr %0, [%1]\n\t"
-                : "=r"(chunk) : "r"(ptr) : "memory"
-            );
-            
-            // 检查是否包含 \r\n\r\n 模式
-            if (((chunk & 0xFFFFFFFF) == 0x0A0D0A0D) || // \r\n\r\n
-                ((chunk >> 8) & 0xFFFFFFFF) == 0x0A0D0A0D) {
-                // 找到可能的结束位置，进行精确检查
-                for (int i = 0; i < 8 && (ptr + i + 3) < (buffer + len); i++) {
-                    if (ptr[i] == '\r' && ptr[i+1] == '\n' && 
-                        ptr[i+2] == '\r' && ptr[i+3] == '\n') {
-                        return (ptr + i + 4) - buffer;
-                    }
-                }
-            }
-            
-            ptr += 8;
-            remaining -= 8;
+    asm_http_scan_state_t st;
+    asm_http_line_t lines[16];
+    asm_http_scan_reset(&st);
+
+    for (;;) {
+        int n = asm_http_scan_lines(&st, buffer, len, lines, 16);
+        if (n <= 0) return -1;
+        // 分词器在空行处停止，空行只可能是本批的最后一行
+        const asm_http_line_t *last = &lines[n - 1];
+        if (last->end == last->start && last->start > 0) {
+            return (int)last->next;
         }
     }
-    #endif
-    
-    // 回退到简单搜索
-    for (size_t i = 0; i < len - 3; i++) {
-        if (buffer[i] == '\r' && buffer[i+1] == '\n' && 
-            buffer[i+2] == '\r' && buffer[i+3] == '\n') {
-            return i + 4;
-        }
-    }
-    
-    return -1;
 }
 
 // 性能计数器相关函数
@@ -512,6 +486,11 @@ void asm_opt_perf_counter_print(const asm_opt_perf_counter_t* counter) {
 // 初始化汇编优化模块
 void asm_opt_init(void) {
     detect_cpu_features();
+    asm_http_scan_select();
+
+    char scan_msg[128];
+    snprintf(scan_msg, sizeof(scan_msg), "HTTP header tokenizer kernel: %s", asm_http_scan_kernel());
+    log_message(LOG_LEVEL_INFO, scan_msg);
     
     if (asm_opt_is_supported()) {
         log_message(LOG_LEVEL_INFO, "Assembly optimizations enabled for aarch64");
@@ -868,69 +847,50 @@ int asm_opt_bandwidth_check_limit(uint64_t tokens, uint64_t required) {
 }
 
 int asm_opt_parse_http_header(const char* header, size_t len, char** key, char** value) {
-    #ifdef __aarch64__
     if (!header || len == 0 || !key || !value) {
         return -1;
     }
-    
-    // 使用汇编优化的字符查找
-    const char* colon = asm_opt_strchr(header, ':');
-    if (!colon || colon >= header + len) {
-        return -1;
+
+    // 用分词器定位行尾和第一个':'；最后一行可以不带换行符
+    asm_http_scan_state_t st;
+    asm_http_line_t line;
+    asm_http_scan_reset(&st);
+    int n = asm_http_scan_lines(&st, header, len, &line, 1);
+    if (n < 0) return -1;
+    if (n == 0) {
+        line.start = 0;
+        line.end = (uint32_t)len;
+        line.colon = st.colon < len ? (uint32_t)st.colon : ASM_HTTP_NO_COLON;
     }
-    
-    size_t key_len = colon - header;
-    const char* value_start = colon + 1;
-    
-    // 跳过值前面的空格
-    while (value_start < header + len && (*value_start == ' ' || *value_start == '\t')) {
+    if (line.colon == ASM_HTTP_NO_COLON) return -1;
+
+    const char* value_start = header + line.colon + 1;
+    const char* value_end = header + line.end;
+
+    // 去掉值两端的空格
+    while (value_start < value_end && (*value_start == ' ' || *value_start == '\t')) {
         value_start++;
     }
-    
-    // 查找值的结束位置（\r\n或\n）
-    const char* value_end = value_start;
-    while (value_end < header + len && *value_end != '\r' && *value_end != '\n') {
-        value_end++;
-    }
-    
-    // 去掉值末尾的空格
     while (value_end > value_start && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
         value_end--;
     }
-    
+
+    size_t key_len = line.colon;
     size_t value_len = value_end - value_start;
-    
-    // 使用标准内存分配
     *key = malloc(key_len + 1);
     *value = malloc(value_len + 1);
-    
     if (!*key || !*value) {
-        if (*key) {
-            free(*key);
-        }
-        if (*value) {
-            free(*value);
-        }
+        free(*key);
+        free(*value);
+        *key = NULL;
+        *value = NULL;
         return -1;
     }
-    
-    // 使用汇编优化的内存拷贝
-    asm_opt_memcpy(*key, header, key_len);
+
+    memcpy(*key, header, key_len);
     (*key)[key_len] = '\0';
-    
-    asm_opt_memcpy(*value, value_start, value_len);
+    memcpy(*value, value_start, value_len);
     (*value)[value_len] = '\0';
-    
-    return 0;
-    #endif
-    
-    // 简单实现，后续可以优化
-    const char* colon_fallback = strchr(header, ':');
-    if (!colon_fallback) return -1;
-    
-    *key = strndup(header, colon_fallback - header);
-    *value = strndup(colon_fallback + 1, len - (colon_fallback + 1 - header));
-    
     return 0;
 }
 
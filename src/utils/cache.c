@@ -169,7 +169,9 @@ static void cache_entry_free(cache_entry_t *entry) {
     free(entry->key);
     free(entry->etag);
     free(entry->content_type);
-    free(entry->content);
+    for (int i = 0; i < CACHE_VARIANT_COUNT; i++) {
+        free(entry->variants[i].content);
+    }
     free(entry);
 }
 
@@ -284,14 +286,8 @@ static void cache_remove_from_list(cache_manager_t *manager, cache_entry_t *entr
     }
 }
 
-// 将条目移到LRU链表头部
-static void cache_move_to_head(cache_manager_t *manager, cache_entry_t *entry) {
-    if (manager->head == entry) return;
-    
-    // 从当前位置移除
-    cache_remove_from_list(manager, entry);
-    
-    // 添加到头部
+// 将不在链表中的条目添加到LRU链表头部
+static void cache_add_to_head(cache_manager_t *manager, cache_entry_t *entry) {
     entry->lru_prev = NULL;
     entry->lru_next = manager->head;
     
@@ -305,6 +301,17 @@ static void cache_move_to_head(cache_manager_t *manager, cache_entry_t *entry) {
     }
 }
 
+// 将条目移到LRU链表头部
+static void cache_move_to_head(cache_manager_t *manager, cache_entry_t *entry) {
+    if (manager->head == entry) return;
+    
+    // 从当前位置移除
+    cache_remove_from_list(manager, entry);
+    
+    // 添加到头部
+    cache_add_to_head(manager, entry);
+}
+
 // 查找缓存条目
 static cache_entry_t *cache_find_entry(cache_manager_t *manager, const char *key) {
     unsigned int hash = hash_string(key) % manager->hash_size;
@@ -320,24 +327,56 @@ static cache_entry_t *cache_find_entry(cache_manager_t *manager, const char *key
     return NULL;
 }
 
+// 从哈希表和LRU链表中移除条目并释放，调用者持有锁
+static void cache_unlink_entry(cache_manager_t *manager, cache_entry_t *entry) {
+    cache_entry_t **link = &manager->hash_table[hash_string(entry->key) % manager->hash_size];
+    while (*link && *link != entry) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = entry->hash_next;
+    }
+    
+    cache_remove_from_list(manager, entry);
+    
+    manager->stats.current_entries--;
+    manager->stats.current_size -= entry->content_length;
+    cache_entry_free(entry);
+}
+
+// 驱逐LRU链表尾部的条目，调用者持有锁
+static void cache_evict_tail(cache_manager_t *manager) {
+    cache_unlink_entry(manager, manager->tail);
+    manager->stats.evictions++;
+}
+
 // 获取缓存
-cache_response_t *cache_get(cache_manager_t *manager, const char *key, 
+cache_response_t *cache_get(cache_manager_t *manager, const char *key, cache_variant_t variant,
                            const char *if_none_match, time_t if_modified_since) {
-    if (!manager || !key) return NULL;
+    if (!manager || !key || variant < 0 || variant >= CACHE_VARIANT_COUNT) return NULL;
     
     pthread_mutex_lock(&manager->mutex);
     
     cache_entry_t *entry = cache_find_entry(manager, key);
+    
+    // 检查是否过期，过期则从缓存中移除
+    if (entry && !cache_is_fresh(entry)) {
+        cache_unlink_entry(manager, entry);
+        entry = NULL;
+    }
     if (!entry) {
         manager->stats.misses++;
         pthread_mutex_unlock(&manager->mutex);
         return NULL;
     }
     
-    // 检查是否过期
-    if (!cache_is_fresh(entry)) {
-        // 过期，从缓存中移除
-        cache_remove(manager, key);
+    // 条件请求只看共享的元数据
+    bool not_modified = (if_none_match && entry->etag &&
+                         cache_validate_etag(entry->etag, if_none_match)) ||
+                        (if_modified_since > 0 &&
+                         cache_validate_modified_since(entry->last_modified, if_modified_since));
+    const cache_body_t *body = &entry->variants[variant];
+    if (!not_modified && !body->content) {
         manager->stats.misses++;
         pthread_mutex_unlock(&manager->mutex);
         return NULL;
@@ -357,37 +396,25 @@ cache_response_t *cache_get(cache_manager_t *manager, const char *key,
     
     response->is_cached = true;
     response->is_fresh = true;
+    response->last_modified = entry->last_modified;
     
-    // 检查条件请求
-    if (if_none_match && entry->etag) {
-        if (cache_validate_etag(entry->etag, if_none_match)) {
-            response->needs_validation = true;
-            manager->stats.hits++;
-            pthread_mutex_unlock(&manager->mutex);
-            return response;
-        }
-    }
-    
-    if (if_modified_since > 0) {
-        if (cache_validate_modified_since(entry->last_modified, if_modified_since)) {
-            response->needs_validation = true;
-            manager->stats.hits++;
-            pthread_mutex_unlock(&manager->mutex);
-            return response;
-        }
+    if (not_modified) {
+        response->needs_validation = true;
+        manager->stats.hits++;
+        pthread_mutex_unlock(&manager->mutex);
+        return response;
     }
     
     // 复制缓存数据
-    response->content = malloc(entry->content_length);
+    response->content = malloc(body->length ? body->length : 1);
     if (response->content) {
-        memcpy(response->content, entry->content, entry->content_length);
-        response->content_length = entry->content_length;
+        memcpy(response->content, body->content, body->length);
+        response->content_length = body->length;
     }
     
     response->content_type = entry->content_type ? strdup(entry->content_type) : NULL;
     response->etag = entry->etag ? strdup(entry->etag) : NULL;
-    response->last_modified = entry->last_modified;
-    response->is_compressed = entry->is_compressed;
+    response->variant = variant;
     
     manager->stats.hits++;
     manager->stats.hit_ratio = (double)manager->stats.hits / 
@@ -399,67 +426,98 @@ cache_response_t *cache_get(cache_manager_t *manager, const char *key,
 
 // LRU驱逐
 void cache_evict_lru(cache_manager_t *manager) {
-    if (!manager || !manager->tail) return;
+    if (!manager) return;
     
-    cache_entry_t *victim = manager->tail;
-    cache_remove(manager, victim->key);
-    manager->stats.evictions++;
+    pthread_mutex_lock(&manager->mutex);
+    if (manager->tail) {
+        cache_evict_tail(manager);
+    }
+    pthread_mutex_unlock(&manager->mutex);
+}
+
+// 写入后是否超过条目数或总大小的上限；replaced为被替换的同一表示形式的长度
+static bool cache_put_exceeds(cache_manager_t *manager, bool new_entry, size_t replaced,
+                              size_t content_length) {
+    return (new_entry && manager->stats.current_entries >= manager->config->max_entries) ||
+           manager->stats.current_size - replaced + content_length > manager->config->max_size;
 }
 
 // 存储到缓存
-int cache_put(cache_manager_t *manager, const char *key, const char *content,
-              size_t content_length, const char *content_type, 
-              time_t last_modified, int ttl, bool is_compressed) {
-    if (!manager || !key || !content) return -1;
+int cache_put(cache_manager_t *manager, const char *key, cache_variant_t variant,
+              const char *content, size_t content_length, const char *content_type,
+              const char *etag, time_t last_modified, int ttl) {
+    if (!manager || !key || !content || variant < 0 || variant >= CACHE_VARIANT_COUNT) return -1;
     
     pthread_mutex_lock(&manager->mutex);
     
-    // 检查是否需要驱逐
-    while (manager->stats.current_entries >= manager->config->max_entries ||
-           manager->stats.current_size + content_length > manager->config->max_size) {
-        cache_evict_lru(manager);
+    // 文件已修改或条目已过期时，旧的表示形式全部作废
+    cache_entry_t *entry = cache_find_entry(manager, key);
+    if (entry && (entry->last_modified != last_modified || !cache_is_fresh(entry))) {
+        cache_unlink_entry(manager, entry);
+        entry = NULL;
+    }
+    if (entry) {
+        cache_move_to_head(manager, entry);
     }
     
-    // 创建新条目
-    cache_entry_t *entry = calloc(1, sizeof(cache_entry_t));
-    if (!entry) {
+    // 检查是否需要驱逐；正在写入的条目已在链表头部，不会被驱逐
+    size_t replaced = entry ? entry->variants[variant].length : 0;
+    while (cache_put_exceeds(manager, !entry, replaced, content_length) && manager->tail &&
+           manager->tail != entry) {
+        cache_evict_tail(manager);
+    }
+    if (cache_put_exceeds(manager, !entry, replaced, content_length)) {
         pthread_mutex_unlock(&manager->mutex);
         return -1;
     }
     
-    entry->key = strdup(key);
-    entry->content = malloc(content_length);
-    if (!entry->content) {
-        cache_entry_free(entry);
+    char *copy = malloc(content_length ? content_length : 1);
+    if (!copy) {
         pthread_mutex_unlock(&manager->mutex);
         return -1;
     }
+    memcpy(copy, content, content_length);
     
-    memcpy(entry->content, content, content_length);
-    entry->content_length = content_length;
-    entry->content_type = content_type ? strdup(content_type) : NULL;
-    entry->last_modified = last_modified;
-    entry->last_access = time(NULL);
-    entry->expires = time(NULL) + (ttl > 0 ? ttl : manager->config->default_ttl);
-    entry->access_count = 1;
-    entry->is_compressed = is_compressed;
-    
-    // 生成ETag
-    if (manager->config->enable_etag) {
-        entry->etag = cache_generate_etag(key, last_modified, content_length);
-    }
-    
-    // 添加到哈希表
-    unsigned int hash = hash_string(key) % manager->hash_size;
-    entry->hash_next = manager->hash_table[hash];
-    manager->hash_table[hash] = entry;
-    
-    // 添加到LRU链表头部
-    cache_move_to_head(manager, entry);
+    // 创建新条目
+    if (!entry) {
+        entry = calloc(1, sizeof(cache_entry_t));
+        if (!entry || !(entry->key = strdup(key))) {
+            free(entry);
+            free(copy);
+            pthread_mutex_unlock(&manager->mutex);
+            return -1;
+        }
+        
+        entry->content_type = content_type ? strdup(content_type) : NULL;
+        entry->last_modified = last_modified;
+        entry->last_access = time(NULL);
+        entry->expires = time(NULL) + (ttl > 0 ? ttl : manager->config->default_ttl);
+        entry->access_count = 1;
+        
+        // 生成ETag
+        if (manager->config->enable_etag) {
+            entry->etag = etag ? strdup(etag) : cache_generate_etag(key, last_modified, content_length);
+        }
+        
+        // 添加到哈希表
+        unsigned int hash = hash_string(key) % manager->hash_size;
+        entry->hash_next = manager->hash_table[hash];
+        manager->hash_table[hash] = entry;
+        
+        // 添加到LRU链表头部
+        cache_add_to_head(manager, entry);
+        manager->stats.current_entries++;
+    }
+    
+    // 添加或替换该表示形式
+    cache_body_t *body = &entry->variants[variant];
+    free(body->content);
+    body->content = copy;
+    body->length = content_length;
+    entry->content_length = entry->content_length - replaced + content_length;
     
     // 更新统计
-    manager->stats.current_entries++;
-    manager->stats.current_size += content_length;
+    manager->stats.current_size = manager->stats.current_size - replaced + content_length;
     
     pthread_mutex_unlock(&manager->mutex);
     return 0;
@@ -471,36 +529,13 @@ int cache_remove(cache_manager_t *manager, const char *key) {
     
     pthread_mutex_lock(&manager->mutex);
     
-    unsigned int hash = hash_string(key) % manager->hash_size;
-    cache_entry_t *entry = manager->hash_table[hash];
-    cache_entry_t *prev = NULL;
-    
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            // 从哈希表中移除
-            if (prev) {
-                prev->hash_next = entry->hash_next;
-            } else {
-                manager->hash_table[hash] = entry->hash_next;
-            }
-            
-            // 从LRU链表中移除
-            cache_remove_from_list(manager, entry);
-            
-            // 更新统计
-            manager->stats.current_entries--;
-            manager->stats.current_size -= entry->content_length;
-            
-            cache_entry_free(entry);
-            pthread_mutex_unlock(&manager->mutex);
-            return 0;
-        }
-        prev = entry;
-        entry = entry->hash_next;
+    cache_entry_t *entry = cache_find_entry(manager, key);
+    if (entry) {
+        cache_unlink_entry(manager, entry);
     }
     
     pthread_mutex_unlock(&manager->mutex);
-    return -1;
+    return entry ? 0 : -1;
 }
 
 // 创建缓存响应
@@ -566,7 +601,7 @@ void cache_cleanup_expired(cache_manager_t *manager) {
     while (current) {
         cache_entry_t *next = current->lru_next;
         if (now >= current->expires) {
-            cache_remove(manager, current->key);
+            cache_unlink_entry(manager, current);
         }
         current = next;
     }
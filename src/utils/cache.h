@@ -13,6 +13,22 @@ typedef enum {
     CACHE_STRATEGY_FIFO    // 先进先出
 } cache_strategy_t;
 
+// 缓存的表示形式：同一个键的原文和各压缩编码的内容分别存储，共享ETag、Last-Modified等元数据
+// 顺序与compress_encoding_t对应，原文对应COMPRESS_ENCODING_NONE
+typedef enum {
+    CACHE_VARIANT_IDENTITY = 0,
+    CACHE_VARIANT_GZIP,
+    CACHE_VARIANT_BR,
+    CACHE_VARIANT_ZSTD,
+    CACHE_VARIANT_COUNT
+} cache_variant_t;
+
+// 一种表示形式的内容
+typedef struct {
+    char *content;                // 未缓存时为NULL
+    size_t length;
+} cache_body_t;
+
 // 缓存条目结构
 typedef struct cache_entry {
     char *key;                    // 缓存键（通常是文件路径）
@@ -21,10 +37,9 @@ typedef struct cache_entry {
     time_t expires;               // 过期时间
     time_t last_access;           // 最后访问时间
     size_t access_count;          // 访问次数
-    size_t content_length;        // 内容长度
+    size_t content_length;        // 各表示形式的内容总长度
     char *content_type;           // 内容类型
-    char *content;                // 缓存内容
-    bool is_compressed;           // 是否已压缩
+    cache_body_t variants[CACHE_VARIANT_COUNT]; // 按表示形式存储的内容
     struct cache_entry *lru_next; // LRU链表指针
     struct cache_entry *lru_prev; // LRU双向链表指针
     struct cache_entry *hash_next; // 哈希表链表指针
@@ -76,7 +91,7 @@ typedef struct {
     char *content;                // 内容
     size_t content_length;        // 内容长度
     char *content_type;           // 内容类型
-    bool is_compressed;           // 是否已压缩
+    cache_variant_t variant;      // 内容的表示形式
 } cache_response_t;
 
 // 缓存配置函数
@@ -91,11 +106,15 @@ void cache_manager_free(cache_manager_t *manager);
 void cache_manager_clear(cache_manager_t *manager);
 
 // 缓存操作函数
-cache_response_t *cache_get(cache_manager_t *manager, const char *key, 
+// 条件请求只比较共享的元数据，命中时不要求该表示形式已缓存；
+// 否则只有variant已缓存时才命中，条目存在但缺少该表示形式按未命中处理
+cache_response_t *cache_get(cache_manager_t *manager, const char *key, cache_variant_t variant,
                            const char *if_none_match, time_t if_modified_since);
-int cache_put(cache_manager_t *manager, const char *key, const char *content,
-              size_t content_length, const char *content_type, 
-              time_t last_modified, int ttl, bool is_compressed);
+// 存储key的一种表示形式；条目已存在且last_modified相同时只添加或替换该表示形式，
+// 不同时（文件已修改）丢弃旧的全部表示形式。etag为NULL时按键、修改时间和长度生成
+int cache_put(cache_manager_t *manager, const char *key, cache_variant_t variant,
+              const char *content, size_t content_length, const char *content_type,
+              const char *etag, time_t last_modified, int ttl);
 int cache_remove(cache_manager_t *manager, const char *key);
 bool cache_is_fresh(cache_entry_t *entry);
 
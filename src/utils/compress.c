@@ -4,12 +4,54 @@
 
 #include "compress.h"
 #include "log.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+
+#ifdef ANX_WITH_BROTLI
+#include <brotli/encode.h>
+#endif
+#ifdef ANX_WITH_ZSTD
+#include <zstd.h>
+#endif
 
 #define DEFAULT_BUFFER_SIZE (64 * 1024)  // 64KB
 #define DEFAULT_MIN_LENGTH 1024          // 1KB
 #define MAX_MIME_TYPES 50               // 最大MIME类型数量
+#define DEFAULT_POOL_SIZE (4 * 1024 * 1024)  // 4MB
+#define GZIP_WINDOW_BITS 31              // 15 + 16 for gzip
+#define DEFLATE_MEM_LEVEL 8
+#define POOL_KEYS 8                      // 池中不同(编码, 级别, 窗口, 缓冲区大小)的数量上限
+#define MIN_WINDOW_BITS 10               // br和zstd窗口的下限
+#define MAX_WINDOW_BITS 22               // br和zstd窗口的上限（br的默认窗口）
+
+static const char *const encoding_names[COMPRESS_ENCODING_COUNT] = { "gzip", "br", "zstd" };
+
+// 实时压缩的默认级别：br和zstd取压缩速度与gzip 6相当的级别
+static const int default_levels[COMPRESS_ENCODING_COUNT] = { COMPRESS_LEVEL_DEFAULT, 4, 3 };
+// 离线级别：各编码的高压缩率级别
+static const int default_offline_levels[COMPRESS_ENCODING_COUNT] = { COMPRESS_LEVEL_BEST, 11, 19 };
+
+// 没有匹配的优先顺序时：压缩率从高到低
+static const compress_order_t default_order = {
+    "*", { COMPRESS_ENCODING_BR, COMPRESS_ENCODING_ZSTD, COMPRESS_ENCODING_GZIP }, 3
+};
+
+// 一种上下文的空闲链表
+typedef struct {
+    compress_encoding_t encoding;
+    int level;
+    int window_bits;
+    size_t buffer_size;
+    compress_context_t *head;
+} pool_slot_t;
+
+// 上下文池（每个worker进程一份）
+static pool_slot_t pool_slots[POOL_KEYS];
+static int pool_slot_count = 0;
+static size_t pool_max_bytes = 0;
+static compress_pool_stats_t pool_stats;
 
 // 创建压缩配置
 compress_config_t *compress_config_create(void) {
@@ -21,10 +63,13 @@ compress_config_t *compress_config_create(void) {
     
     // 设置默认值
     config->enable_compression = true;
-    config->level = COMPRESS_LEVEL_DEFAULT;
+    config->encodings[COMPRESS_ENCODING_GZIP] = true;
+    memcpy(config->levels, default_levels, sizeof(config->levels));
+    memcpy(config->offline_levels, default_offline_levels, sizeof(config->offline_levels));
     config->min_length = DEFAULT_MIN_LENGTH;
     config->compression_buffer_size = DEFAULT_BUFFER_SIZE;
     config->enable_vary = true;
+    config->pool_size = DEFAULT_POOL_SIZE;
     
     // 分配MIME类型数组
     config->mime_types = calloc(MAX_MIME_TYPES, sizeof(char *));
@@ -58,6 +103,9 @@ void compress_config_free(compress_config_t *config) {
         }
         free(config->mime_types);
     }
+    for (int i = 0; i < config->order_count; i++) {
+        free(config->orders[i].mime_prefix);
+    }
     
     free(config);
 }
@@ -98,9 +146,200 @@ bool should_compress_mime_type(compress_config_t *config, const char *mime_type)
     return false;
 }
 
+// 添加编码优先顺序
+int compress_config_add_order(compress_config_t *config, const char *value) {
+    if (!config || !value) return -1;
+
+    char *copy = strdup(value);
+    if (!copy) return -1;
+    char *saveptr = NULL;
+    char *mime = strtok_r(copy, " ", &saveptr);
+    if (!mime) {
+        free(copy);
+        return -1;
+    }
+
+    compress_order_t order = { NULL, { 0 }, 0 };
+    char *name;
+    while ((name = strtok_r(NULL, " ", &saveptr))) {
+        compress_encoding_t encoding = compress_encoding_from_name(name);
+        if (encoding == COMPRESS_ENCODING_NONE || order.count == COMPRESS_ENCODING_COUNT) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Ignoring encoding '%s' in compress_order", name);
+            log_message(LOG_LEVEL_WARNING, msg);
+            continue;
+        }
+        order.order[order.count++] = encoding;
+    }
+
+    compress_order_t *slot = NULL;
+    for (int i = 0; i < config->order_count; i++) {
+        if (strcmp(config->orders[i].mime_prefix, mime) == 0) {
+            slot = &config->orders[i];
+            free(slot->mime_prefix);
+            break;
+        }
+    }
+    if (!slot) {
+        if (config->order_count >= COMPRESS_MAX_ORDERS) {
+            free(copy);
+            return -1;
+        }
+        slot = &config->orders[config->order_count++];
+    }
+
+    order.mime_prefix = strdup(mime);
+    free(copy);
+    *slot = order;
+    return slot->mime_prefix ? 0 : -1;
+}
+
+compress_encoding_t compress_encoding_from_name(const char *name) {
+    for (int i = 0; i < COMPRESS_ENCODING_COUNT; i++) {
+        if (strcasecmp(name, encoding_names[i]) == 0) return (compress_encoding_t)i;
+    }
+    return COMPRESS_ENCODING_NONE;
+}
+
+const char *compress_encoding_name(compress_encoding_t encoding) {
+    if (encoding < 0 || encoding >= COMPRESS_ENCODING_COUNT) return "identity";
+    return encoding_names[encoding];
+}
+
+bool compress_encoding_supported(compress_encoding_t encoding) {
+    switch (encoding) {
+    case COMPRESS_ENCODING_GZIP:
+        return true;
+#ifdef ANX_WITH_BROTLI
+    case COMPRESS_ENCODING_BR:
+        return true;
+#endif
+#ifdef ANX_WITH_ZSTD
+    case COMPRESS_ENCODING_ZSTD:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+int compress_level(const compress_config_t *config, compress_encoding_t encoding,
+                   compress_profile_t profile) {
+    if (profile == COMPRESS_PROFILE_OFFLINE && config->use_offline_levels) {
+        return config->offline_levels[encoding];
+    }
+    return config->levels[encoding];
+}
+
+// br和zstd的窗口按输入大小选择：窗口小于输入时远处的重复内容无法匹配，压缩率明显下降；
+// 大于输入只增加内存（br 11级的匹配树按窗口分配，22位窗口时超过30MB）
+// - input_size为0（流式压缩，总长度未知）使用上限22位
+// - 不超过一个缓冲区的输入统一使用缓冲区大小的窗口，池中的上下文可以互相复用
+// - 更大的文件（预压缩文件、缓存预热）取min(文件大小, 2^22)
+static int encoder_window_bits(compress_encoding_t encoding, size_t input_size,
+                               size_t buffer_size) {
+    if (encoding == COMPRESS_ENCODING_GZIP) return GZIP_WINDOW_BITS;
+    if (input_size == 0) return MAX_WINDOW_BITS;
+    size_t size = input_size > buffer_size ? input_size : buffer_size;
+    int bits = MIN_WINDOW_BITS;
+    while (bits < MAX_WINDOW_BITS && ((size_t)1 << bits) < size) bits++;
+    return bits;
+}
+
+// 初始化编码器；br没有重置接口，归还上下文时也用它重建编码器
+static int encoder_init(compress_context_t *ctx) {
+    switch (ctx->encoding) {
+    case COMPRESS_ENCODING_GZIP:
+        ctx->stream.zalloc = Z_NULL;
+        ctx->stream.zfree = Z_NULL;
+        ctx->stream.opaque = Z_NULL;
+        return deflateInit2(&ctx->stream, ctx->level, Z_DEFLATED, ctx->window_bits,
+                            DEFLATE_MEM_LEVEL, Z_DEFAULT_STRATEGY) == Z_OK ? 0 : -1;
+#ifdef ANX_WITH_BROTLI
+    case COMPRESS_ENCODING_BR: {
+        BrotliEncoderState *state = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+        if (!state) return -1;
+        BrotliEncoderSetParameter(state, BROTLI_PARAM_QUALITY, (uint32_t)ctx->level);
+        BrotliEncoderSetParameter(state, BROTLI_PARAM_LGWIN, (uint32_t)ctx->window_bits);
+        ctx->encoder = state;
+        return 0;
+    }
+#endif
+#ifdef ANX_WITH_ZSTD
+    case COMPRESS_ENCODING_ZSTD: {
+        ZSTD_CCtx *cctx = ZSTD_createCCtx();
+        if (!cctx) return -1;
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, ctx->level);
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog, ctx->window_bits);
+        ctx->encoder = cctx;
+        return 0;
+    }
+#endif
+    default:
+        return -1;
+    }
+}
+
+static void encoder_end(compress_context_t *ctx) {
+    switch (ctx->encoding) {
+    case COMPRESS_ENCODING_GZIP:
+        deflateEnd(&ctx->stream);
+        break;
+#ifdef ANX_WITH_BROTLI
+    case COMPRESS_ENCODING_BR:
+        BrotliEncoderDestroyInstance(ctx->encoder);
+        break;
+#endif
+#ifdef ANX_WITH_ZSTD
+    case COMPRESS_ENCODING_ZSTD:
+        ZSTD_freeCCtx(ctx->encoder);
+        break;
+#endif
+    default:
+        break;
+    }
+    ctx->encoder = NULL;
+}
+
+static int encoder_reset(compress_context_t *ctx) {
+    switch (ctx->encoding) {
+    case COMPRESS_ENCODING_GZIP:
+        return deflateReset(&ctx->stream) == Z_OK ? 0 : -1;
+#ifdef ANX_WITH_ZSTD
+    case COMPRESS_ENCODING_ZSTD:
+        return ZSTD_isError(ZSTD_CCtx_reset(ctx->encoder, ZSTD_reset_session_only)) ? -1 : 0;
+#endif
+    default:
+        encoder_end(ctx);
+        if (encoder_init(ctx) < 0) {
+            ctx->initialized = false;
+            return -1;
+        }
+        return 0;
+    }
+}
+
+// 估计编码器内部状态占用的内存
+static size_t encoder_memory(const compress_context_t *ctx) {
+    switch (ctx->encoding) {
+    case COMPRESS_ENCODING_GZIP:
+        // deflate的内部状态约为(1 << (windowBits + 2)) + (1 << (memLevel + 9))
+        return ((size_t)1 << (15 + 2)) + ((size_t)1 << (DEFLATE_MEM_LEVEL + 9));
+#ifdef ANX_WITH_ZSTD
+    case COMPRESS_ENCODING_ZSTD:
+        // 重置后保留已分配的工作区
+        return ZSTD_sizeof_CCtx(ctx->encoder);
+#endif
+    default:
+        // 重建的br编码器在第一次压缩时才分配内部表
+        return 0;
+    }
+}
+
 // 创建压缩上下文
-compress_context_t *compress_context_create(compress_config_t *config) {
-    if (!config) return NULL;
+compress_context_t *compress_context_create(compress_config_t *config, compress_encoding_t encoding,
+                                            int level, size_t input_size) {
+    if (!config || !compress_encoding_supported(encoding)) return NULL;
     
     compress_context_t *ctx = calloc(1, sizeof(compress_context_t));
     if (!ctx) {
@@ -108,7 +347,10 @@ compress_context_t *compress_context_create(compress_config_t *config) {
         return NULL;
     }
     
+    ctx->encoding = encoding;
     ctx->buffer_size = config->compression_buffer_size;
+    ctx->level = level;
+    ctx->window_bits = encoder_window_bits(encoding, input_size, ctx->buffer_size);
     
     // 分配缓冲区
     ctx->in_buffer = malloc(ctx->buffer_size);
@@ -120,21 +362,16 @@ compress_context_t *compress_context_create(compress_config_t *config) {
         return NULL;
     }
     
-    // 初始化zlib流
-    ctx->stream.zalloc = Z_NULL;
-    ctx->stream.zfree = Z_NULL;
-    ctx->stream.opaque = Z_NULL;
-    
-    if (deflateInit2(&ctx->stream, config->level, Z_DEFLATED, 
-                     31, // 15 + 16 for gzip
-                     8,  // 默认内存级别
-                     Z_DEFAULT_STRATEGY) != Z_OK) {
-        log_message(LOG_LEVEL_ERROR, "Failed to initialize zlib stream");
+    if (encoder_init(ctx) < 0) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Failed to initialize %s encoder", encoding_names[encoding]);
+        log_message(LOG_LEVEL_ERROR, msg);
         compress_context_free(ctx);
         return NULL;
     }
     
     ctx->initialized = true;
+    ctx->memory = sizeof(*ctx) + encoder_memory(ctx) + 2 * ctx->buffer_size;
     return ctx;
 }
 
@@ -143,7 +380,7 @@ void compress_context_free(compress_context_t *ctx) {
     if (!ctx) return;
     
     if (ctx->initialized) {
-        deflateEnd(&ctx->stream);
+        encoder_end(ctx);
     }
     
     free(ctx->in_buffer);
@@ -151,42 +388,264 @@ void compress_context_free(compress_context_t *ctx) {
     free(ctx);
 }
 
+static pool_slot_t *pool_find(compress_encoding_t encoding, int level, int window_bits,
+                              size_t buffer_size) {
+    for (int i = 0; i < pool_slot_count; i++) {
+        pool_slot_t *slot = &pool_slots[i];
+        if (slot->encoding == encoding && slot->level == level &&
+            slot->window_bits == window_bits && slot->buffer_size == buffer_size) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+void compress_pool_init(size_t max_bytes) {
+    compress_pool_destroy();
+    pool_max_bytes = max_bytes;
+    memset(&pool_stats, 0, sizeof(pool_stats));
+}
+
+void compress_pool_destroy(void) {
+    if (pool_stats.hits || pool_stats.misses) {
+        char msg[160];
+        snprintf(msg, sizeof(msg),
+                 "Compression context pool: %llu hits, %llu misses, %llu discarded",
+                 (unsigned long long)pool_stats.hits, (unsigned long long)pool_stats.misses,
+                 (unsigned long long)pool_stats.discards);
+        log_message(LOG_LEVEL_INFO, msg);
+    }
+    for (int i = 0; i < pool_slot_count; i++) {
+        while (pool_slots[i].head) {
+            compress_context_t *ctx = pool_slots[i].head;
+            pool_slots[i].head = ctx->pool_next;
+            compress_context_free(ctx);
+        }
+    }
+    pool_slot_count = 0;
+    pool_stats.pooled = 0;
+    pool_stats.pooled_bytes = 0;
+}
+
+compress_context_t *compress_context_acquire(compress_config_t *config, compress_encoding_t encoding,
+                                             compress_profile_t profile, size_t input_size) {
+    if (!config || !compress_encoding_supported(encoding)) return NULL;
+
+    int level = compress_level(config, encoding, profile);
+    int window_bits = encoder_window_bits(encoding, input_size, config->compression_buffer_size);
+    pool_slot_t *slot = pool_find(encoding, level, window_bits, config->compression_buffer_size);
+    if (slot && slot->head) {
+        compress_context_t *ctx = slot->head;
+        slot->head = ctx->pool_next;
+        ctx->pool_next = NULL;
+        pool_stats.hits++;
+        pool_stats.pooled--;
+        pool_stats.pooled_bytes -= ctx->memory;
+        return ctx;
+    }
+
+    pool_stats.misses++;
+    return compress_context_create(config, encoding, level, input_size);
+}
+
+void compress_context_release(compress_context_t *ctx) {
+    if (!ctx) return;
+
+    pool_slot_t *slot = NULL;
+    if (ctx->initialized && encoder_reset(ctx) == 0) {
+        // zstd重置后保留用过的工作区，br重建后内部表尚未分配，重新估计内存
+        ctx->memory = sizeof(*ctx) + encoder_memory(ctx) + 2 * ctx->buffer_size;
+        if (pool_stats.pooled_bytes + ctx->memory <= pool_max_bytes) {
+            slot = pool_find(ctx->encoding, ctx->level, ctx->window_bits, ctx->buffer_size);
+            if (!slot && pool_slot_count < POOL_KEYS) {
+                slot = &pool_slots[pool_slot_count++];
+                slot->encoding = ctx->encoding;
+                slot->level = ctx->level;
+                slot->window_bits = ctx->window_bits;
+                slot->buffer_size = ctx->buffer_size;
+                slot->head = NULL;
+            }
+        }
+    }
+    if (!slot) {
+        pool_stats.discards++;
+        compress_context_free(ctx);
+        return;
+    }
+
+    ctx->pool_next = slot->head;
+    slot->head = ctx;
+    pool_stats.pooled++;
+    pool_stats.pooled_bytes += ctx->memory;
+}
+
+void compress_pool_get_stats(compress_pool_stats_t *stats) {
+    *stats = pool_stats;
+}
+
 // 压缩数据块
 int compress_data(compress_context_t *ctx, const void *in, size_t in_len,
                  void *out, size_t *out_len, int flush) {
     if (!ctx || !ctx->initialized) return -1;
     
-    ctx->stream.next_in = (Bytef *)in;
-    ctx->stream.avail_in = in_len;
-    ctx->stream.next_out = out;
-    ctx->stream.avail_out = *out_len;
+    int ret;
+    switch (ctx->encoding) {
+    case COMPRESS_ENCODING_GZIP:
+        ctx->stream.next_in = (Bytef *)in;
+        ctx->stream.avail_in = in_len;
+        ctx->stream.next_out = out;
+        ctx->stream.avail_out = *out_len;
+        
+        ret = deflate(&ctx->stream, flush);
+        if (ret < 0) break;
+        
+        ctx->avail_in = ctx->stream.avail_in;
+        *out_len = *out_len - ctx->stream.avail_out;
+        break;
+#ifdef ANX_WITH_BROTLI
+    case COMPRESS_ENCODING_BR: {
+        size_t avail_in = in_len;
+        const uint8_t *next_in = in;
+        size_t avail_out = *out_len;
+        uint8_t *next_out = out;
+        BrotliEncoderOperation op = flush == Z_FINISH ? BROTLI_OPERATION_FINISH
+                                                      : BROTLI_OPERATION_PROCESS;
+        if (!BrotliEncoderCompressStream(ctx->encoder, op, &avail_in, &next_in, &avail_out,
+                                         &next_out, NULL)) {
+            ret = Z_STREAM_ERROR;
+            break;
+        }
+        ctx->avail_in = avail_in;
+        *out_len = *out_len - avail_out;
+        ret = BrotliEncoderIsFinished(ctx->encoder) ? Z_STREAM_END : Z_OK;
+        break;
+    }
+#endif
+#ifdef ANX_WITH_ZSTD
+    case COMPRESS_ENCODING_ZSTD: {
+        ZSTD_inBuffer input = { in, in_len, 0 };
+        ZSTD_outBuffer output = { out, *out_len, 0 };
+        size_t remaining = ZSTD_compressStream2(ctx->encoder, &output, &input,
+                                                flush == Z_FINISH ? ZSTD_e_end : ZSTD_e_continue);
+        if (ZSTD_isError(remaining)) {
+            ret = Z_STREAM_ERROR;
+            break;
+        }
+        ctx->avail_in = in_len - input.pos;
+        *out_len = output.pos;
+        ret = flush == Z_FINISH && remaining == 0 ? Z_STREAM_END : Z_OK;
+        break;
+    }
+#endif
+    default:
+        ret = Z_STREAM_ERROR;
+        break;
+    }
     
-    int ret = deflate(&ctx->stream, flush);
     if (ret < 0) {
         log_message(LOG_LEVEL_ERROR, "Compression failed");
-        return ret;
     }
-    
-    *out_len = *out_len - ctx->stream.avail_out;
     return ret;
 }
 
-// 检查客户端是否支持压缩
-bool client_accepts_compression(const char *accept_encoding) {
-    if (!accept_encoding) return false;
-    
-    // 检查是否支持gzip
-    return (strstr(accept_encoding, "gzip") != NULL);
+static int is_ows(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// 解析q值（"1"、"0.5"、"0.125"），返回0-1000；格式不对时按1处理
+static int parse_qvalue(const char *p, const char *end) {
+    while (end > p && is_ows(end[-1])) end--;
+    if (p >= end || (*p != '0' && *p != '1')) return 1000;
+    int q = (*p - '0') * 1000;
+    p++;
+    if (p < end && *p == '.') {
+        p++;
+        for (int scale = 100; scale > 0 && p < end && *p >= '0' && *p <= '9'; scale /= 10, p++) {
+            q += (*p - '0') * scale;
+        }
+    }
+    return q > 1000 ? 1000 : q;
+}
+
+int compress_accept_qvalue(const char *accept_encoding, size_t len, const char *coding) {
+    if (!accept_encoding) return -1;
+    size_t coding_len = strlen(coding);
+    const char *p = accept_encoding;
+    const char *end = accept_encoding + len;
+    int wildcard = -1;
+
+    while (p < end) {
+        while (p < end && (is_ows(*p) || *p == ',')) p++;
+        const char *name = p;
+        while (p < end && *p != ',' && *p != ';' && !is_ows(*p)) p++;
+        size_t name_len = (size_t)(p - name);
+
+        // 参数中只关心q
+        int q = 1000;
+        while (p < end && *p != ',') {
+            while (p < end && (is_ows(*p) || *p == ';')) p++;
+            const char *param = p;
+            while (p < end && *p != ',' && *p != ';') p++;
+            if (p - param >= 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                q = parse_qvalue(param + 2, p);
+            }
+        }
+
+        if (name_len == coding_len && strncasecmp(name, coding, coding_len) == 0) {
+            return q;
+        }
+        if (name_len == 1 && name[0] == '*') wildcard = q;
+    }
+    return wildcard;
 }
 
-// 获取压缩方法字符串
-const char *get_compression_method(void) {
-    return "gzip";
+// 最长前缀匹配mime_type的优先顺序
+static const compress_order_t *find_order(const compress_config_t *config, const char *mime_type) {
+    const compress_order_t *best = NULL;
+    size_t best_len = 0;
+    for (int i = 0; config && i < config->order_count; i++) {
+        const compress_order_t *order = &config->orders[i];
+        size_t n = strcmp(order->mime_prefix, "*") == 0 ? 0 : strlen(order->mime_prefix);
+        if (n > 0 && (!mime_type || strncmp(order->mime_prefix, mime_type, n) != 0)) continue;
+        if (!best || n > best_len) {
+            best = order;
+            best_len = n;
+        }
+    }
+    return best ? best : &default_order;
+}
+
+compress_encoding_t compress_negotiate(const compress_config_t *config, const char *mime_type,
+                                       const char *accept_encoding, size_t len) {
+    if (!config || !accept_encoding) return COMPRESS_ENCODING_NONE;
+
+    const compress_order_t *order = find_order(config, mime_type);
+    compress_encoding_t best = COMPRESS_ENCODING_NONE;
+    int best_q = 0;
+    for (int i = 0; i < order->count; i++) {
+        compress_encoding_t encoding = order->order[i];
+        if (!config->encodings[encoding] || !compress_encoding_supported(encoding)) continue;
+        int q = compress_accept_qvalue(accept_encoding, len, encoding_names[encoding]);
+        if (q > best_q) {
+            best = encoding;
+            best_q = q;
+        }
+    }
+    return best;
+}
+
+int compress_order_rank(const compress_config_t *config, const char *mime_type,
+                        compress_encoding_t encoding) {
+    const compress_order_t *order = find_order(config, mime_type);
+    for (int i = 0; i < order->count; i++) {
+        if (order->order[i] == encoding) return i;
+    }
+    return -1;
 }
 
 // 重置压缩上下文
 void compress_context_reset(compress_context_t *ctx) {
     if (!ctx || !ctx->initialized) return;
     
-    deflateReset(&ctx->stream);
-} 
\ No newline at end of file
+    encoder_reset(ctx);
+}
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include <zlib.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // 压缩级别枚举
 typedef enum {
@@ -12,26 +14,74 @@ typedef enum {
     COMPRESS_LEVEL_BEST = 9    // 最佳压缩
 } compress_level_t;
 
+// 内容编码（Content-Encoding）
+// br和zstd编码器只在编译时找到对应的库（ANX_WITH_BROTLI、ANX_WITH_ZSTD）时可用
+typedef enum {
+    COMPRESS_ENCODING_NONE = -1,
+    COMPRESS_ENCODING_GZIP = 0,
+    COMPRESS_ENCODING_BR,
+    COMPRESS_ENCODING_ZSTD,
+    COMPRESS_ENCODING_COUNT
+} compress_encoding_t;
+
+// 压缩级别档位：实时压缩的动态内容每个请求都要压缩一次，用快速级别；
+// 压缩结果会进入缓存时只压缩一次、发送多次，可以用高压缩率的离线级别
+typedef enum {
+    COMPRESS_PROFILE_DYNAMIC = 0,
+    COMPRESS_PROFILE_OFFLINE
+} compress_profile_t;
+
+#define COMPRESS_MAX_ORDERS 16
+
+// 一类MIME类型的编码优先顺序，客户端的q值相同时靠前的优先；未列出的编码不用于这类类型
+typedef struct {
+    char *mime_prefix;                          // "*"匹配所有类型
+    compress_encoding_t order[COMPRESS_ENCODING_COUNT];
+    int count;
+} compress_order_t;
+
 // 压缩配置结构
 typedef struct {
     bool enable_compression;           // 是否启用压缩
-    compress_level_t level;           // 压缩级别
+    bool encodings[COMPRESS_ENCODING_COUNT];     // 启用的编码（gzip总是启用）
+    int levels[COMPRESS_ENCODING_COUNT];         // 各编码实时压缩的级别
+    int offline_levels[COMPRESS_ENCODING_COUNT]; // 各编码的离线级别
+    bool use_offline_levels;          // 压缩结果进入缓存时是否使用离线级别
+    compress_order_t orders[COMPRESS_MAX_ORDERS]; // 按MIME类型的编码优先顺序
+    int order_count;
     size_t min_length;                // 最小压缩长度（字节）
     char **mime_types;                // 要压缩的MIME类型列表
     int mime_types_count;             // MIME类型数量
     bool enable_vary;                 // 是否添加Vary头
     size_t compression_buffer_size;   // 压缩缓冲区大小
+    size_t pool_size;                 // 每个worker缓存的空闲压缩上下文总内存上限，0表示不缓存
 } compress_config_t;
 
 // 压缩上下文结构
-typedef struct {
-    z_stream stream;           // zlib流
+typedef struct compress_context {
+    compress_encoding_t encoding;
+    z_stream stream;           // zlib流（gzip）
+    void *encoder;             // br或zstd的编码器状态
+    size_t avail_in;           // 上一次compress_data没有消耗的输入字节数
     unsigned char *in_buffer;  // 输入缓冲区
     unsigned char *out_buffer; // 输出缓冲区
     size_t buffer_size;       // 缓冲区大小
     bool initialized;         // 是否已初始化
+    int level;                // 池的键：编码、压缩级别、窗口和缓冲区大小相同的上下文可以复用
+    int window_bits;
+    size_t memory;            // 估计占用的内存（编码器内部状态加两个缓冲区）
+    struct compress_context *pool_next;
 } compress_context_t;
 
+// 压缩上下文池统计（当前worker）
+typedef struct {
+    uint64_t hits;             // 从池中取得已初始化的上下文
+    uint64_t misses;           // 池中没有可用上下文，新建
+    uint64_t discards;         // 归还时超过内存上限而释放
+    size_t pooled;             // 池中空闲的上下文数
+    size_t pooled_bytes;       // 池中空闲上下文的估计内存
+} compress_pool_stats_t;
+
 // 初始化压缩配置
 compress_config_t *compress_config_create(void);
 
@@ -44,21 +94,64 @@ int compress_config_add_mime_type(compress_config_t *config, const char *mime_ty
 // 检查MIME类型是否应该压缩
 bool should_compress_mime_type(compress_config_t *config, const char *mime_type);
 
-// 创建压缩上下文
-compress_context_t *compress_context_create(compress_config_t *config);
+// 添加一条编码优先顺序，value为"<MIME类型前缀> <编码>..."；同一前缀再次设置时覆盖
+int compress_config_add_order(compress_config_t *config, const char *value);
+
+// 按名称查找编码（"gzip"、"br"、"zstd"），未知时返回COMPRESS_ENCODING_NONE
+compress_encoding_t compress_encoding_from_name(const char *name);
+
+// 编码的Content-Encoding值
+const char *compress_encoding_name(compress_encoding_t encoding);
+
+// 编码器是否编译进来
+bool compress_encoding_supported(compress_encoding_t encoding);
+
+// 某编码在给定档位下使用的级别
+int compress_level(const compress_config_t *config, compress_encoding_t encoding,
+                   compress_profile_t profile);
+
+// 创建压缩上下文；input_size为要压缩的总字节数，用于选择br/zstd的窗口，流式压缩时传0
+compress_context_t *compress_context_create(compress_config_t *config, compress_encoding_t encoding,
+                                            int level, size_t input_size);
 
 // 释放压缩上下文
 void compress_context_free(compress_context_t *ctx);
 
-// 压缩数据块
+// 压缩上下文池：每个worker进程一份，在worker启动时调用
+// deflateInit2要分配约256KB并初始化内部表，小响应的压缩耗时主要在这里；
+// 归还的上下文重置后按(编码, 级别, 窗口, 缓冲区大小)留在池中，下次直接取用
+void compress_pool_init(size_t max_bytes);
+
+// 释放池中的上下文并在日志中记录统计
+void compress_pool_destroy(void);
+
+// 从池中取得encoding在profile档位下、适合input_size字节输入（0表示流式）的上下文，
+// 没有时新建；用完后用compress_context_release归还
+compress_context_t *compress_context_acquire(compress_config_t *config, compress_encoding_t encoding,
+                                             compress_profile_t profile, size_t input_size);
+
+// 归还上下文：重置后放回池中，超过内存上限时释放
+void compress_context_release(compress_context_t *ctx);
+
+void compress_pool_get_stats(compress_pool_stats_t *stats);
+
+// 压缩数据块，flush为Z_NO_FLUSH或Z_FINISH，各编码都按zlib的约定返回：
+// 压缩结束返回Z_STREAM_END，还需继续调用返回Z_OK，出错返回负数；未消耗的输入字节数记在ctx->avail_in
 int compress_data(compress_context_t *ctx, const void *in, size_t in_len,
                  void *out, size_t *out_len, int flush);
 
-// 检查客户端是否支持压缩
-bool client_accepts_compression(const char *accept_encoding);
+// Accept-Encoding中coding的q值（0-1000）：按名称或"*"匹配，未提到时返回-1
+int compress_accept_qvalue(const char *accept_encoding, size_t len, const char *coding);
+
+// 为mime_type的响应协商编码：在该类型的优先顺序中选择客户端q值最高的已启用编码，
+// q值相同时取顺序靠前的；客户端不接受任何可用编码时返回COMPRESS_ENCODING_NONE
+compress_encoding_t compress_negotiate(const compress_config_t *config, const char *mime_type,
+                                       const char *accept_encoding, size_t len);
 
-// 获取压缩方法字符串
-const char *get_compression_method(void);
+// encoding在mime_type的优先顺序（compress_order）中的位置，越小越优先；
+// 该类型的顺序没有列出时返回-1，config为NULL时使用默认顺序（br、zstd、gzip）
+int compress_order_rank(const compress_config_t *config, const char *mime_type,
+                        compress_encoding_t encoding);
 
 // 重置压缩上下文
 void compress_context_reset(compress_context_t *ctx);
@@ -2,15 +2,47 @@
 
 #include "util.h"
 
+// 扩展名到Content-Type的映射，HTTP与HTTPS的静态文件共用
+static const struct {
+  const char *ext;
+  const char *type;
+} mime_types[] = {
+  {"html", "text/html"},
+  {"htm", "text/html"},
+  {"css", "text/css"},
+  {"js", "application/javascript"},
+  {"json", "application/json"},
+  {"png", "image/png"},
+  {"jpg", "image/jpeg"},
+  {"jpeg", "image/jpeg"},
+  {"gif", "image/gif"},
+  {"ico", "image/x-icon"},
+  {"svg", "image/svg+xml"},
+  {"woff", "font/woff"},
+  {"woff2", "font/woff2"},
+  {"ttf", "font/ttf"},
+  {"eot", "application/vnd.ms-fontobject"},
+  {"otf", "font/otf"},
+  {"pdf", "application/pdf"},
+  {"zip", "application/zip"},
+  {"gz", "application/gzip"},
+  {"tar", "application/x-tar"},
+  {"xml", "application/xml"},
+  {"txt", "text/plain"},
+  {"md", "text/markdown"},
+  {"mp4", "video/mp4"},
+  {"webm", "video/webm"},
+  {"mp3", "audio/mpeg"},
+  {"wav", "audio/wav"},
+  {"ogg", "audio/ogg"},
+};
+
 // Simple function to get MIME type from file extension
 const char *get_mime_type(const char *path) {
   const char *dot = strrchr(path, '.');
   if (!dot || dot == path) return "application/octet-stream";
-  if (strcmp(dot, ".html") == 0) return "text/html";
-  if (strcmp(dot, ".css") == 0) return "text/css";
-  if (strcmp(dot, ".js") == 0) return "application/javascript";
-  if (strcmp(dot, ".jpg") == 0) return "image/jpeg";
-  if (strcmp(dot, ".jpeg") == 0) return "image/jpeg";
-  if (strcmp(dot, ".png") == 0) return "image/png";
+  for (size_t i = 0; i < sizeof(mime_types) / sizeof(mime_types[0]); i++) {
+    if (strcmp(dot + 1, mime_types[i].ext) == 0) return mime_types[i].type;
+  }
   return "application/octet-stream";
-} 
\ No newline at end of file
+}